@@ -0,0 +1,485 @@
+// Host benchmarks for the firmware's data paths. Built by the native
+// environment against the Arduino shims in bench/shims:
+//
+//   pio run -e native && .pio/build/native/program [filter] [--time=ms] [--capture=file]
+//
+// replay/capture pushes an input capture through InputRecorder's full-speed
+// replay: the one in payloads.h, or a "rec dump" saved from the serial
+// console with --capture.
+//
+// Each benchmark repeats its operation until a batch takes at least the
+// minimum time (500 ms by default), then reports the time per operation and
+// the heap allocations per operation. Allocations are counted at malloc on
+// glibc, which includes ArduinoJson's pool; elsewhere only operator new is
+// seen.
+
+#include "app_state.h"
+#include "gesture_recognizer.h"
+#include "input_recorder.h"
+#include "mqtt_manager.h"
+#include "payloads.h"
+#include "rules_engine.h"
+#include "screen_mirror.h"
+#include "sign_state.h"
+#include "time_manager.h"
+#include <Arduino.h>
+#include <chrono>
+#include <fstream>
+#include <new>
+#include <string>
+#include <vector>
+
+namespace {
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+size_t allocationCount = 0;
+size_t allocationBytes = 0;
+unsigned long minimumBatchMillis = 500;
+const char* nameFilter = nullptr;
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+const uint64_t MAX_ITERATIONS = 1ULL << 32;
+const double NANOS_PER_MILLI = 1e6;
+
+inline auto countAllocation(size_t size) -> void {
+  allocationCount++;
+  allocationBytes += size;
+}
+
+// Keeps a result alive so the compiler can't drop the work that made it
+template <typename T>
+inline auto keep(const T& value) -> void {
+  asm volatile("" : : "g"(&value) : "memory");
+}
+
+} // namespace
+
+#ifdef __GLIBC__
+extern "C" {
+auto __libc_malloc(size_t size) -> void*;
+auto __libc_calloc(size_t count, size_t size) -> void*;
+auto __libc_realloc(void* pointer, size_t size) -> void*;
+auto __libc_free(void* pointer) -> void;
+
+auto malloc(size_t size) noexcept -> void* {
+  countAllocation(size);
+  return __libc_malloc(size);
+}
+
+auto calloc(size_t count, size_t size) noexcept -> void* {
+  countAllocation(count * size);
+  return __libc_calloc(count, size);
+}
+
+auto realloc(void* pointer, size_t size) noexcept -> void* {
+  countAllocation(size);
+  return __libc_realloc(pointer, size);
+}
+
+auto free(void* pointer) noexcept -> void {
+  __libc_free(pointer);
+}
+}
+#else
+auto operator new(size_t size) -> void* {
+  countAllocation(size);
+  void* pointer = std::malloc(size);
+  if (pointer == nullptr) {
+    throw std::bad_alloc();
+  }
+  return pointer;
+}
+
+auto operator new[](size_t size) -> void* {
+  return operator new(size);
+}
+
+auto operator delete(void* pointer) noexcept -> void {
+  std::free(pointer);
+}
+
+auto operator delete[](void* pointer) noexcept -> void {
+  std::free(pointer);
+}
+
+auto operator delete(void* pointer, size_t /*size*/) noexcept -> void {
+  std::free(pointer);
+}
+
+auto operator delete[](void* pointer, size_t /*size*/) noexcept -> void {
+  std::free(pointer);
+}
+#endif
+
+// Reaches the private pipeline stages; befriended by the classes under test
+struct NativeBench {
+  static auto decodeBase64(const String& encoded) -> std::vector<uint8_t> {
+    return SignState::getInstance().decodeBase64(reinterpret_cast<const uint8_t*>(encoded.c_str()), encoded.length());
+  }
+
+  static auto parseBMP(const std::vector<uint8_t>& bmpData) -> std::vector<uint8_t> {
+    return SignState::getInstance().parseBMP(bmpData);
+  }
+
+  static auto convertToMonochrome(const String& base64Data) -> std::vector<uint8_t> {
+    return SignState::getInstance().convertToMonochrome(reinterpret_cast<const uint8_t*>(base64Data.c_str()),
+                                                        base64Data.length());
+  }
+
+  static auto publishDiscoveryMessage() -> void {
+    MQTTManager::getInstance().publishDiscoveryMessage();
+  }
+
+  static auto drainPublishes() -> void {
+    MQTTManager::getInstance().drainPublishes();
+  }
+
+  static auto encodeFrame(const uint8_t* frame, ScreenMirror::Frame& out) -> void {
+    ScreenMirror::encode(frame, out);
+  }
+
+  static auto formatTime(struct tm* timeInfo) {
+    return TimeManager::getInstance().formatTime(timeInfo);
+  }
+
+  // Feeds the lines of a "rec dump" through the console's "rec load"
+  static auto loadCapture(const std::vector<std::string>& lines) -> size_t {
+    InputRecorder& recorder = InputRecorder::getInstance();
+    recorder.handleCommand("rec load");
+    for (const std::string& line : lines) {
+      recorder.handleCommand(line.c_str());
+    }
+    if (recorder.mode == InputRecorder::Mode::LOADING) {
+      recorder.handleCommand("# end");
+    }
+    if (recorder.recordCount > 0) {
+      InputRecorder::RecordType type{};
+      size_t length = 0;
+      recorder.readRecord(0, type, recorder.replayBaseTimestamp, length);
+    }
+    return recorder.recordCount;
+  }
+
+  static auto replayCapture() -> void {
+    InputRecorder& recorder = InputRecorder::getInstance();
+    recorder.replayStartMillis = millis();
+    recorder.replayRecords();
+  }
+};
+
+namespace {
+
+// An MQTT message in writable buffers, the way PubSubClient hands it over
+struct InboundMessage {
+  std::vector<char> topic;
+  std::vector<byte> payload;
+
+  InboundMessage(const char* topicText, const char* payloadText)
+      : topic(topicText, topicText + strlen(topicText) + 1),
+        payload(payloadText, payloadText + strlen(payloadText)) {}
+
+  auto deliver() -> void {
+    MQTTManager::onMqttMessage(topic.data(), payload.data(), payload.size());
+  }
+};
+
+template <typename Operation>
+auto measure(const char* name, Operation operation) -> void {
+  if (nameFilter != nullptr && strstr(name, nameFilter) == nullptr) {
+    return;
+  }
+
+  // Grow the batch until it is long enough to time; the first short
+  // batches double as warm-up
+  uint64_t iterations = 1;
+  for (;;) {
+    allocationCount = 0;
+    allocationBytes = 0;
+    auto const start = std::chrono::steady_clock::now();
+    for (uint64_t i = 0; i < iterations; i++) {
+      operation(i);
+    }
+    auto const elapsed = std::chrono::steady_clock::now() - start;
+    size_t const allocations = allocationCount;
+    size_t const bytes = allocationBytes;
+
+    double const nanos = std::chrono::duration<double, std::nano>(elapsed).count();
+    double const targetNanos = minimumBatchMillis * NANOS_PER_MILLI;
+    if (nanos >= targetNanos || iterations >= MAX_ITERATIONS) {
+      auto const count = static_cast<double>(iterations);
+      printf("%-40s %12llu %12.1f %10.2f %10.1f\n", name, static_cast<unsigned long long>(iterations), nanos / count,
+             static_cast<double>(allocations) / count, static_cast<double>(bytes) / count);
+      return;
+    }
+
+    // Aim a little past the target so the next batch is usually the last
+    double const scale = nanos > 0 ? targetNanos * 1.2 / nanos : 100;
+    iterations = static_cast<uint64_t>(static_cast<double>(iterations) * min(max(scale, 2.0), 100.0));
+  }
+}
+
+auto benchSignState() -> void {
+  std::vector<String> encoded;
+  std::vector<std::vector<uint8_t>> decoded;
+  for (const SignPayload& payload : SIGN_PAYLOADS) {
+    encoded.emplace_back(payload.base64);
+    decoded.push_back(NativeBench::decodeBase64(encoded.back()));
+  }
+
+  measure("sign/decodeBase64", [&](uint64_t i) {
+    keep(NativeBench::decodeBase64(encoded[i % encoded.size()]));
+  });
+  measure("sign/parseBMP", [&](uint64_t i) {
+    keep(NativeBench::parseBMP(decoded[i % decoded.size()]));
+  });
+
+  // Pixel content only matters to the monochrome pass, so it gets one run
+  // per image
+  for (size_t image = 0; image < SIGN_PAYLOADS.size(); image++) {
+    String const name = String("sign/convertToMonochrome/") + SIGN_PAYLOADS[image].name;
+    measure(name.c_str(), [&](uint64_t /*i*/) {
+      keep(NativeBench::convertToMonochrome(encoded[image]));
+    });
+  }
+}
+
+auto benchMqtt() -> void {
+  std::vector<InboundMessage> telemetry;
+  for (const MqttPayload& message : MQTT_PAYLOADS) {
+    telemetry.emplace_back(message.topic, message.payload);
+  }
+  InboundMessage signImage("office_sign/image/set", SIGN_PAYLOADS[0].base64);
+  MQTTManager& mqtt = MQTTManager::getInstance();
+  mqtt.init();
+
+  measure("mqtt/onMqttMessage/telemetry", [&](uint64_t i) {
+    telemetry[i % telemetry.size()].deliver();
+  });
+  measure("mqtt/onMqttMessage/sign_image", [&](uint64_t /*i*/) {
+    signImage.deliver();
+  });
+  measure("mqtt/publishDiscoveryMessage", [](uint64_t /*i*/) {
+    NativeBench::publishDiscoveryMessage();
+  });
+  // Queued by the loop task and sent by the network task, both in one op
+  measure("mqtt/publishButtonState", [&](uint64_t i) {
+    mqtt.publishButtonState(static_cast<int>(i % 5) + 1, true);
+    NativeBench::drainPublishes();
+  });
+  measure("mqtt/publishGesture", [&](uint64_t /*i*/) {
+    mqtt.publishGesture("button/3", Gesture::DOUBLE_CLICK);
+    NativeBench::drainPublishes();
+  });
+}
+
+auto benchRules() -> void {
+  RulesEngine& rules = RulesEngine::getInstance();
+  rules.onDefinitionReceived(reinterpret_cast<const byte*>(RULES_DEFINITION), strlen(RULES_DEFINITION));
+  MQTTManager& mqtt = MQTTManager::getInstance();
+
+  size_t count = 0;
+  measure("rules/match/hit", [&](uint64_t /*i*/) {
+    keep(rules.match("button/2/long_press", count));
+  });
+  measure("rules/match/miss", [&](uint64_t /*i*/) {
+    keep(rules.match("button/4/pressed", count));
+  });
+  // Two direct publishes ahead of the Home Assistant one
+  measure("rules/publishButtonState", [&](uint64_t /*i*/) {
+    mqtt.publishButtonState(1, true);
+    NativeBench::drainPublishes();
+  });
+}
+
+// The input handling from main.cpp, which the native build leaves out
+const uint8_t REPLAY_DIAL_INPUT = 5;
+const std::array<const char*, REPLAY_DIAL_INPUT + 1> REPLAY_INPUT_NAMES = {
+  "button/1", "button/2", "button/3", "button/4", "button/5", "dial"
+};
+const GestureConfig REPLAY_GESTURE_CONFIG = {250, 600, 200};
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+std::array<GestureRecognizer, REPLAY_DIAL_INPUT + 1> replayRecognizers;
+size_t replayGestures = 0;
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+auto onReplayGesture(uint8_t input, Gesture gesture, unsigned long /*timestamp*/) -> void {
+  replayGestures++;
+  MQTTManager::getInstance().publishGesture(REPLAY_INPUT_NAMES[input], gesture);
+}
+
+auto onReplayEdge(uint8_t input, bool pressed, unsigned long timestamp) -> void {
+  if (input == REPLAY_DIAL_INPUT) {
+    if (pressed) {
+      AppState::getInstance().onSelect();
+    }
+  } else {
+    MQTTManager::getInstance().publishButtonState(input + 1, pressed);
+  }
+  replayRecognizers[input].feed(pressed, timestamp);
+}
+
+auto onReplaySteps(int steps) -> void {
+  if (steps < 0) {
+    AppState::getInstance().onNext(-steps);
+  } else if (steps > 0) {
+    AppState::getInstance().onPrevious(steps);
+  }
+}
+
+auto onReplayClock(unsigned long now, bool finished) -> void {
+  for (GestureRecognizer& recognizer : replayRecognizers) {
+    recognizer.poll(now);
+    if (finished) {
+      recognizer.finish();
+    }
+  }
+}
+
+auto benchReplay(const char* capturePath) -> void {
+  const char* const name = "replay/capture";
+  if (nameFilter != nullptr && strstr(name, nameFilter) == nullptr) {
+    return;
+  }
+
+  std::vector<std::string> lines(INPUT_CAPTURE.begin(), INPUT_CAPTURE.end());
+  if (capturePath != nullptr) {
+    std::ifstream file(capturePath);
+    if (!file) {
+      fprintf(stderr, "Cannot read capture %s\n", capturePath);
+      return;
+    }
+    lines.clear();
+    for (std::string line; std::getline(file, line);) {
+      if (!line.empty() && line.back() == '\r') {
+        line.pop_back();
+      }
+      lines.push_back(line);
+    }
+  }
+
+  for (size_t i = 0; i < replayRecognizers.size(); i++) {
+    replayRecognizers[i].init(i, onReplayGesture, REPLAY_GESTURE_CONFIG);
+  }
+  InputRecorder::getInstance().init(onReplayEdge, onReplaySteps, onReplayClock);
+  AppState::getInstance().init();
+  size_t const records = NativeBench::loadCapture(lines);
+  if (records == 0) {
+    fprintf(stderr, "Capture has no records\n");
+    return;
+  }
+
+  // One pass to report what the capture turns into, then the timed ones
+  replayGestures = 0;
+  NativeBench::replayCapture();
+  NativeBench::drainPublishes();
+  fprintf(stderr, "Capture: %zu records, %zu gestures per replay\n", records, replayGestures);
+
+  measure(name, [](uint64_t /*i*/) {
+    NativeBench::replayCapture();
+    NativeBench::drainPublishes();
+  });
+}
+
+auto benchTime() -> void {
+  // Morning, afternoon, midnight and a leap day, all in UTC
+  const std::array<time_t, 4> moments = {1767601800, 1767641400, 1767571200, 1709208000};
+  std::array<struct tm, moments.size()> times{};
+  for (size_t i = 0; i < moments.size(); i++) {
+    gmtime_r(&moments[i], &times[i]);
+  }
+
+  measure("time/formatTime", [&](uint64_t i) {
+    keep(NativeBench::formatTime(&times[i % times.size()]));
+  });
+}
+
+auto benchAppState() -> void {
+  AppState& app = AppState::getInstance();
+  app.init();
+
+  // A dial detent within the Office Sign submenu
+  app.onNext();
+  app.onSelect();
+  measure("app/onNext", [&](uint64_t i) {
+    if (i % 2 == 0) {
+      app.onNext();
+    } else {
+      app.onPrevious();
+    }
+  });
+
+  // Wake, open the submenu, scroll to Meeting and pick it, which publishes
+  // the action and returns to the root
+  app.init();
+  measure("app/navigate_and_select", [&](uint64_t /*i*/) {
+    app.onNext();
+    app.onSelect();
+    app.onNext();
+    app.onNext();
+    app.onPrevious();
+    app.onSelect();
+    NativeBench::drainPublishes();
+  });
+}
+
+auto benchMirror() -> void {
+  // A blank screen, text-like marks over the menu half, and noise, which
+  // no run shortens
+  using FrameBuffer = std::array<uint8_t, ScreenMirror::FRAME_BYTES>;
+  FrameBuffer blank{};
+  FrameBuffer menu{};
+  FrameBuffer noise{};
+  uint32_t state = 1;
+  auto nextRandom = [&state] {
+    state ^= state << 13;
+    state ^= state >> 17;
+    state ^= state << 5;
+    return static_cast<uint8_t>(state);
+  };
+  for (size_t i = 0; i < ScreenMirror::FRAME_BYTES; i++) {
+    menu[i] = i < ScreenMirror::FRAME_BYTES / 2 && i % 8 < 5 ? nextRandom() : 0;
+    noise[i] = nextRandom();
+  }
+
+  ScreenMirror::Frame out{};
+  measure("mirror/encode/blank", [&](uint64_t /*i*/) {
+    NativeBench::encodeFrame(blank.data(), out);
+    keep(out);
+  });
+  measure("mirror/encode/menu", [&](uint64_t /*i*/) {
+    NativeBench::encodeFrame(menu.data(), out);
+    keep(out);
+  });
+  measure("mirror/encode/noise", [&](uint64_t /*i*/) {
+    NativeBench::encodeFrame(noise.data(), out);
+    keep(out);
+  });
+}
+
+} // namespace
+
+auto main(int argc, char** argv) -> int {
+  const char* const TIME_OPTION = "--time=";
+  const char* const CAPTURE_OPTION = "--capture=";
+  const char* capturePath = nullptr;
+  for (int i = 1; i < argc; i++) {
+    if (strncmp(argv[i], TIME_OPTION, strlen(TIME_OPTION)) == 0) {
+      minimumBatchMillis = strtoul(argv[i] + strlen(TIME_OPTION), nullptr, 10);
+    } else if (strncmp(argv[i], CAPTURE_OPTION, strlen(CAPTURE_OPTION)) == 0) {
+      capturePath = argv[i] + strlen(CAPTURE_OPTION);
+    } else {
+      nameFilter = argv[i];
+    }
+  }
+
+  printf("%-40s %12s %12s %10s %10s\n", "benchmark", "iterations", "ns/op", "allocs/op", "bytes/op");
+  benchSignState();
+  benchMqtt();
+  benchRules();
+  benchTime();
+  benchAppState();
+  benchMirror();
+  benchReplay(capturePath);
+  return 0;
+}
@@ -0,0 +1,4 @@
+# Adds the benchmark harness and the Arduino shims to the native build
+Import("env")  # noqa: F821 pylint: disable=undefined-variable
+
+env.BuildSources("$BUILD_DIR/bench", "$PROJECT_DIR/bench")  # noqa: F821 pylint: disable=undefined-variable
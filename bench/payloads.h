@@ -0,0 +1,124 @@
+#ifndef BENCH_PAYLOADS_H
+#define BENCH_PAYLOADS_H
+
+// Inputs for the benchmarks, shaped like what the panel receives in use.
+//
+// The sign images are what arrives on office_sign/image/set: a base64
+// 32x8 24-bit BMP, stored bottom-up in BGR with a 54-byte header (822 bytes,
+// 1096 characters encoded).
+
+#include <array>
+
+struct SignPayload {
+  const char* name;
+  const char* base64;
+};
+
+const std::array<SignPayload, 4> SIGN_PAYLOADS = {{
+  // White text on black, the common case
+  {"work",
+   "Qk02AwAAAAAAADYAAAAoAAAAIAAAAAgAAAABABgAAAAAAAADAAATCwAAEwsAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAAAAAA////AAAA////AAAAAAAAAAAA////////////AAAAAAAA////AAAAAAAAAAAA////AAAA"
+   "////AAAAAAAAAAAA////AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA////AAAA////AAAA////AAAA////AAAAAAAAAAAA"
+   "////AAAA////AAAAAAAA////AAAAAAAA////AAAAAAAA////AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA////AAAA"
+   "////AAAA////AAAA////AAAAAAAAAAAA////AAAA////AAAA////AAAAAAAAAAAA////AAAA////AAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAA////AAAA////AAAA////AAAA////AAAAAAAAAAAA////AAAA////////////////AAAAAAAA"
+   "////////AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA////AAAAAAAAAAAA////AAAA////AAAAAAAAAAAA"
+   "////AAAA////AAAAAAAAAAAA////AAAA////AAAA////AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA////AAAA"
+   "AAAAAAAA////AAAA////AAAAAAAAAAAA////AAAA////AAAAAAAAAAAA////AAAA////AAAAAAAA////AAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAA////AAAAAAAAAAAA////AAAAAAAA////////////AAAAAAAA////////////////AAAAAAAA"
+   "////AAAAAAAAAAAA////AAAAAAAAAAAAAAAAAAAA"},
+  // Coloured text on black
+  {"meet",
+   "Qk02AwAAAAAAADYAAAAoAAAAIAAAAAgAAAABABgAAAAAAAADAAATCwAAEwsAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAFBTcAAAAFBTcFBTcFBTcFBTcFBTcAAAAFBTcFBTcFBTcFBTcFBTcAAAA"
+   "AAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAFBTcAAAAFBTcAAAAAAAAAAAA"
+   "AAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAA"
+   "AAAAAAAAFBTcAAAAFBTcAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAFBTcAAAAFBTcAAAAFBTcFBTcFBTcFBTcAAAAAAAAFBTcFBTcFBTcFBTcAAAAAAAA"
+   "AAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAFBTcAAAAFBTcAAAAFBTcAAAAAAAAAAAA"
+   "AAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcFBTc"
+   "AAAAFBTcFBTcAAAAFBTcAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAAAAAAAAA"
+   "AAAAAAAAAAAAAAAAAAAAAAAAFBTcAAAAAAAAAAAAFBTcAAAAFBTcFBTcFBTcFBTcFBTcAAAAFBTcFBTcFBTcFBTcFBTcAAAA"
+   "FBTcFBTcFBTcFBTcFBTcAAAAAAAAAAAAAAAAAAAA"},
+  // Text over a lit, graded background
+  {"focus",
+   "Qk02AwAAAAAAADYAAAAoAAAAIAAAAAgAAAABABgAAAAAAAADAAATCwAAEwsAAAAAAAAAAAAAOAAAOQAAOgAAOwAAPAAAPQAA"
+   "PgAAPwAAQAAAQQAAQgAAQwAARAAARQAARgAARwAASAAASQAASgAASwAATAAATQAATgAATwAAUAAAUQAAUgAAUwAAVAAAVQAA"
+   "VgAAVwAAMAAAAMj/MgAAMwAANAAANQAANgAANwAAAMj/AMj/AMj/OwAAPAAAPQAAAMj/AMj/AMj/QQAAQgAAQwAAAMj/AMj/"
+   "AMj/RwAASAAAAMj/AMj/AMj/AMj/TQAATgAATwAAKAAAAMj/KgAAKwAALAAALQAALgAAAMj/MAAAMQAAMgAAAMj/NAAAAMj/"
+   "NgAANwAAOAAAAMj/OgAAAMj/PAAAPQAAPgAAAMj/QAAAQQAAQgAAQwAARAAAAMj/RgAARwAAIAAAAMj/IgAAIwAAJAAAJQAA"
+   "JgAAAMj/KAAAKQAAKgAAAMj/LAAAAMj/LgAALwAAMAAAMQAAMgAAAMj/NAAANQAANgAAAMj/OAAAOQAAOgAAOwAAPAAAAMj/"
+   "PgAAPwAAGAAAAMj/AMj/AMj/AMj/HQAAHgAAAMj/IAAAIQAAIgAAAMj/JAAAAMj/JgAAJwAAKAAAKQAAKgAAAMj/LAAALQAA"
+   "LgAAAMj/MAAAMQAAAMj/AMj/AMj/NQAANgAANwAAEAAAAMj/EgAAEwAAFAAAFQAAFgAAAMj/GAAAGQAAGgAAAMj/HAAAAMj/"
+   "HgAAHwAAIAAAIQAAIgAAAMj/JAAAJQAAJgAAAMj/KAAAAMj/KgAAKwAALAAALQAALgAALwAACAAAAMj/CgAACwAADAAADQAA"
+   "DgAAAMj/EAAAEQAAEgAAAMj/FAAAAMj/FgAAFwAAGAAAAMj/GgAAAMj/HAAAHQAAHgAAAMj/IAAAAMj/IgAAIwAAJAAAJQAA"
+   "JgAAJwAAAAAAAMj/AMj/AMj/AMj/AMj/BgAABwAAAMj/AMj/AMj/CwAADAAADQAAAMj/AMj/AMj/EQAAEgAAAMj/FAAAFQAA"
+   "FgAAAMj/GAAAGQAAAMj/AMj/AMj/AMj/HgAAHwAA"},
+  // Random colours, every pixel different
+  {"noise",
+   "Qk02AwAAAAAAADYAAAAoAAAAIAAAAAgAAAABABgAAAAAAAADAAATCwAAEwsAAAAAAAAAAAAABrENmEWoBoQiq9c7R4cN+Aja"
+   "u0T36WellH4oWvuajsvKjnJZA/wOKs3qUaWnWJbNM/iWIwOuvl9oSNEE4GgF8Cg3LiCaE6VW7XwCTEEqhFt7tEXyBLrF64w2"
+   "sRmlNote9IMVuADGHylvyL1eXa9ZLrL2VigLwcKQdGOWrbg4udbK8us1UutFIqBicwvzF5vUoWfkVaDvqdFs5k9slR/D01GA"
+   "KgreqyXuWAKveIt6iSZZXdl3FQGt9GcRuvJNY7pAyBPe4y9BLBZ1vmpRhwgkP9gXd4uwk0tJUSPUn4U6RnUrENU0kTXIfRJ/"
+   "y5MdeWC3HqFX1F+CG/FwK0qnBRJ8Ab+Y2t7Wx9TdEdG5zR3a2Pnn0d7TUdR5ajr7SVhA/STn3bNb3ZHZB5krO2XS5cLvomJ8"
+   "Cse99qBOGceWkdl6MtwI6FmuPZ48KEsaFy4YQkBdwQWCZR2v3HkPVxIIvuk+uWnuKUK+GBP9invNtNS7DJPju03uSaBWEIis"
+   "DTBr0JXdDcMr12SqzOUHygdGYmR+q9qjFKjX76fIUbuF+vcVnI42bJN7KgbpnvpgpnR6A4xQ1CwLd3vxmvhnykmmvcyai74V"
+   "KxcnzQuyUbP/hFEFEdX7ACKHhMegNF8FYYPrEA+d8fnm45iQ9sH+jjnqc4BisFn1c7oVnNvZ34sQdQIxWAmaraZrAv7jVpUY"
+   "BK5xHlayJRj0PcSehOFTDXYfGie3rQkbqTn++XXlBRYPLgjI3nA598cbwidtakQ5jIIwr3aO5prOgaIlQ0NDyuImK+OwjkSM"
+   "EXy5Jfl3R9OLQ4DnObt2/qajKAJKw87PcHDlAktQB5+qVUJsJwhgyDA9zp0aUo9Bo6QiEQiTYztpJlQIUDtYwYvbjH+/hplM"
+   "WFPPkVv1WjvRlHPCO3MOUDMEz8GbJbemUZCtMCM5N6GKsBGU9DHFYGHzfoRC3xYZvagTTejx6fd3jhaxcgRQtpAHOc9lOa64"
+   "3R5yPvIYAltJiyCW3gMmYluM948fqCGGkSH5zZn7"},
+}};
+
+struct MqttPayload {
+  const char* topic;
+  const char* payload;
+};
+
+// One of each status and telemetry update, in the proportions they arrive
+// while the PC is on; the sign image is measured on its own
+const std::array<MqttPayload, 10> MQTT_PAYLOADS = {{
+  {"homeassistant/sensor/pc_status_monitor_cpu_temp_avg/state", "47.5"},
+  {"homeassistant/sensor/pc_status_monitor_cpu_usage_avg/state", "12.3"},
+  {"homeassistant/sensor/pc_status_monitor_gpu_temp/state", "41"},
+  {"homeassistant/sensor/pc_status_monitor_gpu_util/state", "3"},
+  {"homeassistant/sensor/pc_status_monitor_ram_usage/state", "38.9"},
+  {"homeassistant/sensor/pc_status_monitor_gpu_mem_util/state", "9.4"},
+  {"homeassistant/sensor/pc_status_monitor_status/status", "ON"},
+  {"desk-control/light-status", "on"},
+  {"desk-control/fan-status", "off"},
+  {"homeassistant/sensor/unrelated/state", "ignored"}
+}};
+
+// A rules table for the light, the fan and the sign, as desk-control/rules
+// carries it
+const char* const RULES_DEFINITION =
+  "{\"button/1/pressed\":[{\"topic\":\"zigbee2mqtt/desk_lamp/set\",\"payload\":\"{\\\"state\\\":\\\"TOGGLE\\\"}\"},"
+  "{\"topic\":\"zigbee2mqtt/monitor_light/set\",\"payload\":\"{\\\"state\\\":\\\"TOGGLE\\\"}\"}],"
+  "\"button/2/pressed\":[{\"topic\":\"zigbee2mqtt/desk_fan/set\",\"payload\":\"TOGGLE\"}],"
+  "\"button/2/long_press\":[{\"topic\":\"zigbee2mqtt/desk_fan/set\",\"payload\":\"OFF\",\"retain\":true}],"
+  "\"dial/double_click\":[{\"topic\":\"office_sign/mode\",\"payload\":\"{event} at {timestamp}\"}],"
+  "\"action/os-work\":[{\"topic\":\"office_sign/mode\",\"payload\":\"work\"}]}";
+
+// A "rec dump" capture of about eight seconds at the panel: a click, a double
+// click and a held press on the buttons, two status messages, the dial
+// waking the menu, scrolling and selecting, then a click followed by a held
+// second press
+const std::array<const char*, 11> INPUT_CAPTURE = {{
+  "# capture 284 bytes 22 records",
+  "010200404b4c000001010200d0aa4d00000001020090d256000101010200100b",
+  "58000100010200d0df59000101010200603f5b000100010200c0ed6500020101",
+  "020020d17c000200033e000065810039686f6d65617373697374616e742f7365",
+  "6e736f722f70635f7374617475735f6d6f6e69746f725f6370755f74656d705f",
+  "6176672f737461746534372e35010200807f8700050101020020068900050002",
+  "0200009a8d00ffff020200f0e38f00ffff02020050ce9000feff02020090db93",
+  "000100010200b07c9b000501010200602a9d000500031c00a037a00019646573",
+  "6b2d636f6e74726f6c2f6c696768742d7374617475736f6e010200a06cac0003",
+  "0101020030ccad000300010200f0a0af00030101020070f0c1000300",
+  "# end"
+}};
+
+#endif // BENCH_PAYLOADS_H
@@ -0,0 +1,272 @@
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+// Just enough of the Arduino-ESP32 core to build the firmware sources on a
+// host for benchmarking. Hardware calls are no-ops; String, Print and the
+// clock behave like the real thing.
+
+#include <algorithm>
+#include <array>
+#include <cmath>
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <stdexcept>
+#include <string>
+#include <sys/time.h>
+
+#include "freertos/FreeRTOS.h"
+
+using byte = uint8_t;
+using std::max;
+using std::min;
+
+#define IRAM_ATTR
+#define DRAM_ATTR
+#define RTC_NOINIT_ATTR
+#define RTC_DATA_ATTR
+
+#define LOW 0
+#define HIGH 1
+#define INPUT 0x01
+#define INPUT_PULLUP 0x05
+#define OUTPUT 0x03
+#define RISING 0x01
+#define FALLING 0x02
+#define CHANGE 0x03
+
+class String {
+public:
+  String() = default;
+  String(const char* text) : value(text != nullptr ? text : "") {} // NOLINT(google-explicit-constructor)
+  String(const String&) = default;
+  String(String&&) noexcept = default;
+  explicit String(char character) : value(1, character) {}
+  explicit String(int number, unsigned char base = 10) : value(formatInteger(number, base)) {}
+  explicit String(unsigned int number, unsigned char base = 10) : value(formatInteger(number, base)) {}
+  explicit String(long number, unsigned char base = 10) : value(formatInteger(number, base)) {}
+  explicit String(unsigned long number, unsigned char base = 10) : value(formatInteger(number, base)) {}
+  explicit String(float number, unsigned int decimals = 2) : value(formatReal(number, decimals)) {}
+  explicit String(double number, unsigned int decimals = 2) : value(formatReal(number, decimals)) {}
+
+  auto operator=(const String&) -> String& = default;
+  auto operator=(String&&) noexcept -> String& = default;
+  auto operator=(const char* text) -> String& {
+    value = text != nullptr ? text : "";
+    return *this;
+  }
+
+  auto c_str() const -> const char* { return value.c_str(); }
+  auto length() const -> unsigned int { return static_cast<unsigned int>(value.size()); }
+  auto isEmpty() const -> bool { return value.empty(); }
+  auto reserve(unsigned int size) -> bool {
+    value.reserve(size);
+    return true;
+  }
+
+  auto concat(const char* text) -> bool {
+    value += text != nullptr ? text : "";
+    return true;
+  }
+  auto concat(const char* text, unsigned int length) -> bool {
+    value.append(text, length);
+    return true;
+  }
+  auto operator+=(const String& other) -> String& {
+    value += other.value;
+    return *this;
+  }
+  auto operator+=(const char* text) -> String& {
+    concat(text);
+    return *this;
+  }
+  auto operator+=(char character) -> String& {
+    value += character;
+    return *this;
+  }
+
+  auto operator==(const String& other) const -> bool { return value == other.value; }
+  auto operator==(const char* text) const -> bool { return value == (text != nullptr ? text : ""); }
+  auto operator!=(const String& other) const -> bool { return !(*this == other); }
+  auto operator!=(const char* text) const -> bool { return !(*this == text); }
+  auto operator[](unsigned int index) const -> char { return index < value.size() ? value[index] : '\0'; }
+
+  auto equals(const String& other) const -> bool { return *this == other; }
+  auto startsWith(const String& prefix) const -> bool { return value.compare(0, prefix.value.size(), prefix.value) == 0; }
+  auto endsWith(const String& suffix) const -> bool {
+    return value.size() >= suffix.value.size() && value.compare(value.size() - suffix.value.size(), suffix.value.size(), suffix.value) == 0;
+  }
+  auto indexOf(char character, unsigned int from = 0) const -> int { return toIndex(value.find(character, from)); }
+  auto indexOf(const String& text, unsigned int from = 0) const -> int { return toIndex(value.find(text.value, from)); }
+  auto substring(unsigned int from) const -> String { return substring(from, length()); }
+  auto substring(unsigned int from, unsigned int to) const -> String {
+    from = min(from, length());
+    to = min(max(from, to), length());
+    return String(value.substr(from, to - from).c_str());
+  }
+  auto trim() -> void {
+    size_t const first = value.find_first_not_of(" \t\r\n");
+    size_t const last = value.find_last_not_of(" \t\r\n");
+    value = first == std::string::npos ? std::string() : value.substr(first, last - first + 1);
+  }
+  auto toInt() const -> long { return std::strtol(value.c_str(), nullptr, 10); }
+  auto toFloat() const -> float { return std::strtof(value.c_str(), nullptr); }
+
+private:
+  std::string value;
+
+  static auto toIndex(size_t position) -> int { return position == std::string::npos ? -1 : static_cast<int>(position); }
+
+  template <typename T>
+  static auto formatInteger(T number, unsigned char base) -> std::string {
+    if (base == 10) {
+      return std::to_string(number);
+    }
+    std::array<char, 66> digits{};
+    snprintf(digits.data(), digits.size(), base == 16 ? "%llx" : "%llo", static_cast<unsigned long long>(number));
+    return digits.data();
+  }
+
+  static auto formatReal(double number, unsigned int decimals) -> std::string {
+    std::array<char, 64> text{};
+    snprintf(text.data(), text.size(), "%.*f", static_cast<int>(decimals), number);
+    return text.data();
+  }
+};
+
+// ArduinoJson recognises concatenation temporaries by this type
+class StringSumHelper : public String {
+public:
+  using String::String;
+  StringSumHelper(const String& other) : String(other) {} // NOLINT(google-explicit-constructor)
+};
+
+inline auto operator+(const String& left, const String& right) -> StringSumHelper {
+  StringSumHelper sum(left);
+  sum += right;
+  return sum;
+}
+inline auto operator+(const String& left, const char* right) -> StringSumHelper {
+  StringSumHelper sum(left);
+  sum += right;
+  return sum;
+}
+inline auto operator+(const char* left, const String& right) -> StringSumHelper {
+  StringSumHelper sum(left);
+  sum += right;
+  return sum;
+}
+inline auto operator+(const String& left, char right) -> StringSumHelper {
+  StringSumHelper sum(left);
+  sum += right;
+  return sum;
+}
+
+class Print {
+public:
+  virtual ~Print() = default;
+  virtual auto write(uint8_t data) -> size_t = 0;
+  virtual auto write(const uint8_t* data, size_t size) -> size_t {
+    size_t written = 0;
+    while (written < size && write(data[written]) == 1) {
+      written++;
+    }
+    return written;
+  }
+  auto write(const char* text) -> size_t { return write(reinterpret_cast<const uint8_t*>(text), strlen(text)); }
+
+  auto print(const char* text) -> size_t { return write(text); }
+  auto print(const String& text) -> size_t { return write(text.c_str()); }
+  auto print(char character) -> size_t { return write(static_cast<uint8_t>(character)); }
+  auto print(int number) -> size_t { return printf("%d", number); }
+  auto print(unsigned int number) -> size_t { return printf("%u", number); }
+  auto print(long number) -> size_t { return printf("%ld", number); }
+  auto print(unsigned long number) -> size_t { return printf("%lu", number); }
+  auto print(double number, int decimals = 2) -> size_t { return printf("%.*f", decimals, number); }
+  template <typename T>
+  auto println(const T& value) -> size_t { return print(value) + println(); }
+  auto println() -> size_t { return write("\r\n"); }
+
+  __attribute__((format(printf, 2, 3))) auto printf(const char* format, ...) -> size_t {
+    std::array<char, 256> text{};
+    va_list arguments;
+    va_start(arguments, format);
+    int const length = vsnprintf(text.data(), text.size(), format, arguments);
+    va_end(arguments);
+    return length <= 0 ? 0 : write(reinterpret_cast<const uint8_t*>(text.data()), min(static_cast<size_t>(length), text.size() - 1));
+  }
+};
+
+class Stream : public Print {
+public:
+  virtual auto available() -> int = 0;
+  virtual auto read() -> int = 0;
+  virtual auto peek() -> int = 0;
+
+  auto setTimeout(unsigned long timeout) -> void { (void)timeout; }
+  auto readBytes(char* buffer, size_t length) -> size_t {
+    size_t count = 0;
+    while (count < length) {
+      int const next = read();
+      if (next < 0) {
+        break;
+      }
+      buffer[count++] = static_cast<char>(next);
+    }
+    return count;
+  }
+  auto readBytes(uint8_t* buffer, size_t length) -> size_t { return readBytes(reinterpret_cast<char*>(buffer), length); }
+};
+
+// Console output goes to stderr so it never mixes with benchmark results
+class HardwareSerial : public Stream {
+public:
+  auto begin(unsigned long baud) -> void { (void)baud; }
+  auto onReceive(void (*callback)(), bool onlyOnTimeout = false) -> void { (void)callback, (void)onlyOnTimeout; }
+  auto available() -> int override { return 0; }
+  auto read() -> int override { return -1; }
+  auto peek() -> int override { return -1; }
+  auto write(uint8_t data) -> size_t override { return fwrite(&data, 1, 1, stderr); }
+  auto write(const uint8_t* data, size_t size) -> size_t override { return fwrite(data, 1, size, stderr); }
+  using Print::write;
+  explicit operator bool() const { return true; }
+};
+extern HardwareSerial Serial;
+
+auto millis() -> unsigned long;
+auto micros() -> unsigned long;
+auto delay(unsigned long ms) -> void;
+auto esp_random() -> uint32_t;
+auto random(long max) -> long;
+auto random(long min, long max) -> long;
+
+inline auto delayMicroseconds(unsigned int us) -> void { (void)us; }
+inline auto pinMode(int pin, int mode) -> void { (void)pin, (void)mode; }
+inline auto digitalRead(int pin) -> int { (void)pin; return HIGH; }
+inline auto digitalPinToInterrupt(int pin) -> int { return pin; }
+inline auto attachInterrupt(int interrupt, void (*handler)(), int mode) -> void { (void)interrupt, (void)handler, (void)mode; }
+inline auto detachInterrupt(int interrupt) -> void { (void)interrupt; }
+
+auto getLocalTime(struct tm* info, uint32_t ms = 5000) -> bool;
+auto configTzTime(const char* timezone, const char* server1, const char* server2 = nullptr, const char* server3 = nullptr) -> void;
+
+class EspClass {
+public:
+  [[noreturn]] auto restart() -> void;
+  auto getCycleCount() -> uint32_t;
+  auto getFreeHeap() -> uint32_t { return 0; }
+  auto getMinFreeHeap() -> uint32_t { return 0; }
+  auto getMaxAllocHeap() -> uint32_t { return 0; }
+  auto getCpuFreqMHz() -> uint32_t { return 0; }
+  auto getEfuseMac() -> uint64_t { return 0; }
+};
+extern EspClass ESP;
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && defined(__GLIBC_PREREQ) && __GLIBC_PREREQ(2, 38))
+extern "C" auto strlcpy(char* destination, const char* source, size_t size) -> size_t;
+#endif
+
+#endif // ARDUINO_SHIM_H
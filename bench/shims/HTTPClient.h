@@ -0,0 +1,49 @@
+#ifndef HTTPCLIENT_SHIM_H
+#define HTTPCLIENT_SHIM_H
+
+// Every request fails to connect; the benchmarks never go through HTTP
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+#define HTTP_CODE_OK 200
+#define HTTP_CODE_NOT_MODIFIED 304
+#define HTTPC_ERROR_CONNECTION_REFUSED (-1)
+
+enum followRedirects_t {
+  HTTPC_DISABLE_FOLLOW_REDIRECTS,
+  HTTPC_STRICT_FOLLOW_REDIRECTS,
+  HTTPC_FORCE_FOLLOW_REDIRECTS
+};
+
+class HTTPClient {
+public:
+  auto begin(Client& client, const String& url) -> bool {
+    stream = &client;
+    (void)url;
+    return true;
+  }
+  auto GET() -> int { return HTTPC_ERROR_CONNECTION_REFUSED; }
+  auto end() -> void {}
+  auto connected() -> bool { return false; }
+  auto getSize() -> int { return -1; }
+  auto getString() -> String { return ""; }
+  auto getStream() -> WiFiClient& { return *static_cast<WiFiClient*>(stream); }
+  auto getStreamPtr() -> WiFiClient* { return static_cast<WiFiClient*>(stream); }
+  auto header(const char* name) -> String {
+    (void)name;
+    return "";
+  }
+  auto collectHeaders(const char* names[], size_t count) -> void { (void)names, (void)count; }
+  auto addHeader(const String& name, const String& value) -> void { (void)name, (void)value; }
+  auto setUserAgent(const String& agent) -> void { (void)agent; }
+  auto setFollowRedirects(followRedirects_t follow) -> void { (void)follow; }
+  auto setReuse(bool reuse) -> void { (void)reuse; }
+  auto setTimeout(uint16_t timeout) -> void { (void)timeout; }
+  auto setConnectTimeout(int32_t timeout) -> void { (void)timeout; }
+
+private:
+  Client* stream = nullptr;
+};
+
+#endif // HTTPCLIENT_SHIM_H
@@ -0,0 +1,34 @@
+#ifndef IPADDRESS_SHIM_H
+#define IPADDRESS_SHIM_H
+
+#include <Arduino.h>
+
+class IPAddress {
+public:
+  IPAddress() = default;
+  IPAddress(uint8_t first, uint8_t second, uint8_t third, uint8_t fourth)
+      : address(first | (second << 8) | (third << 16) | (static_cast<uint32_t>(fourth) << 24)) {}
+  explicit IPAddress(uint32_t address) : address(address) {}
+
+  operator uint32_t() const { return address; } // NOLINT(google-explicit-constructor)
+  auto operator[](int index) const -> uint8_t { return (address >> (index * 8)) & 0xFF; }
+
+  auto toString() const -> String {
+    std::array<char, 16> text{};
+    snprintf(text.data(), text.size(), "%u.%u.%u.%u", (*this)[0], (*this)[1], (*this)[2], (*this)[3]);
+    return {text.data()};
+  }
+  auto fromString(const char* text) -> bool {
+    unsigned int parts[4] = {};
+    if (sscanf(text, "%u.%u.%u.%u", &parts[0], &parts[1], &parts[2], &parts[3]) != 4) {
+      return false;
+    }
+    *this = IPAddress(parts[0], parts[1], parts[2], parts[3]);
+    return true;
+  }
+
+private:
+  uint32_t address = 0;
+};
+
+#endif // IPADDRESS_SHIM_H
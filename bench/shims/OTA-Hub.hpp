@@ -0,0 +1,34 @@
+#ifndef OTA_HUB_SHIM_HPP
+#define OTA_HUB_SHIM_HPP
+
+// There is never an update on the bench
+
+#include <Arduino.h>
+#include <WiFi.h>
+
+namespace OTA {
+
+enum UpdateCondition { NO_UPDATE, NEW_DIFFERENT, OLD_DIFFERENT };
+enum InstallCondition { FAILED_TO_WRITE, REDIRECT_REQUIRED, SUCCESS };
+
+struct UpdateObject {
+  UpdateCondition condition = NO_UPDATE;
+  String name;
+  String tag_name;
+  String published_at;
+  String firmware_asset_id;
+  String firmware_asset_endpoint;
+  auto print() -> void {}
+};
+
+inline auto init(Client& client) -> void { (void)client; }
+inline auto isUpdateAvailable() -> UpdateObject { return {}; }
+inline auto performUpdate(UpdateObject* update, bool restart = true, bool force = false,
+                          void (*progress)(size_t, size_t) = nullptr) -> InstallCondition {
+  (void)update, (void)restart, (void)force, (void)progress;
+  return FAILED_TO_WRITE;
+}
+
+} // namespace OTA
+
+#endif // OTA_HUB_SHIM_HPP
@@ -0,0 +1,84 @@
+#ifndef PREFERENCES_SHIM_H
+#define PREFERENCES_SHIM_H
+
+// NVS kept in process memory, shared by every Preferences instance like the
+// real partition is
+
+#include <Arduino.h>
+#include <map>
+#include <vector>
+
+class Preferences {
+public:
+  auto begin(const char* name, bool readOnly = false) -> bool {
+    (void)readOnly;
+    space = name;
+    return true;
+  }
+  auto end() -> void {}
+
+  auto isKey(const char* key) -> bool { return storage().count(path(key)) > 0; }
+  auto remove(const char* key) -> bool { return storage().erase(path(key)) > 0; }
+  auto clear() -> bool {
+    storage().clear();
+    return true;
+  }
+
+  auto putBytes(const char* key, const void* value, size_t length) -> size_t {
+    const auto* bytes = static_cast<const uint8_t*>(value);
+    storage()[path(key)].assign(bytes, bytes + length);
+    return length;
+  }
+  auto getBytesLength(const char* key) -> size_t {
+    auto entry = storage().find(path(key));
+    return entry == storage().end() ? 0 : entry->second.size();
+  }
+  auto getBytes(const char* key, void* buffer, size_t length) -> size_t {
+    auto entry = storage().find(path(key));
+    if (entry == storage().end() || entry->second.size() > length) {
+      return 0;
+    }
+    memcpy(buffer, entry->second.data(), entry->second.size());
+    return entry->second.size();
+  }
+
+  auto putString(const char* key, const char* value) -> size_t { return putBytes(key, value, strlen(value) + 1); }
+  auto putString(const char* key, const String& value) -> size_t { return putString(key, value.c_str()); }
+  auto getString(const char* key, const String& defaultValue = String()) -> String {
+    auto entry = storage().find(path(key));
+    return entry == storage().end() ? defaultValue : String(reinterpret_cast<const char*>(entry->second.data()));
+  }
+  auto getString(const char* key, char* buffer, size_t length) -> size_t { return getBytes(key, buffer, length); }
+
+  auto putBool(const char* key, bool value) -> size_t { return put(key, static_cast<uint8_t>(value)); }
+  auto getBool(const char* key, bool defaultValue = false) -> bool { return get<uint8_t>(key, defaultValue) != 0; }
+  auto putUChar(const char* key, uint8_t value) -> size_t { return put(key, value); }
+  auto getUChar(const char* key, uint8_t defaultValue = 0) -> uint8_t { return get(key, defaultValue); }
+  auto putInt(const char* key, int32_t value) -> size_t { return put(key, value); }
+  auto getInt(const char* key, int32_t defaultValue = 0) -> int32_t { return get(key, defaultValue); }
+  auto putUInt(const char* key, uint32_t value) -> size_t { return put(key, value); }
+  auto getUInt(const char* key, uint32_t defaultValue = 0) -> uint32_t { return get(key, defaultValue); }
+  auto putULong(const char* key, uint32_t value) -> size_t { return put(key, value); }
+  auto getULong(const char* key, uint32_t defaultValue = 0) -> uint32_t { return get(key, defaultValue); }
+  auto putULong64(const char* key, uint64_t value) -> size_t { return put(key, value); }
+  auto getULong64(const char* key, uint64_t defaultValue = 0) -> uint64_t { return get(key, defaultValue); }
+
+private:
+  std::string space;
+
+  static auto storage() -> std::map<std::string, std::vector<uint8_t>>& {
+    static std::map<std::string, std::vector<uint8_t>> values;
+    return values;
+  }
+  auto path(const char* key) const -> std::string { return space + "/" + key; }
+
+  template <typename T>
+  auto put(const char* key, T value) -> size_t { return putBytes(key, &value, sizeof(value)); }
+  template <typename T>
+  auto get(const char* key, T defaultValue) -> T {
+    T value = defaultValue;
+    return getBytes(key, &value, sizeof(value)) == sizeof(value) ? value : defaultValue;
+  }
+};
+
+#endif // PREFERENCES_SHIM_H
@@ -0,0 +1,95 @@
+#ifndef PUBSUBCLIENT_SHIM_H
+#define PUBSUBCLIENT_SHIM_H
+
+// Always connected; publishes go nowhere but are counted so a benchmark can
+// report how much it would have sent
+
+#include <WiFi.h>
+#include <functional>
+
+#define MQTT_DISCONNECTED -1
+#define MQTT_CONNECTED 0
+
+#define MQTT_CALLBACK_SIGNATURE std::function<void(char*, uint8_t*, unsigned int)> callback
+
+class PubSubClient : public Print {
+public:
+  explicit PubSubClient(Client& client) { (void)client; }
+
+  auto setServer(const char* host, uint16_t port) -> PubSubClient& {
+    (void)host, (void)port;
+    return *this;
+  }
+  auto setCallback(MQTT_CALLBACK_SIGNATURE) -> PubSubClient& {
+    this->callback = std::move(callback);
+    return *this;
+  }
+  auto setBufferSize(uint16_t size) -> bool {
+    bufferSize = size;
+    return true;
+  }
+  auto setSocketTimeout(uint16_t seconds) -> PubSubClient& {
+    (void)seconds;
+    return *this;
+  }
+  auto setKeepAlive(uint16_t seconds) -> PubSubClient& {
+    (void)seconds;
+    return *this;
+  }
+
+  auto connect(const char* id, const char* user, const char* pass, const char* willTopic, uint8_t willQos,
+               bool willRetain, const char* willMessage) -> bool {
+    (void)id, (void)user, (void)pass, (void)willTopic, (void)willQos, (void)willRetain, (void)willMessage;
+    return true;
+  }
+  auto disconnect() -> void {}
+  auto connected() -> bool { return true; }
+  auto loop() -> bool { return true; }
+  auto state() -> int { return 0; }
+  auto subscribe(const char* topic) -> bool {
+    (void)topic;
+    return true;
+  }
+  auto unsubscribe(const char* topic) -> bool {
+    (void)topic;
+    return true;
+  }
+
+  auto publish(const char* topic, const char* payload, bool retained = false) -> bool {
+    return publish(topic, reinterpret_cast<const uint8_t*>(payload), strlen(payload), retained);
+  }
+  auto publish(const char* topic, const uint8_t* payload, unsigned int length, bool retained = false) -> bool {
+    (void)topic, (void)payload, (void)retained;
+    published++;
+    publishedBytes += length;
+    return length <= bufferSize;
+  }
+  auto beginPublish(const char* topic, unsigned int length, bool retained) -> bool {
+    (void)topic, (void)length, (void)retained;
+    return true;
+  }
+  auto write(uint8_t data) -> size_t override {
+    (void)data;
+    publishedBytes++;
+    return 1;
+  }
+  auto write(const uint8_t* data, size_t size) -> size_t override {
+    (void)data;
+    publishedBytes += size;
+    return size;
+  }
+  using Print::write;
+  auto endPublish() -> int {
+    published++;
+    return 1;
+  }
+
+  size_t published = 0;
+  size_t publishedBytes = 0;
+
+private:
+  std::function<void(char*, uint8_t*, unsigned int)> callback;
+  uint16_t bufferSize = 256;
+};
+
+#endif // PUBSUBCLIENT_SHIM_H
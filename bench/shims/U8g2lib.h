@@ -0,0 +1,58 @@
+#ifndef U8G2LIB_SHIM_H
+#define U8G2LIB_SHIM_H
+
+// A display that draws nothing. Text still goes through Print so callers pay
+// for formatting.
+
+#include <Arduino.h>
+
+#define U8G2_R0 nullptr
+#define U8X8_PIN_NONE 255
+
+extern const uint8_t u8g2_font_t0_12b_mf[];
+extern const uint8_t u8g2_font_6x10_tf[];
+
+class U8G2 : public Print {
+public:
+  auto begin() -> bool { return true; }
+  auto setFont(const uint8_t* font) -> void { (void)font; }
+  auto setDrawColor(uint8_t color) -> void { (void)color; }
+  auto setCursor(int x, int y) -> void { (void)x, (void)y; }
+  auto clearBuffer() -> void { buffer.fill(0); }
+  auto sendBuffer() -> void {}
+  auto updateDisplayArea(int x, int y, int width, int height) -> void { (void)x, (void)y, (void)width, (void)height; }
+  auto getBufferPtr() -> uint8_t* { return buffer.data(); }
+  auto getBufferTileWidth() -> uint8_t { return 16; }
+  auto getBufferTileHeight() -> uint8_t { return 8; }
+  auto getStrWidth(const char* text) -> int { return static_cast<int>(strlen(text)) * 6; }
+
+  auto drawPixel(int x, int y) -> void { (void)x, (void)y; }
+  auto drawHLine(int x, int y, int width) -> void { (void)x, (void)y, (void)width; }
+  auto drawVLine(int x, int y, int height) -> void { (void)x, (void)y, (void)height; }
+  auto drawLine(int x1, int y1, int x2, int y2) -> void { (void)x1, (void)y1, (void)x2, (void)y2; }
+  auto drawFrame(int x, int y, int width, int height) -> void { (void)x, (void)y, (void)width, (void)height; }
+  auto drawBox(int x, int y, int width, int height) -> void { (void)x, (void)y, (void)width, (void)height; }
+  auto drawTriangle(int x0, int y0, int x1, int y1, int x2, int y2) -> void {
+    (void)x0, (void)y0, (void)x1, (void)y1, (void)x2, (void)y2;
+  }
+  auto drawStr(int x, int y, const char* text) -> int {
+    (void)x, (void)y;
+    return getStrWidth(text);
+  }
+
+  auto write(uint8_t data) -> size_t override {
+    (void)data;
+    return 1;
+  }
+  using Print::write;
+
+private:
+  std::array<uint8_t, 128 * 64 / 8> buffer{};
+};
+
+class U8G2_SH1106_128X64_NONAME_F_HW_I2C : public U8G2 {
+public:
+  U8G2_SH1106_128X64_NONAME_F_HW_I2C(const void* rotation, uint8_t reset) { (void)rotation, (void)reset; }
+};
+
+#endif // U8G2LIB_SHIM_H
@@ -0,0 +1,28 @@
+#ifndef UPDATE_SHIM_H
+#define UPDATE_SHIM_H
+
+#include <Arduino.h>
+
+#define UPDATE_SIZE_UNKNOWN 0xFFFFFFFF
+
+// Accepts and discards an image
+class UpdateClass {
+public:
+  auto begin(size_t size = UPDATE_SIZE_UNKNOWN, int command = 0) -> bool {
+    (void)size, (void)command;
+    return true;
+  }
+  auto write(uint8_t* data, size_t size) -> size_t {
+    (void)data;
+    return size;
+  }
+  auto end(bool evenIfRemaining = false) -> bool {
+    (void)evenIfRemaining;
+    return true;
+  }
+  auto abort() -> void {}
+  auto hasError() -> bool { return false; }
+};
+extern UpdateClass Update;
+
+#endif // UPDATE_SHIM_H
@@ -0,0 +1,118 @@
+#ifndef WIFI_SHIM_H
+#define WIFI_SHIM_H
+
+// A station that is always connected to "bench" with a fixed address
+
+#include <Arduino.h>
+#include <IPAddress.h>
+#include <functional>
+
+enum wl_status_t {
+  WL_IDLE_STATUS = 0,
+  WL_NO_SSID_AVAIL,
+  WL_SCAN_COMPLETED,
+  WL_CONNECTED,
+  WL_CONNECT_FAILED,
+  WL_CONNECTION_LOST,
+  WL_DISCONNECTED
+};
+
+enum arduino_event_id_t {
+  ARDUINO_EVENT_WIFI_STA_START,
+  ARDUINO_EVENT_WIFI_STA_CONNECTED,
+  ARDUINO_EVENT_WIFI_STA_DISCONNECTED,
+  ARDUINO_EVENT_WIFI_STA_GOT_IP,
+  ARDUINO_EVENT_WIFI_STA_LOST_IP
+};
+
+union arduino_event_info_t {
+  struct {
+    uint8_t reason;
+  } wifi_sta_disconnected;
+};
+
+using WiFiEvent_t = arduino_event_id_t;
+using WiFiEventInfo_t = arduino_event_info_t;
+
+#define WIFI_STA 1
+
+// Connects instantly, reads nothing and swallows writes
+class Client : public Stream {
+public:
+  virtual auto connect(const char* host, uint16_t port) -> int {
+    (void)host, (void)port;
+    return 1;
+  }
+  virtual auto stop() -> void {}
+  virtual auto connected() -> uint8_t { return 1; }
+  auto available() -> int override { return 0; }
+  auto read() -> int override { return -1; }
+  auto peek() -> int override { return -1; }
+  auto write(uint8_t data) -> size_t override {
+    (void)data;
+    return 1;
+  }
+  auto write(const uint8_t* data, size_t size) -> size_t override {
+    (void)data;
+    return size;
+  }
+  using Print::write;
+};
+
+class WiFiClient : public Client {};
+
+class WiFiClass {
+public:
+  auto status() -> wl_status_t { return WL_CONNECTED; }
+  auto localIP() -> IPAddress { return {192, 168, 1, 50}; }
+  auto gatewayIP() -> IPAddress { return {192, 168, 1, 1}; }
+  auto subnetMask() -> IPAddress { return {255, 255, 255, 0}; }
+  auto dnsIP(uint8_t index = 0) -> IPAddress {
+    (void)index;
+    return {192, 168, 1, 1};
+  }
+  auto RSSI() -> int8_t { return -55; }
+  auto BSSID() -> uint8_t* { return bssid.data(); }
+  auto channel() -> int32_t { return 6; }
+  auto SSID() -> String { return "bench"; }
+  auto psk() -> String { return ""; }
+
+  auto begin() -> wl_status_t { return WL_CONNECTED; }
+  auto begin(const char* ssid, const char* passphrase = nullptr, int32_t channel = 0, const uint8_t* bssid = nullptr,
+             bool connect = true) -> wl_status_t {
+    (void)ssid, (void)passphrase, (void)channel, (void)bssid, (void)connect;
+    return WL_CONNECTED;
+  }
+  auto config(IPAddress local, IPAddress gateway, IPAddress subnet, IPAddress dns1 = IPAddress(),
+              IPAddress dns2 = IPAddress()) -> bool {
+    (void)local, (void)gateway, (void)subnet, (void)dns1, (void)dns2;
+    return true;
+  }
+  auto reconnect() -> bool { return true; }
+  auto disconnect(bool wifiOff = false) -> bool {
+    (void)wifiOff;
+    return true;
+  }
+  auto mode(int mode) -> bool {
+    (void)mode;
+    return true;
+  }
+  auto setAutoReconnect(bool enabled) -> bool {
+    (void)enabled;
+    return true;
+  }
+  auto persistent(bool enabled) -> bool {
+    (void)enabled;
+    return true;
+  }
+  auto onEvent(std::function<void(WiFiEvent_t, WiFiEventInfo_t)> handler, WiFiEvent_t event = ARDUINO_EVENT_WIFI_STA_START) -> int {
+    (void)handler, (void)event;
+    return 0;
+  }
+
+private:
+  std::array<uint8_t, 6> bssid = {0x02, 0x00, 0x00, 0x00, 0x00, 0x01};
+};
+extern WiFiClass WiFi;
+
+#endif // WIFI_SHIM_H
@@ -0,0 +1,13 @@
+#ifndef WIFICLIENTSECURE_SHIM_H
+#define WIFICLIENTSECURE_SHIM_H
+
+#include <WiFi.h>
+
+class WiFiClientSecure : public WiFiClient {
+public:
+  auto setInsecure() -> void {}
+  auto setHandshakeTimeout(unsigned long seconds) -> void { (void)seconds; }
+  auto setTimeout(unsigned long timeout) -> void { (void)timeout; }
+};
+
+#endif // WIFICLIENTSECURE_SHIM_H
@@ -0,0 +1,52 @@
+#ifndef WIFIMANAGER_SHIM_H
+#define WIFIMANAGER_SHIM_H
+
+#include <WiFi.h>
+
+class WiFiManagerParameter {
+public:
+  WiFiManagerParameter(const char* id, const char* label, const char* value, int length)
+      : value(value != nullptr ? value : "") {
+    (void)id, (void)label, (void)length;
+  }
+  auto getValue() const -> const char* { return value.c_str(); }
+  auto setValue(const char* text, int length) -> void {
+    (void)length;
+    value = text;
+  }
+
+private:
+  String value;
+};
+
+class WiFiManager {
+public:
+  auto addParameter(WiFiManagerParameter* parameter) -> void { (void)parameter; }
+  auto setSaveConfigCallback(void (*callback)()) -> void { (void)callback; }
+  auto setSaveParamsCallback(void (*callback)()) -> void { (void)callback; }
+  auto setConnectTimeout(unsigned long seconds) -> void { (void)seconds; }
+  auto setConfigPortalTimeout(unsigned long seconds) -> void { (void)seconds; }
+  auto setConfigPortalBlocking(bool blocking) -> void { (void)blocking; }
+  auto autoConnect(const char* name) -> bool {
+    (void)name;
+    return true;
+  }
+  auto startConfigPortal(const char* name) -> bool {
+    (void)name;
+    return false;
+  }
+  auto process() -> bool { return false; }
+  auto stopConfigPortal() -> bool { return true; }
+  auto getWiFiIsSaved() -> bool { return true; }
+  auto getWiFiSSID(bool persistent = true) -> String {
+    (void)persistent;
+    return "bench";
+  }
+  auto getWiFiPass(bool persistent = true) -> String {
+    (void)persistent;
+    return "";
+  }
+  auto resetSettings() -> void {}
+};
+
+#endif // WIFIMANAGER_SHIM_H
@@ -0,0 +1,19 @@
+#ifndef WIRE_SHIM_H
+#define WIRE_SHIM_H
+
+#include <Arduino.h>
+
+class TwoWire {
+public:
+  auto begin(int sda = -1, int scl = -1, uint32_t frequency = 0) -> bool {
+    (void)sda, (void)scl, (void)frequency;
+    return true;
+  }
+  auto setClock(uint32_t frequency) -> bool {
+    (void)frequency;
+    return true;
+  }
+};
+extern TwoWire Wire;
+
+#endif // WIRE_SHIM_H
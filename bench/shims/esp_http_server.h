@@ -0,0 +1,70 @@
+#ifndef ESP_HTTP_SERVER_SHIM_H
+#define ESP_HTTP_SERVER_SHIM_H
+
+// No sockets on the host: the server starts, but no request ever arrives
+
+#include <cstddef>
+#include <cstdint>
+#include <sys/types.h>
+
+using esp_err_t = int;
+#define ESP_OK 0
+#define ESP_FAIL (-1)
+
+enum http_method { HTTP_GET = 1 };
+
+using httpd_handle_t = void*;
+
+struct httpd_req_t {
+  void* user_ctx;
+};
+
+struct httpd_uri_t {
+  const char* uri;
+  http_method method;
+  esp_err_t (*handler)(httpd_req_t* request);
+  void* user_ctx;
+};
+
+struct httpd_config_t {
+  unsigned task_priority;
+  size_t stack_size;
+  int core_id;
+  uint16_t server_port;
+  uint16_t max_uri_handlers;
+};
+
+#define HTTPD_DEFAULT_CONFIG() httpd_config_t{5, 4096, 0x7FFFFFFF, 80, 8}
+
+inline auto httpd_start(httpd_handle_t* handle, const httpd_config_t* config) -> esp_err_t {
+  (void)config;
+  static int server = 0;
+  *handle = &server;
+  return ESP_OK;
+}
+inline auto httpd_register_uri_handler(httpd_handle_t handle, const httpd_uri_t* uri) -> esp_err_t {
+  (void)handle, (void)uri;
+  return ESP_OK;
+}
+inline auto httpd_resp_set_status(httpd_req_t* request, const char* status) -> esp_err_t {
+  (void)request, (void)status;
+  return ESP_OK;
+}
+inline auto httpd_resp_set_type(httpd_req_t* request, const char* type) -> esp_err_t {
+  (void)request, (void)type;
+  return ESP_OK;
+}
+inline auto httpd_resp_set_hdr(httpd_req_t* request, const char* field, const char* value) -> esp_err_t {
+  (void)request, (void)field, (void)value;
+  return ESP_OK;
+}
+inline auto httpd_resp_send(httpd_req_t* request, const char* buffer, ssize_t length) -> esp_err_t {
+  (void)request, (void)buffer, (void)length;
+  return ESP_OK;
+}
+inline auto httpd_resp_send_chunk(httpd_req_t* request, const char* buffer, ssize_t length) -> esp_err_t {
+  (void)request, (void)buffer, (void)length;
+  return ESP_OK;
+}
+
+#endif // ESP_HTTP_SERVER_SHIM_H
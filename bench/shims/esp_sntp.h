@@ -0,0 +1,10 @@
+#ifndef ESP_SNTP_SHIM_H
+#define ESP_SNTP_SHIM_H
+
+#include <sys/time.h>
+
+using sntp_sync_time_cb_t = void (*)(struct timeval* tv);
+
+inline auto sntp_set_time_sync_notification_cb(sntp_sync_time_cb_t callback) -> void { (void)callback; }
+
+#endif // ESP_SNTP_SHIM_H
@@ -0,0 +1,23 @@
+#ifndef ESP_SYSTEM_SHIM_H
+#define ESP_SYSTEM_SHIM_H
+
+#include <cstdint>
+
+enum esp_reset_reason_t {
+  ESP_RST_UNKNOWN,
+  ESP_RST_POWERON,
+  ESP_RST_EXT,
+  ESP_RST_SW,
+  ESP_RST_PANIC,
+  ESP_RST_INT_WDT,
+  ESP_RST_TASK_WDT,
+  ESP_RST_WDT,
+  ESP_RST_DEEPSLEEP,
+  ESP_RST_BROWNOUT,
+  ESP_RST_SDIO
+};
+
+inline auto esp_reset_reason() -> esp_reset_reason_t { return ESP_RST_POWERON; }
+inline auto esp_get_minimum_free_heap_size() -> uint32_t { return 0; }
+
+#endif // ESP_SYSTEM_SHIM_H
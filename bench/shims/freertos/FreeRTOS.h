@@ -0,0 +1,66 @@
+#ifndef FREERTOS_SHIM_H
+#define FREERTOS_SHIM_H
+
+// FreeRTOS as seen by a single-threaded benchmark: tasks are accepted but
+// never run, notifications and critical sections do nothing.
+
+#include <cstdint>
+
+using TaskHandle_t = void*;
+using QueueHandle_t = void*;
+using SemaphoreHandle_t = void*;
+using BaseType_t = int;
+using UBaseType_t = unsigned int;
+using TickType_t = uint32_t;
+using TaskFunction_t = void (*)(void*);
+
+#define pdTRUE 1
+#define pdFALSE 0
+#define pdPASS 1
+#define pdFAIL 0
+#define portMAX_DELAY 0xFFFFFFFFU
+#define configTICK_RATE_HZ 1000
+#define portTICK_PERIOD_MS 1
+#define pdMS_TO_TICKS(ms) (static_cast<TickType_t>(ms))
+
+struct portMUX_TYPE {
+  uint32_t owner;
+};
+#define portMUX_INITIALIZER_UNLOCKED {0}
+#define portENTER_CRITICAL(mux) (void)(mux)
+#define portEXIT_CRITICAL(mux) (void)(mux)
+#define portENTER_CRITICAL_ISR(mux) (void)(mux)
+#define portEXIT_CRITICAL_ISR(mux) (void)(mux)
+#define portYIELD_FROM_ISR(woken) (void)(woken)
+
+inline auto xTaskCreatePinnedToCore(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                                    UBaseType_t priority, TaskHandle_t* handle, BaseType_t core) -> BaseType_t {
+  (void)task, (void)name, (void)stackDepth, (void)parameter, (void)priority, (void)core;
+  if (handle != nullptr) {
+    *handle = nullptr;
+  }
+  return pdPASS;
+}
+inline auto xTaskCreate(TaskFunction_t task, const char* name, uint32_t stackDepth, void* parameter,
+                        UBaseType_t priority, TaskHandle_t* handle) -> BaseType_t {
+  return xTaskCreatePinnedToCore(task, name, stackDepth, parameter, priority, handle, 0);
+}
+inline auto vTaskDelete(TaskHandle_t task) -> void { (void)task; }
+inline auto vTaskDelay(TickType_t ticks) -> void { (void)ticks; }
+inline auto xTaskGetCurrentTaskHandle() -> TaskHandle_t { return nullptr; }
+inline auto ulTaskNotifyTake(BaseType_t clearOnExit, TickType_t ticks) -> uint32_t {
+  (void)clearOnExit, (void)ticks;
+  return 0;
+}
+inline auto xTaskNotifyGive(TaskHandle_t task) -> BaseType_t {
+  (void)task;
+  return pdPASS;
+}
+inline auto vTaskNotifyGiveFromISR(TaskHandle_t task, BaseType_t* woken) -> void { (void)task, (void)woken; }
+inline auto xPortGetCoreID() -> BaseType_t { return 1; }
+inline auto uxTaskGetStackHighWaterMark(TaskHandle_t task) -> UBaseType_t {
+  (void)task;
+  return 0;
+}
+
+#endif // FREERTOS_SHIM_H
@@ -0,0 +1,6 @@
+#ifndef FREERTOS_QUEUE_SHIM_H
+#define FREERTOS_QUEUE_SHIM_H
+
+#include "freertos/FreeRTOS.h"
+
+#endif // FREERTOS_QUEUE_SHIM_H
@@ -0,0 +1,6 @@
+#ifndef FREERTOS_SEMPHR_SHIM_H
+#define FREERTOS_SEMPHR_SHIM_H
+
+#include "freertos/FreeRTOS.h"
+
+#endif // FREERTOS_SEMPHR_SHIM_H
@@ -0,0 +1,6 @@
+#ifndef FREERTOS_TASK_SHIM_H
+#define FREERTOS_TASK_SHIM_H
+
+#include "freertos/FreeRTOS.h"
+
+#endif // FREERTOS_TASK_SHIM_H
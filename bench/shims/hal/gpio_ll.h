@@ -0,0 +1,18 @@
+#ifndef GPIO_LL_SHIM_H
+#define GPIO_LL_SHIM_H
+
+// Every pin reads high, as with the pull-ups and nothing connected
+
+enum gpio_num_t { GPIO_NUM_MAX = 40 };
+
+struct gpio_dev_t {};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+inline gpio_dev_t GPIO;
+
+inline auto gpio_ll_get_level(gpio_dev_t* hw, gpio_num_t gpio_num) -> int {
+  (void)hw, (void)gpio_num;
+  return 1;
+}
+
+#endif // GPIO_LL_SHIM_H
@@ -0,0 +1,14 @@
+#ifndef MBEDTLS_BASE64_SHIM_H
+#define MBEDTLS_BASE64_SHIM_H
+
+// Same contract as mbedTLS's decoder: whitespace-free input, padding
+// optional, nothing written unless the whole result fits
+
+#include <cstddef>
+
+#define MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL (-0x002A)
+#define MBEDTLS_ERR_BASE64_INVALID_CHARACTER (-0x002C)
+
+auto mbedtls_base64_decode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) -> int;
+
+#endif // MBEDTLS_BASE64_SHIM_H
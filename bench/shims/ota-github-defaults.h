@@ -0,0 +1,4 @@
+#ifndef OTA_GITHUB_DEFAULTS_SHIM_H
+#define OTA_GITHUB_DEFAULTS_SHIM_H
+
+#endif // OTA_GITHUB_DEFAULTS_SHIM_H
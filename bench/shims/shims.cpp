@@ -0,0 +1,139 @@
+#include <Arduino.h>
+#include <U8g2lib.h>
+#include <Update.h>
+#include <WiFi.h>
+#include <Wire.h>
+#include <chrono>
+#include <mbedtls/base64.h>
+#include <random>
+#include <thread>
+
+// NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+HardwareSerial Serial;
+EspClass ESP;
+WiFiClass WiFi;
+TwoWire Wire;
+UpdateClass Update;
+// NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+const uint8_t u8g2_font_t0_12b_mf[] = {0};
+const uint8_t u8g2_font_6x10_tf[] = {0};
+
+const auto START = std::chrono::steady_clock::now();
+const int MIN_VALID_YEAR = 2016 - 1900;
+const uint8_t BASE64_PAD = 64;
+const uint8_t BASE64_INVALID = 0xFF;
+
+auto millis() -> unsigned long {
+  return std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - START).count();
+}
+
+auto micros() -> unsigned long {
+  return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - START).count();
+}
+
+auto delay(unsigned long ms) -> void {
+  std::this_thread::sleep_for(std::chrono::milliseconds(ms));
+}
+
+auto esp_random() -> uint32_t {
+  static std::mt19937 generator(0x5EED);
+  return generator();
+}
+
+auto random(long max) -> long {
+  return max <= 0 ? 0 : static_cast<long>(esp_random() % static_cast<uint32_t>(max));
+}
+
+auto random(long min, long max) -> long {
+  return min >= max ? min : min + random(max - min);
+}
+
+auto getLocalTime(struct tm* info, uint32_t ms) -> bool {
+  (void)ms;
+  time_t const now = time(nullptr);
+  localtime_r(&now, info);
+  return info->tm_year > MIN_VALID_YEAR;
+}
+
+auto configTzTime(const char* timezone, const char* server1, const char* server2, const char* server3) -> void {
+  (void)server1, (void)server2, (void)server3;
+  setenv("TZ", timezone, 1);
+  tzset();
+}
+
+auto EspClass::restart() -> void {
+  fprintf(stderr, "ESP.restart() called\n");
+  exit(1);
+}
+
+auto EspClass::getCycleCount() -> uint32_t {
+  return static_cast<uint32_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+}
+
+#if !defined(__APPLE__) && !(defined(__GLIBC__) && defined(__GLIBC_PREREQ) && __GLIBC_PREREQ(2, 38))
+extern "C" auto strlcpy(char* destination, const char* source, size_t size) -> size_t {
+  size_t const length = strlen(source);
+  if (size > 0) {
+    size_t const copied = min(length, size - 1);
+    memcpy(destination, source, copied);
+    destination[copied] = '\0';
+  }
+  return length;
+}
+#endif
+
+static auto base64Value(unsigned char character) -> uint8_t {
+  if (character >= 'A' && character <= 'Z') {
+    return character - 'A';
+  }
+  if (character >= 'a' && character <= 'z') {
+    return character - 'a' + 26;
+  }
+  if (character >= '0' && character <= '9') {
+    return character - '0' + 52;
+  }
+  if (character == '+') {
+    return 62;
+  }
+  if (character == '/') {
+    return 63;
+  }
+  return character == '=' ? BASE64_PAD : BASE64_INVALID;
+}
+
+auto mbedtls_base64_decode(unsigned char* dst, size_t dlen, size_t* olen, const unsigned char* src, size_t slen) -> int {
+  // First pass validates and sizes, like mbedTLS does
+  size_t padding = 0;
+  for (size_t i = 0; i < slen; i++) {
+    uint8_t const value = base64Value(src[i]);
+    if (value == BASE64_INVALID || (value != BASE64_PAD && padding > 0) || padding > 2) {
+      return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+    }
+    padding += value == BASE64_PAD ? 1 : 0;
+  }
+
+  size_t const symbols = slen - padding;
+  size_t const needed = symbols / 4 * 3 + (symbols % 4 == 0 ? 0 : symbols % 4 - 1);
+  if (symbols % 4 == 1) {
+    return MBEDTLS_ERR_BASE64_INVALID_CHARACTER;
+  }
+  if (dst == nullptr || dlen < needed) {
+    *olen = needed;
+    return MBEDTLS_ERR_BASE64_BUFFER_TOO_SMALL;
+  }
+
+  uint32_t accumulator = 0;
+  int bits = 0;
+  size_t written = 0;
+  for (size_t i = 0; i < symbols; i++) {
+    accumulator = (accumulator << 6) | base64Value(src[i]);
+    bits += 6;
+    if (bits >= 8) {
+      bits -= 8;
+      dst[written++] = static_cast<unsigned char>(accumulator >> bits);
+    }
+  }
+  *olen = written;
+  return 0;
+}
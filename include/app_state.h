@@ -1,15 +1,41 @@
 #ifndef APP_STATE_H
 #define APP_STATE_H
 
+#include "change_bus.h"
 #include <Arduino.h>
-#include <memory>
+#include <array>
+#include <atomic>
 
-// DisplayState structure
-struct DisplayState {
-  String label;
-  DisplayState* subStates;
-  int numSubStates;
-  String serialAction;
+// What selecting a leaf menu node does
+enum class MenuAction : uint8_t {
+  NONE,
+  PUBLISH,
+  OTA_UPDATE
+};
+
+// Menu node in a flat table. Children of a node are stored contiguously
+// starting at firstChild; the root is always index 0 and its label is
+// supplied at runtime by AppState.
+struct MenuNode {
+  const char* label;
+  uint8_t parent;
+  uint8_t firstChild;
+  uint8_t numChildren;
+  MenuAction action;
+  const char* payload;
+};
+
+// Status and PC monitoring values, published as one consistent snapshot
+struct Telemetry {
+  bool lightStatus;
+  bool fanStatus;
+  bool pcStatus;
+  float cpuTemp;
+  float cpuUsage;
+  float gpuTemp;
+  float gpuUsage;
+  float ramUsage;
+  float gpuMemUsage;
 };
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
@@ -24,20 +50,23 @@ public:
   
   void init();
   
-  auto getRootState() -> DisplayState*;
-  auto getCurrentState() -> DisplayState*;
+  auto getCurrentLabel() const -> const char*;
+  auto getSelectedLabel() const -> const char*;
   auto getCurrentSubStateIndex() const -> int;
+  auto setRootLabel(const char* label) -> void;
 
   auto onSelect() -> void;
-  auto onNext() -> void;
-  auto onPrevious() -> void;
+  auto onNext(int steps = 1) -> void;
+  auto onPrevious(int steps = 1) -> void;
   auto tick() -> void;
 
+  // When tick() next has work (the menu timeout), if any
+  auto getTimeoutDeadline() const -> unsigned long;
+  auto hasPendingMenu() const -> bool;
+
   // Light and fan status
   auto setLightStatus(bool status) -> void;
   auto setFanStatus(bool status) -> void;
-  auto getLightStatus() const -> bool;
-  auto getFanStatus() const -> bool;
 
   // PC monitoring
   auto setPcStatus(bool status) -> void;
@@ -47,38 +76,36 @@ public:
   auto setGpuUsage(float usage) -> void;
   auto setRamUsage(float usage) -> void;
   auto setGpuMemUsage(float usage) -> void;
-  
-  auto getPcStatus() const -> bool;
-  auto getCpuTemp() const -> float;
-  auto getCpuUsage() const -> float;
-  auto getGpuTemp() const -> float;
-  auto getGpuUsage() const -> float;
-  auto getRamUsage() const -> float;
-  auto getGpuMemUsage() const -> float;
+
+  // Copies a consistent telemetry snapshot without locking and returns its
+  // generation, which only changes when a value does
+  auto getTelemetry(Telemetry& snapshot) const -> uint32_t;
+  auto getTelemetryGeneration() const -> uint32_t;
 
 private:
   // Private constructor for singleton
   AppState() = default;
   
-  std::unique_ptr<DisplayState> rootState = nullptr;
-  DisplayState* currentState = nullptr;
+  static constexpr size_t MAX_ROOT_LABEL_LENGTH = 24;
+
+  const MenuNode* menu = nullptr;
+  uint8_t currentNode = 0;
+  std::array<char, MAX_ROOT_LABEL_LENGTH> rootLabel{};
   int currentSubStateIndex = -1;
   unsigned long lastInput = -1;
   
-  // Status variables
-  bool lightStatus = false;
-  bool fanStatus = false;
-  
-  // PC monitoring variables
-  bool pcStatus = false;
-  float cpuTemp = 0.0f;
-  float cpuUsage = 0.0f;
-  float gpuTemp = 0.0f;
-  float gpuUsage = 0.0f;
-  float ramUsage = 0.0f;
-  float gpuMemUsage = 0.0f;
+  // Telemetry behind a seqlock: the sequence is odd while a write is in
+  // progress and advances by two for every published change
+  Telemetry telemetry{};
+  std::atomic<uint32_t> telemetrySequence{0};
+
+  auto setTelemetryField(bool Telemetry::*field, bool value, Change change) -> void;
+  auto setTelemetryField(float Telemetry::*field, float value, Change change) -> void;
+  auto beginTelemetryWrite() -> uint32_t;
+  auto endTelemetryWrite(uint32_t sequence) -> void;
   
   void resetToRoot();
+  void moveSelection(int delta);
 };
 
 #endif // APP_STATE_H
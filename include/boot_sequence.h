@@ -0,0 +1,75 @@
+#ifndef BOOT_SEQUENCE_H
+#define BOOT_SEQUENCE_H
+
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+// Starts a stage; runs once its dependencies are complete
+using BootStageStart = auto (*)() -> void;
+
+// Advances a running stage and returns true once it is complete. Stages
+// without one complete as soon as they are started.
+using BootStagePoll = auto (*)() -> bool;
+
+// Boot timings, in milliseconds since reset
+enum class BootMilestone : uint8_t {
+  FIRST_FRAME,
+  INPUT_READY,
+  MQTT_READY,
+  COUNT
+};
+
+// Brings up the network-dependent parts of the firmware as a dependency
+// graph of stages driven from the scheduler, so input and display work while
+// WiFi, time and MQTT are still connecting. The first stage still running is
+// shown on screen as a status line.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class BootSequence {
+public:
+  static auto getInstance() -> BootSequence&;
+
+  BootSequence(const BootSequence&) = delete;
+  auto operator=(const BootSequence&) -> BootSequence& = delete;
+
+  static constexpr uint8_t MAX_STAGES = 8;
+
+  // Returns the stage's bit for use in later stages' dependency masks
+  auto addStage(const char* name, uint8_t dependsOn, BootStageStart start, BootStagePoll poll = nullptr) -> uint8_t;
+
+  // Scheduler task body: starts every stage whose dependencies are met and
+  // polls the running ones. Returns the next poll deadline.
+  auto update(unsigned long now) -> unsigned long;
+
+  auto isComplete() const -> bool;
+
+  // Name of the first stage still running, or nullptr once boot is done
+  auto getStatusText() const -> const char*;
+
+  // Only the first call for each milestone is recorded
+  auto markMilestone(BootMilestone milestone) -> void;
+  auto getMilestone(BootMilestone milestone) const -> unsigned long;
+
+private:
+  BootSequence() = default;
+
+  static const unsigned long POLL_INTERVAL;
+
+  struct Stage {
+    const char* name;
+    uint8_t dependsOn;
+    BootStageStart start;
+    BootStagePoll poll;
+  };
+
+  std::array<Stage, MAX_STAGES> stages{};
+  uint8_t stageCount = 0;
+  uint8_t startedStages = 0;
+  // Read by the display on the loop task
+  std::atomic<uint8_t> completedStages{0};
+
+  // Marked from both schedulers
+  std::array<std::atomic<unsigned long>, static_cast<size_t>(BootMilestone::COUNT)> milestones{};
+};
+
+#endif // BOOT_SEQUENCE_H
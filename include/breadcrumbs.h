@@ -0,0 +1,87 @@
+#ifndef BREADCRUMBS_H
+#define BREADCRUMBS_H
+
+#include <Arduino.h>
+#include <array>
+
+enum class Breadcrumb : uint8_t {
+  BOOT = 1,          // value: reset reason
+  WIFI_UP,           // value: disconnect count
+  WIFI_DOWN,
+  WIFI_PORTAL,
+  MQTT_UP,
+  MQTT_LOST,         // value: PubSubClient state
+  OTA_STARTED,
+  OTA_FINISHED,      // detail: OTAManager::State
+  SLOW_TASK          // detail: scheduler task, value: milliseconds
+};
+
+struct BreadcrumbEntry {
+  uint32_t timestamp;
+  uint8_t event;
+  uint8_t detail;
+  uint16_t value;
+};
+
+// Everything kept for the next boot. Lives in RTC slow memory, so it
+// survives panics, watchdog resets and ESP.restart() but not power loss.
+struct BreadcrumbLog {
+  static constexpr size_t CAPACITY = 32;
+  static constexpr size_t CORES = 2;
+
+  uint32_t magic;
+  uint32_t bootCount;
+  uint32_t uptimeMs;        // As of the last scheduler task run
+  uint32_t minFreeHeap;
+  uint32_t maxTaskMicros;
+  uint8_t slowestTask;
+  uint8_t head;
+  uint8_t count;
+  std::array<uint8_t, CORES> runningTasks; // By core, NO_TASK between tasks
+  std::array<BreadcrumbEntry, CAPACITY> entries;
+};
+
+// Flight recorder for field resets: the last few notable events, the
+// longest scheduler task run, the heap low-water mark and the task that was
+// running, all kept across a reset. The previous boot's log is snapshotted
+// at startup and published over MQTT once connected.
+//
+// Both schedulers write breadcrumbs, so updates to the shared fields take a
+// short spinlock; each core only writes its own running task.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class Breadcrumbs {
+public:
+  static auto getInstance() -> Breadcrumbs&;
+
+  Breadcrumbs(const Breadcrumbs&) = delete;
+  auto operator=(const Breadcrumbs&) -> Breadcrumbs& = delete;
+
+  static constexpr uint8_t NO_TASK = 0xFF;
+
+  // Must run first in setup(), before anything records
+  auto init() -> void;
+
+  auto record(Breadcrumb event, uint8_t detail = 0, uint16_t value = 0) -> void;
+
+  // Called by the schedulers around every task run, on the task's own core
+  auto beginTask(uint8_t task) -> void;
+  auto endTask(uint8_t task, uint32_t elapsedMicros) -> void;
+
+  // The log left by the previous boot, nullptr after a power-on reset
+  auto getPrevious() const -> const BreadcrumbLog*;
+  auto getResetReason() const -> const char*;
+  static auto getEventName(uint8_t event) -> const char*;
+
+private:
+  Breadcrumbs() = default;
+
+  static const uint32_t SLOW_TASK_MICROS;
+  static const unsigned long HEAP_SAMPLE_INTERVAL;
+
+  BreadcrumbLog previous{};
+  bool hasPrevious = false;
+  int resetReason = 0;
+  unsigned long nextHeapSample = 0;
+};
+
+#endif // BREADCRUMBS_H
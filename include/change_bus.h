@@ -0,0 +1,53 @@
+#ifndef CHANGE_BUS_H
+#define CHANGE_BUS_H
+
+#include <Arduino.h>
+#include <atomic>
+
+// Things that can change what is on screen
+enum class Change : uint8_t {
+  MENU_LABEL,
+  MENU_NAVIGATION,
+  SIGN_IMAGE,
+  STATUS_ICONS,
+  PC_TELEMETRY,
+  BOOT_STATUS,
+  OTA_PROGRESS,
+  SCREEN_OVERWRITTEN
+};
+
+// Screen regions as dirty bits
+namespace DisplayRegion {
+  constexpr uint8_t MENU = 1 << 0;
+  constexpr uint8_t SIGN = 1 << 1;
+  constexpr uint8_t STATUS_ICONS = 1 << 2;
+  constexpr uint8_t PC_MONITORING = 1 << 3;
+  constexpr uint8_t ALL = MENU | SIGN | STATUS_ICONS | PC_MONITORING;
+} // namespace DisplayRegion
+
+// Collects change notifications from any task as per-region dirty bits for
+// Display to consume once per frame. The first change after a frame wakes
+// the loop scheduler.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class ChangeBus {
+public:
+  static auto getInstance() -> ChangeBus&;
+
+  ChangeBus(const ChangeBus&) = delete;
+  auto operator=(const ChangeBus&) -> ChangeBus& = delete;
+
+  auto publish(Change change) -> void;
+
+  // Returns the regions dirtied since the last call and clears them
+  auto takeDirtyRegions() -> uint8_t;
+  auto hasChanges() const -> bool;
+
+private:
+  ChangeBus() = default;
+
+  static auto regionsFor(Change change) -> uint8_t;
+
+  std::atomic<uint8_t> dirtyRegions{DisplayRegion::ALL};
+};
+
+#endif // CHANGE_BUS_H
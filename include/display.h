@@ -22,6 +22,23 @@ public:
   auto setLoadingMessage(const char* line1, const char* line2) -> void;
   auto setLoadingMessage(const char* line1, const char* line2, const char* line3) -> void;
 
+  static constexpr int WIDTH = 128;
+  static constexpr int HEIGHT = 64;
+
+  // The frame buffer as U8g2 keeps it: HEIGHT / 8 pages of WIDTH bytes, each
+  // byte a column of eight pixels with the top one in bit 0. Readers on
+  // other tasks can catch a frame half drawn.
+  auto getFrameBuffer() -> const uint8_t*;
+  // Frames drawn by update(), for the loop task to spot new ones
+  auto getFrameCount() const -> uint32_t;
+
+  struct TileArea {
+    uint8_t x;
+    uint8_t y;
+    uint8_t width;
+    uint8_t height;
+  };
+
 private:
   // Private constructor for singleton
   Display() = default;
@@ -29,9 +46,27 @@ private:
   // Display instance
   U8G2_SH1106_128X64_NONAME_F_HW_I2C u8g2{U8G2_R0, U8X8_PIN_NONE};
 
+  // Last telemetry snapshot, refreshed only when its generation moves
+  Telemetry telemetry{};
+  uint32_t telemetryGeneration = UINT32_MAX;
+
+  uint32_t frameCount = 0;
+
+  // A dirty bit, the tiles it owns and how to draw it
+  struct Region {
+    uint8_t bit;
+    TileArea area;
+    auto (Display::*render)() -> void;
+  };
+
   auto printCentered(const char* text, int y) -> void;
+  auto clearArea(const TileArea& area) -> void;
+  auto renderMenu() -> void;
+  auto renderOtaStatus() -> void;
+  auto renderUpdateIcon() -> void;
   auto renderSignImage() -> void;
   auto renderStatusIcons() -> void;
+  auto renderLinkIcon(int x, int baseline) -> void;
   auto renderPcMonitoring() -> void;
   auto renderIconContent(const byte* iconData, int x, int y, int iconSize, int borderSize, int paddingSize) -> void;
 };
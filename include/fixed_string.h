@@ -0,0 +1,68 @@
+#ifndef FIXED_STRING_H
+#define FIXED_STRING_H
+
+#include <Arduino.h>
+#include <array>
+#include <cstdarg>
+
+// A string with inline storage for up to N - 1 characters, for topics,
+// timestamps and labels built on repeated paths. Appending never allocates;
+// whatever doesn't fit is cut off and the string is marked truncated.
+template <size_t N>
+class FixedString {
+  static_assert(N > 1, "FixedString needs room for the terminator");
+
+public:
+  FixedString() = default;
+  explicit FixedString(const char* text) { append(text); }
+
+  auto append(const char* text) -> FixedString& { return append(text, strlen(text)); }
+
+  auto append(const char* text, size_t length) -> FixedString& {
+    size_t const room = N - 1 - used;
+    if (length > room) {
+      length = room;
+      truncated = true;
+    }
+    memcpy(&buffer[used], text, length);
+    used += length;
+    buffer[used] = '\0';
+    return *this;
+  }
+
+  auto append(char character) -> FixedString& { return append(&character, 1); }
+
+  __attribute__((format(printf, 2, 3))) auto appendf(const char* format, ...) -> FixedString& {
+    va_list arguments;
+    va_start(arguments, format);
+    int const length = vsnprintf(&buffer[used], N - used, format, arguments);
+    va_end(arguments);
+    if (length > 0) {
+      truncated = truncated || static_cast<size_t>(length) >= N - used;
+      used = min(used + static_cast<size_t>(length), N - 1);
+    }
+    return *this;
+  }
+
+  auto clear() -> void {
+    used = 0;
+    truncated = false;
+    buffer[0] = '\0';
+  }
+
+  auto c_str() const -> const char* { return buffer.data(); }
+  // Writable for APIs that only copy non-const strings (ArduinoJson < 7.3)
+  auto data() -> char* { return buffer.data(); }
+  auto length() const -> size_t { return used; }
+  auto isTruncated() const -> bool { return truncated; }
+  static constexpr auto capacity() -> size_t { return N - 1; }
+
+  auto operator==(const char* other) const -> bool { return strcmp(buffer.data(), other) == 0; }
+
+private:
+  std::array<char, N> buffer{};
+  size_t used = 0;
+  bool truncated = false;
+};
+
+#endif // FIXED_STRING_H
@@ -0,0 +1,82 @@
+#ifndef GESTURE_RECOGNIZER_H
+#define GESTURE_RECOGNIZER_H
+
+#include <Arduino.h>
+
+enum class Gesture : uint8_t {
+  NONE,
+  CLICK,
+  DOUBLE_CLICK,
+  LONG_PRESS,
+  HOLD_REPEAT
+};
+
+// Thresholds in milliseconds
+struct GestureConfig {
+  unsigned long doubleClickWindow;
+  unsigned long longPressDelay;
+  unsigned long holdRepeatInterval;
+};
+
+using GestureHandler = void (*)(uint8_t input, Gesture gesture, unsigned long timestamp);
+
+// Table-driven click/double-click/long-press/hold-repeat recognizer for one
+// input. Edges are fed with their own timestamps and timeouts fire at their
+// exact deadlines, so the emitted gestures do not depend on the loop rate.
+class GestureRecognizer {
+public:
+  auto init(uint8_t input, GestureHandler handler, const GestureConfig& config) -> void;
+
+  // Feed the current level of the input; only changes are treated as edges
+  auto feed(bool pressed, unsigned long timestamp) -> void;
+
+  // Fire any timeouts that are due by now
+  auto poll(unsigned long now) -> void;
+
+  // The next timeout, if one is pending
+  auto getDeadline(unsigned long& deadline) const -> bool;
+
+  // Completes a pending click and drops anything still held, leaving the
+  // input idle and released. Used after a replay, whose times are ahead of
+  // the real clock.
+  auto finish() -> void;
+
+  static auto getGestureName(Gesture gesture) -> const char*;
+
+private:
+  enum class State : uint8_t {
+    IDLE,
+    PRESSED,
+    RELEASED,
+    SECOND_PRESS,
+    HELD,
+    COUNT
+  };
+
+  enum class Input : uint8_t {
+    PRESS,
+    RELEASE,
+    TIMEOUT,
+    COUNT
+  };
+
+  struct Transition {
+    State next;
+    Gesture emit;
+  };
+
+  static const Transition TRANSITIONS[static_cast<int>(State::COUNT)][static_cast<int>(Input::COUNT)];
+
+  uint8_t input = 0;
+  GestureHandler handler = nullptr;
+  GestureConfig config{0, 0, 0};
+
+  State state = State::IDLE;
+  bool level = false;
+  unsigned long deadline = 0;
+
+  auto apply(Input event, unsigned long timestamp) -> void;
+  auto timeoutFor(State state) const -> unsigned long;
+};
+
+#endif // GESTURE_RECOGNIZER_H
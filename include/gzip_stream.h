@@ -0,0 +1,72 @@
+#ifndef GZIP_STREAM_H
+#define GZIP_STREAM_H
+
+#include <Arduino.h>
+#include <memory>
+#include <vector>
+
+// Receives decompressed output; returning false aborts the stream
+using GzipSink = auto (*)(const uint8_t* data, size_t length) -> bool;
+
+struct tinfl_decompressor_tag;
+
+// Streaming gzip decoder built on the ROM copy of miniz's tinfl. Compressed
+// bytes can be fed in chunks of any size; output goes to the sink as soon as
+// it is produced. RAM is bounded by the decompressor state plus the 32 KB
+// deflate window, allocated in begin() and released in end().
+class GzipStream {
+public:
+  GzipStream();
+  ~GzipStream();
+
+  GzipStream(const GzipStream&) = delete;
+  auto operator=(const GzipStream&) -> GzipStream& = delete;
+
+  auto begin(GzipSink sink) -> bool;
+  auto write(const uint8_t* data, size_t length) -> bool;
+
+  // True if the deflate stream and the gzip trailer were complete and the
+  // recorded size matches what was produced
+  auto finish() const -> bool;
+  auto end() -> void;
+
+  auto getOutputSize() const -> size_t;
+  auto getInflateMicros() const -> uint64_t;
+
+private:
+  enum class Stage : uint8_t {
+    HEADER,
+    EXTRA_LENGTH,
+    EXTRA,
+    NAME,
+    COMMENT,
+    HEADER_CRC,
+    BODY,
+    TRAILER,
+    DONE,
+    FAILED
+  };
+
+  static constexpr size_t HEADER_SIZE = 10;
+  static constexpr size_t TRAILER_SIZE = 8;
+
+  GzipSink sink = nullptr;
+  std::unique_ptr<tinfl_decompressor_tag> decompressor;
+  std::vector<uint8_t> window;
+  size_t windowOffset = 0;
+
+  Stage stage = Stage::FAILED;
+  uint8_t flags = 0;
+  size_t fieldRemaining = 0;
+  size_t fieldRead = 0;
+  uint32_t trailerSize = 0;
+
+  size_t outputSize = 0;
+  uint64_t inflateMicros = 0;
+
+  auto parseHeaderByte(uint8_t value) -> void;
+  auto nextHeaderField() -> void;
+  auto inflate(const uint8_t*& data, size_t& length) -> bool;
+};
+
+#endif // GZIP_STREAM_H
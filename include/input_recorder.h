@@ -0,0 +1,115 @@
+#ifndef INPUT_RECORDER_H
+#define INPUT_RECORDER_H
+
+#include <Arduino.h>
+#include <array>
+
+using ButtonEdgeHandler = void (*)(uint8_t input, bool pressed, unsigned long timestamp);
+using RotaryStepsHandler = void (*)(int steps);
+// Full-speed replay runs on the capture's clock: called with the time of
+// each record before it is dispatched, and once more with finished set
+// when the replay is over
+using ReplayClockHandler = void (*)(unsigned long now, bool finished);
+
+// Records button edges, encoder steps and inbound MQTT messages into a
+// binary ring buffer and replays them through the same handlers. Driven by
+// "rec ..." commands on the serial console.
+//
+// Record layout (little-endian):
+//   type:u8 length:u16 timestamp_us:u32 payload[length]
+//   BUTTON_EDGE   input:u8 pressed:u8
+//   ROTARY_STEPS  steps:i16
+//   MQTT_MESSAGE  topic_length:u8 topic payload
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class InputRecorder {
+public:
+  static auto getInstance() -> InputRecorder&;
+
+  InputRecorder(const InputRecorder&) = delete;
+  auto operator=(const InputRecorder&) -> InputRecorder& = delete;
+
+  enum class Mode : uint8_t {
+    IDLE,
+    RECORDING,
+    LOADING,
+    REPLAYING
+  };
+
+  auto init(ButtonEdgeHandler buttonHandler, RotaryStepsHandler rotaryHandler, ReplayClockHandler clockHandler) -> void;
+  auto update() -> void;
+
+  auto startRecording() -> void;
+  auto stopRecording() -> void;
+  auto dump(Print& output) const -> void;
+
+  // Real-time replay reproduces the original pacing from update(); otherwise
+  // the whole capture is pushed through back to back and timed.
+  auto startReplay(bool realtime) -> void;
+
+  auto getMode() const -> Mode;
+
+  // Scheduling: serial input waiting, and the next replay deadline
+  auto hasSerialInput() const -> bool;
+  auto getNextDeadline() const -> unsigned long;
+
+  auto recordButtonEdge(uint8_t input, bool pressed) -> void;
+  auto recordRotarySteps(int steps) -> void;
+  auto recordMqttMessage(const char* topic, const byte* payload, unsigned int length) -> void;
+
+private:
+  InputRecorder() = default;
+
+  // Host benchmarks (bench/) load and replay captures
+  friend struct NativeBench;
+
+  enum class RecordType : uint8_t {
+    BUTTON_EDGE = 1,
+    ROTARY_STEPS = 2,
+    MQTT_MESSAGE = 3
+  };
+
+  static constexpr size_t BUFFER_SIZE = 16384;
+  static constexpr size_t HEADER_SIZE = 7;
+  static constexpr size_t MAX_PAYLOAD_SIZE = 2048;
+  static constexpr size_t MAX_LINE_LENGTH = 96;
+
+  std::array<uint8_t, BUFFER_SIZE> buffer{};
+  size_t head = 0;
+  size_t used = 0;
+  size_t recordCount = 0;
+
+  Mode mode = Mode::IDLE;
+  ButtonEdgeHandler buttonHandler = nullptr;
+  RotaryStepsHandler rotaryHandler = nullptr;
+  ReplayClockHandler clockHandler = nullptr;
+
+  // Replay cursor
+  size_t replayOffset = 0;
+  uint32_t replayBaseTimestamp = 0;
+  unsigned long replayStartMicros = 0;
+  unsigned long replayStartMillis = 0;
+
+  // Serial console line buffer
+  std::array<char, MAX_LINE_LENGTH> line{};
+  size_t lineLength = 0;
+
+  // Scratch space for reassembling a record that wraps the ring
+  std::array<uint8_t, HEADER_SIZE + MAX_PAYLOAD_SIZE> scratch{};
+
+  auto append(RecordType type, const uint8_t* first, size_t firstLength, const uint8_t* second, size_t secondLength) -> void;
+  auto dropOldest() -> void;
+  auto readByte(size_t offset) const -> uint8_t;
+  auto readRecord(size_t offset, RecordType& type, uint32_t& timestamp, size_t& length) -> const uint8_t*;
+  auto dispatch(RecordType type, const uint8_t* payload, size_t length, uint32_t timestamp) -> void;
+  auto replayMillis(uint32_t timestamp) const -> unsigned long;
+  auto replayDue() -> void;
+  auto replayAll() -> void;
+  auto replayRecords() -> void;
+  auto clear() -> void;
+
+  auto pollSerial() -> void;
+  auto handleCommand(const char* command) -> void;
+  auto loadHexLine(const char* hex) -> void;
+};
+
+#endif // INPUT_RECORDER_H
@@ -0,0 +1,140 @@
+#ifndef LOG_RING_H
+#define LOG_RING_H
+
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+#include <type_traits>
+
+// Argument tags in a record's payload. Integers are stored at their own
+// width, floats as double and strings copied inline (u8 length + bytes).
+enum class LogArg : uint8_t {
+  I32 = 1,
+  U32 = 2,
+  I64 = 3,
+  U64 = 4,
+  F64 = 5,
+  STR = 6
+};
+
+// A log call captured without formatting: the format string's address
+// (its ID, resolvable from the ELF), when it happened and the raw arguments
+struct LogRecord {
+  const char* format;
+  uint32_t timestamp;
+  uint8_t level;
+  uint8_t length;
+  std::array<uint8_t, 50> payload;
+};
+
+// Packs arguments into a record payload, silently truncating what doesn't fit
+class LogEncoder {
+public:
+  LogEncoder(uint8_t* data, size_t capacity) : data(data), capacity(capacity) {}
+
+  template <typename T>
+  auto add(T value) -> std::enable_if_t<std::is_integral_v<T> || std::is_enum_v<T>> {
+    using Raw = std::conditional_t<std::is_enum_v<T>, std::underlying_type<T>, std::common_type<T>>;
+    using Integer = typename Raw::type;
+    if constexpr (std::is_signed_v<Integer>) {
+      if constexpr (sizeof(Integer) <= sizeof(int32_t)) {
+        put(LogArg::I32, static_cast<int32_t>(value));
+      } else {
+        put(LogArg::I64, static_cast<int64_t>(value));
+      }
+    } else if constexpr (sizeof(Integer) <= sizeof(uint32_t)) {
+      put(LogArg::U32, static_cast<uint32_t>(value));
+    } else {
+      put(LogArg::U64, static_cast<uint64_t>(value));
+    }
+  }
+
+  auto add(double value) -> void { put(LogArg::F64, value); }
+  auto add(const char* value) -> void;
+  auto add(const void* value) -> void { add(reinterpret_cast<uintptr_t>(value)); }
+
+  auto size() const -> uint8_t { return static_cast<uint8_t>(used); }
+
+private:
+  uint8_t* data;
+  size_t capacity;
+  size_t used = 0;
+
+  template <typename T>
+  auto put(LogArg tag, T value) -> void {
+    if (used + 1 + sizeof(T) > capacity) {
+      used = capacity; // Drop this and any later arguments
+      return;
+    }
+    data[used++] = static_cast<uint8_t>(tag);
+    memcpy(&data[used], &value, sizeof(T));
+    used += sizeof(T);
+  }
+};
+
+// Deferred logging. Callers claim a slot in a lock-free ring (a bounded
+// multi-producer queue with a sequence number per slot), copy in the format
+// pointer and raw arguments and return; a low-priority task formats and
+// writes the records to the serial port. A full ring drops messages rather
+// than blocking the caller, and the drop count is reported later.
+//
+// Build with -DLOG_BINARY_OUTPUT to write the records as binary frames
+// instead, for tools/log_decode.py to format on the host:
+//   0xA5 0x5A length:u8 format:u32 timestamp_ms:u32 level:u8 payload
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class LogRing {
+public:
+  static auto getInstance() -> LogRing&;
+
+  LogRing(const LogRing&) = delete;
+  auto operator=(const LogRing&) -> LogRing& = delete;
+
+  // Starts the drain task. Records made before this are kept until then.
+  auto init(Print& output) -> void;
+
+  template <typename... Args>
+  auto record(uint8_t level, const char* format, Args... args) -> void {
+    uint32_t position = 0;
+    LogRecord* entry = reserve(position);
+    if (entry == nullptr) {
+      return;
+    }
+    entry->format = format;
+    entry->timestamp = millis();
+    entry->level = level;
+    LogEncoder encoder(entry->payload.data(), entry->payload.size());
+    (encoder.add(args), ...);
+    entry->length = encoder.size();
+    commit(position);
+  }
+
+  // Formats a record the way printf would have; returns the text length
+  static auto format(const LogRecord& entry, char* output, size_t size) -> size_t;
+
+private:
+  LogRing();
+
+  static constexpr uint32_t SLOT_COUNT = 128; // Power of two
+  static const uint32_t TASK_STACK_SIZE;
+  static constexpr size_t LINE_LENGTH = 192;
+
+  struct Slot {
+    std::atomic<uint32_t> sequence;
+    LogRecord entry;
+  };
+
+  std::array<Slot, SLOT_COUNT> slots{};
+  std::atomic<uint32_t> enqueuePosition{0};
+  uint32_t dequeuePosition = 0;
+  std::atomic<uint32_t> dropped{0};
+  TaskHandle_t drainTask = nullptr;
+  Print* output = nullptr;
+
+  auto reserve(uint32_t& position) -> LogRecord*;
+  auto commit(uint32_t position) -> void;
+  static auto runDrainTask(void* parameter) -> void;
+  auto drain() -> void;
+  auto write(const LogRecord& entry) -> void;
+};
+
+#endif // LOG_RING_H
@@ -1,6 +1,51 @@
 #ifndef LOGGING_H
 #define LOGGING_H
 
-#define MAIN_LOG 0
+#include "log_ring.h"
+
+#define LOG_LEVEL_NONE 0
+#define LOG_LEVEL_ERROR 1
+#define LOG_LEVEL_WARNING 2
+#define LOG_LEVEL_INFO 3
+#define LOG_LEVEL_DEBUG 4
+
+// Calls below this level are compiled out, arguments included. Build with
+// -DLOG_LEVEL=LOG_LEVEL_DEBUG to get the per-message traces back.
+#ifndef LOG_LEVEL
+#define LOG_LEVEL LOG_LEVEL_INFO
+#endif
+
+// Never called; lets the compiler check format strings against arguments
+// NOLINTNEXTLINE(cert-dcl50-cpp)
+__attribute__((format(printf, 1, 2))) inline auto logFormatCheck(const char* /*format*/, ...) -> void {}
+
+// NOLINTBEGIN(cppcoreguidelines-macro-usage)
+#define LOG_DISCARD(...) do { if (false) { logFormatCheck(__VA_ARGS__); } } while (0)
+#define LOG_RECORD(level, ...) do { if (false) { logFormatCheck(__VA_ARGS__); } LogRing::getInstance().record(level, __VA_ARGS__); } while (0)
+
+#if LOG_LEVEL >= LOG_LEVEL_ERROR
+#define LOG_ERROR(...) LOG_RECORD(LOG_LEVEL_ERROR, __VA_ARGS__)
+#else
+#define LOG_ERROR(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_WARNING
+#define LOG_WARNING(...) LOG_RECORD(LOG_LEVEL_WARNING, __VA_ARGS__)
+#else
+#define LOG_WARNING(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_INFO
+#define LOG_INFO(...) LOG_RECORD(LOG_LEVEL_INFO, __VA_ARGS__)
+#else
+#define LOG_INFO(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+
+#if LOG_LEVEL >= LOG_LEVEL_DEBUG
+#define LOG_DEBUG(...) LOG_RECORD(LOG_LEVEL_DEBUG, __VA_ARGS__)
+#else
+#define LOG_DEBUG(...) LOG_DISCARD(__VA_ARGS__)
+#endif
+// NOLINTEND(cppcoreguidelines-macro-usage)
 
 #endif // LOGGING_H
@@ -0,0 +1,55 @@
+#ifndef MENU_LOADER_H
+#define MENU_LOADER_H
+
+#include "app_state.h"
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+// Bump allocator over a fixed block; reset() releases everything at once
+class MenuArena {
+public:
+  static constexpr size_t CAPACITY = 4096;
+
+  auto allocate(size_t bytes, size_t alignment) -> void*;
+  auto reset() -> void;
+  auto getUsed() const -> size_t;
+
+private:
+  alignas(MenuNode) std::array<uint8_t, CAPACITY> storage{};
+  size_t used = 0;
+};
+
+// Builds menus pushed as JSON on a retained topic, e.g.
+//   {"items":[{"label":"Office Sign","items":[{"label":"Work","action":"os-work"}]},
+//             {"label":"Update","action":"update"}]}
+// Each definition is parsed once into the idle half of a pair of arenas and
+// handed to AppState, which swaps it in between frames.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class MenuLoader {
+public:
+  static auto getInstance() -> MenuLoader&;
+
+  MenuLoader(const MenuLoader&) = delete;
+  auto operator=(const MenuLoader&) -> MenuLoader& = delete;
+
+  auto onDefinitionReceived(const byte* payload, unsigned int length) -> void;
+
+  // Returns true once per new definition. A null menu means the built-in
+  // menu should be restored.
+  auto takePendingMenu(const MenuNode*& menu) -> bool;
+  auto hasPendingMenu() const -> bool;
+
+private:
+  MenuLoader() = default;
+
+  std::array<MenuArena, 2> arenas;
+  int activeArena = -1;
+  int stagedArena = -1;
+  uint32_t lastDefinitionHash = 0;
+
+  std::atomic<bool> menuPending{false};
+  const MenuNode* pendingMenu = nullptr;
+};
+
+#endif // MENU_LOADER_H
@@ -1,11 +1,16 @@
 #ifndef MQTT_MANAGER_H
 #define MQTT_MANAGER_H
 
+#include "fixed_string.h"
+#include "gesture_recognizer.h"
+#include "ota_manager.h"
+#include "spsc_queue.h"
 #include <Arduino.h>
 #include <ArduinoJson.h>
 #include <PubSubClient.h>
 #include <WiFi.h>
 #include <WiFiManager.h>
+#include <atomic>
 
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 class MQTTManager {
@@ -17,18 +22,62 @@ public:
 
   auto init() -> void;
   auto update() -> void;
+
+  // Called from the loop task. The publish is queued for the network task,
+  // which sends it on its next pass; hasPendingPublishes() wakes it.
   auto publishButtonState(int button_num, bool pressed) -> void;
-  auto publishAction(const String& action) -> void;
+  auto publishAction(const char* action) -> void;
+  auto publishGesture(const char* input, Gesture gesture) -> void;
+  auto hasPendingPublishes() const -> bool;
+
   auto subscribeToSignImage() -> void;
   auto subscribeToStatusTopics() -> void;
   auto subscribeToPcMonitoring() -> void;
+  auto subscribeToMenuDefinition() -> void;
+  auto subscribeToMirrorConfig() -> void;
+  auto subscribeToRules() -> void;
+#ifdef PROFILING
+  // Any message on desk-control/profile/dump publishes the profiler zones
+  auto subscribeToProfileRequests() -> void;
+  auto publishProfile() -> void;
+#endif
+  auto isConnected() -> bool;
+  // PubSubClient's state() as of the last update(), readable from any task
+  auto getClientState() const -> int;
+  auto publishOtaReport(const OtaReport& report) -> void;
+#ifdef SOAK_TEST
+  // Drops the broker connection and makes a fresh one straight away, on
+  // the network task like a publish
+  auto reconnect() -> void;
+#endif
+
+  // When update() next needs to run: the next poll while connected, the
+  // next reconnect attempt otherwise
+  auto getNextDeadline() -> unsigned long;
+
+  // Inbound message dispatch, on the loop task. Messages from the broker
+  // get there through NetworkTask; input replay calls it directly.
+  static auto onMqttMessage(char* topic, byte* payload, unsigned int length) -> void;
 
 private:
   MQTTManager() = default;
+
+  // Host benchmarks (bench/) time discovery message construction
+  friend struct NativeBench;
   
   static const char* mqtt_client_id;
   static const char* mqtt_topic_prefix;
   static const unsigned long MQTT_RECONNECT_INTERVAL;
+  static const unsigned long MQTT_POLL_INTERVAL;
+  static constexpr size_t BUTTON_COUNT = 5;
+  static constexpr size_t MAX_TOPIC_LENGTH = 96;
+  static constexpr size_t MAX_TIMESTAMP_LENGTH = 32;
+  static constexpr size_t MAX_STATE_LENGTH = 32;
+  static constexpr size_t MAX_ACTION_LENGTH = 64;
+  static constexpr size_t OUTBOUND_SLOTS = 32;
+
+  using Topic = FixedString<MAX_TOPIC_LENGTH>;
+  using Timestamp = FixedString<MAX_TIMESTAMP_LENGTH>;
 
   String mqtt_server;
   int mqtt_port = 1883;
@@ -38,13 +87,49 @@ private:
   WiFiClient espClient;
   PubSubClient mqtt_client{espClient};
   unsigned long lastMqttReconnectAttempt = 0;
+  bool initialized = false;
+  bool wasConnected = false;
+  std::atomic<int> clientState{MQTT_DISCONNECTED};
+
+  // Full button press topics, built once in init()
+  std::array<Topic, BUTTON_COUNT> buttonTopics;
+
+  // Publishes from the loop task, drained at the start of update()
+  struct PublishRequest {
+    enum class Kind : uint8_t {
+      BUTTON,
+      GESTURE,
+      ACTION,
+      PROFILE,
+      RECONNECT
+    };
+
+    Kind kind;
+    uint8_t button;
+    const char* input; // Gesture input names are static
+    Gesture gesture;
+    // Copied, since a menu reload can free the menu's payload strings
+    FixedString<MAX_ACTION_LENGTH> action;
+  };
+
+  SpscQueue<PublishRequest, OUTBOUND_SLOTS> outbound;
+  uint32_t droppedPublishes = 0;
   
   auto setupMQTT() -> void;
+  auto enqueue(const PublishRequest& request) -> void;
+  auto drainPublishes() -> void;
+  auto sendRequest(const PublishRequest& request) -> void;
+  auto publishRuleTargets(const char* event, const char* timestamp) -> void;
   auto mqttReconnect() -> void;
-  auto isConnected() -> bool;
   auto publishDiscoveryMessage() -> void;
+  auto publishBootMetrics() -> void;
+  auto publishBreadcrumbs() -> void;
+  auto publishLinkStats() -> void;
   auto publishMessage(const char* topic, const char* message) -> void;
-  static auto onMqttMessage(char* topic, byte* payload, unsigned int length) -> void;
+  auto publishToTopic(const char* topic, const char* message) -> void;
+  auto publishJson(const char* topic, const JsonDocument& doc, bool retained) -> bool;
+  static auto fullTopic(const char* topic) -> Topic;
+  static auto currentTimestamp() -> Timestamp;
 };
 
 #endif // MQTT_MANAGER_H
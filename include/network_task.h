@@ -0,0 +1,66 @@
+#ifndef NETWORK_TASK_H
+#define NETWORK_TASK_H
+
+#include "fixed_string.h"
+#include "spsc_queue.h"
+#include <Arduino.h>
+#include <array>
+
+// Runs the network scheduler (WiFi, MQTT, time sync and OTA) in its own
+// FreeRTOS task on core 0, so DNS lookups, TCP connects and TLS handshakes
+// stall that task instead of input and display on core 1.
+//
+// Updates for the UI cross to the loop task through a single-producer,
+// single-consumer queue and are applied there by dispatchInbound(), so
+// AppState, SignState and the menu are only ever touched from core 1.
+// Publishes cross the other way through MQTTManager's outbound queue.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class NetworkTask {
+public:
+  static auto getInstance() -> NetworkTask&;
+
+  NetworkTask(const NetworkTask&) = delete;
+  auto operator=(const NetworkTask&) -> NetworkTask& = delete;
+
+  // Matches the MQTT client buffer, so any message it delivers fits
+  static constexpr size_t MAX_PAYLOAD_LENGTH = 2048;
+
+  // Call once the network scheduler has its tasks
+  auto start() -> void;
+
+  // Network side. An update is dropped, and false returned, when the loop
+  // task has fallen a whole queue behind.
+  auto postMessage(const char* topic, const uint8_t* payload, unsigned int length) -> bool;
+  auto postRootLabel(const char* label) -> bool;
+
+  // Loop side: scheduler ready check and task body
+  auto hasInbound() const -> bool;
+  auto dispatchInbound() -> void;
+
+private:
+  NetworkTask() = default;
+
+  static constexpr size_t INBOUND_SLOTS = 4;
+  static constexpr size_t MAX_TOPIC_LENGTH = 96;
+
+  struct InboundUpdate {
+    enum class Kind : uint8_t {
+      MQTT_MESSAGE,
+      ROOT_LABEL
+    };
+
+    Kind kind;
+    // Topic for messages, the label itself for root labels
+    FixedString<MAX_TOPIC_LENGTH> text;
+    uint16_t length;
+    std::array<uint8_t, MAX_PAYLOAD_LENGTH> payload;
+  };
+
+  SpscQueue<InboundUpdate, INBOUND_SLOTS> inbound;
+  uint32_t droppedUpdates = 0;
+
+  auto acquireSlot() -> InboundUpdate*;
+  static auto run(void* parameter) -> void;
+};
+
+#endif // NETWORK_TASK_H
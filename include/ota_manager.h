@@ -3,7 +3,35 @@
 
 #include <Arduino.h>
 #include <WiFiClientSecure.h>
+#include <array>
+#include <atomic>
 
+// Outcome of the last update attempt. bytes counts what was downloaded,
+// imageBytes what was written to flash.
+struct OtaReport {
+  const char* result;
+  bool compressed;
+  size_t bytes;
+  size_t imageBytes;
+  unsigned long durationMs;
+  unsigned long inflateMs;
+  float kilobytesPerSecond;
+};
+
+// Checks for and installs updates on a background task so input, MQTT and
+// the display keep running. The gzip-compressed image published with each
+// release is preferred and inflated straight into the inactive partition as
+// it downloads; releases without one fall back to OTA-Hub's raw download.
+// Progress is published to the display through the change bus and the
+// download can be cancelled at any point.
+//
+// Between manual updates the latest release is checked in the background
+// every few hours. The release tag and its ETag are kept in NVS and sent back
+// as If-None-Match, so an unchanged release costs one empty 304 response.
+//
+// Build with -DOTA_STAND_IN_URL=\"http://host:port\" to fetch the
+// compressed image from tools/ota_stand_in.py instead of GitHub.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 class OTAManager {
 public:
   static auto getInstance() -> OTAManager&;
@@ -11,12 +39,119 @@ public:
   OTAManager(const OTAManager&) = delete;
   auto operator=(const OTAManager&) -> OTAManager& = delete;
 
+  enum class State : uint8_t {
+    IDLE,
+    CHECKING,
+    DOWNLOADING,
+    UP_TO_DATE,
+    FAILED,
+    CANCELLED,
+    SUCCEEDED
+  };
+
   auto init() -> void;
-  auto checkForUpdate() -> void;
+
+  // Starts a check and, if there is an update, the download. Ignored while
+  // one is already running.
+  auto startUpdate() -> void;
+  auto cancel() -> void;
+
+  // Scheduler task body: starts background release checks, reports
+  // finished attempts and clears the result from the screen after a while
+  auto update(unsigned long now) -> unsigned long;
+  auto hasPendingEvent() const -> bool;
+
+  auto getState() const -> State;
+  auto isBusy() const -> bool;
+  auto getStatusText() const -> const char*;
+
+  // Bytes written so far and the image size, 0 if not known yet
+  auto getProgress(size_t& done, size_t& total) const -> void;
+  auto getKilobytesPerSecond() const -> float;
+
+  // A newer release than the running firmware was seen by the last check
+  auto isUpdateAvailable() const -> bool;
 
 private:
   OTAManager() = default;
+
+  static const unsigned long RESULT_DISPLAY_TIME;
+  static const unsigned long RESTART_DELAY;
+  static const uint32_t TASK_STACK_SIZE;
+  static const unsigned long READ_TIMEOUT;
+  static constexpr size_t CHUNK_SIZE = 1024;
+  static const unsigned long FIRST_CHECK_DELAY;
+  static const unsigned long CHECK_INTERVAL;
+  static const unsigned long CHECK_JITTER;
+  static const unsigned long CHECK_RETRY_INTERVAL;
+  static constexpr size_t MAX_ETAG_LENGTH = 96;
+  static constexpr size_t MAX_RELEASE_LENGTH = 48;
+
+  enum class DownloadResult : uint8_t {
+    UNAVAILABLE,
+    FAILED,
+    SUCCEEDED
+  };
+
+  enum class CheckResult : uint8_t {
+    NOT_MODIFIED,
+    CHANGED,
+    FAILED
+  };
+
   WiFiClientSecure wifi_client;
+  WiFiClientSecure check_client;
+#ifdef OTA_STAND_IN_URL
+  WiFiClient stand_in_client;
+#endif
+
+  std::atomic<State> state{State::IDLE};
+  std::atomic<bool> cancelRequested{false};
+  std::atomic<bool> eventPending{false};
+  std::atomic<size_t> bytesDone{0};
+  std::atomic<size_t> bytesTotal{0};
+  std::atomic<unsigned long> downloadStartedAt{0};
+  std::atomic<unsigned long> downloadFinishedAt{0};
+  bool compressed = false;
+  size_t imageBytes = 0;
+  uint64_t inflateMicros = 0;
+  int lastPercent = -1;
+
+  // Loop-side bookkeeping for showing and reporting results
+  State reportedState = State::IDLE;
+  unsigned long resultClearAt = 0;
+
+  // Background release check. The cached release is only written by the
+  // check task while checkRunning is set.
+  std::atomic<bool> checkRunning{false};
+  std::atomic<bool> checkFinished{false};
+  // A manual update started while a check was running
+  std::atomic<bool> updateDeferred{false};
+  CheckResult checkResult = CheckResult::NOT_MODIFIED;
+  std::array<char, MAX_ETAG_LENGTH> etag{};
+  std::array<char, MAX_RELEASE_LENGTH> latestTag{};
+  std::array<char, MAX_RELEASE_LENGTH> latestName{};
+  unsigned long nextCheckAt = 0;
+  std::atomic<bool> updateAvailable{false};
+
+  static auto runTask(void* parameter) -> void;
+  static auto onProgress(size_t done, size_t total) -> void;
+  static auto writeImage(const uint8_t* data, size_t length) -> bool;
+  static auto compressedImageUrl(const String& tagName) -> String;
+  static auto runCheckTask(void* parameter) -> void;
+  static auto withJitter(unsigned long interval) -> unsigned long;
+  auto launchUpdateTask() -> void;
+  auto performUpdate() -> void;
+  auto checkLatestRelease() -> CheckResult;
+  auto loadReleaseCache() -> void;
+  auto saveReleaseCache() const -> void;
+  auto isRunningLatest() const -> bool;
+  auto startCheck(unsigned long now) -> void;
+  auto updateCheck(unsigned long now) -> unsigned long;
+  auto updateResult(unsigned long now) -> unsigned long;
+  auto downloadCompressed(const String& tagName) -> DownloadResult;
+  auto setState(State next) -> void;
+  auto getReport() const -> OtaReport;
 };
 
 #endif // OTA_MANAGER_H
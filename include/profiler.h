@@ -0,0 +1,94 @@
+#ifndef PROFILER_H
+#define PROFILER_H
+
+// Scoped timing zones, compiled in only with -DPROFILING (see the
+// esp32-profile environment). Without it PROFILE_SCOPE is an empty statement
+// and nothing else is built.
+//
+//   auto Display::renderMenu() -> void {
+//     PROFILE_SCOPE("display.menu");
+//     ...
+//   }
+//
+// Sites that share a name share a zone. Zones nest, so a zone's time
+// includes any zones entered inside it. Each zone must only be entered
+// from one task.
+
+#ifdef PROFILING
+
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+struct ProfileZone {
+  static constexpr size_t BUCKETS = 16;
+
+  const char* name;
+  uint32_t count;
+  uint32_t minCycles;
+  uint32_t maxCycles;
+  uint64_t totalCycles;
+  // Bucket 0 counts runs under 1 us, bucket i runs of [2^(i-1), 2^i) us and
+  // the last one everything longer
+  std::array<uint32_t, BUCKETS> histogram;
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class Profiler {
+public:
+  static auto getInstance() -> Profiler&;
+
+  Profiler(const Profiler&) = delete;
+  auto operator=(const Profiler&) -> Profiler& = delete;
+
+  static constexpr uint8_t MAX_ZONES = 24;
+  static constexpr uint8_t NO_ZONE = 0xFF;
+
+  // Returns the zone with this name, adding it if needed; NO_ZONE when full
+  auto addZone(const char* name) -> uint8_t;
+
+  auto record(uint8_t zone, uint32_t cycles) -> void;
+  auto reset() -> void;
+
+  auto getZoneCount() const -> uint8_t;
+  auto getZone(uint8_t zone) const -> const ProfileZone&;
+  auto toMicros(uint64_t cycles) const -> uint32_t;
+
+  auto dump(Print& output) const -> void;
+
+private:
+  Profiler();
+
+  std::array<ProfileZone, MAX_ZONES> zones{};
+  std::atomic<uint8_t> zoneCount{0};
+  uint32_t cyclesPerMicro = 1;
+};
+
+// Times its own lifetime with the CPU cycle counter. The counter wraps
+// after about 17 s at 240 MHz, far beyond anything the loop should block.
+class ProfileScope {
+public:
+  explicit ProfileScope(uint8_t zone) : zone(zone), start(ESP.getCycleCount()) {}
+  ~ProfileScope() { Profiler::getInstance().record(zone, ESP.getCycleCount() - start); }
+
+  ProfileScope(const ProfileScope&) = delete;
+  auto operator=(const ProfileScope&) -> ProfileScope& = delete;
+
+private:
+  uint8_t zone;
+  uint32_t start;
+};
+
+#define PROFILE_CONCAT_INNER(a, b) a##b
+#define PROFILE_CONCAT(a, b) PROFILE_CONCAT_INNER(a, b)
+#define PROFILE_SCOPE(name)                                                                           \
+  static const uint8_t PROFILE_CONCAT(profileZone, __LINE__) = Profiler::getInstance().addZone(name); \
+  const ProfileScope PROFILE_CONCAT(profileScope, __LINE__)(PROFILE_CONCAT(profileZone, __LINE__))
+
+#else
+
+#define PROFILE_SCOPE(name) static_cast<void>(0)
+
+#endif // PROFILING
+
+#endif // PROFILER_H
@@ -2,40 +2,64 @@
 #define ROTARY_ENCODER_H
 
 #include <Arduino.h>
-#include <RotaryEncoder.h>
-#include <memory>
+#include <atomic>
 
-// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
-enum class RotaryDirection {
-  NONE,
-  CLOCKWISE,
-  COUNTERCLOCKWISE
+// Velocity-based acceleration settings for takeSteps(). Below the threshold
+// rate every detent counts as one step; from there the multiplier ramps
+// linearly up to maxMultiplier at saturationStepsPerSecond.
+struct RotaryAcceleration {
+  uint32_t thresholdStepsPerSecond;
+  uint32_t saturationStepsPerSecond;
+  uint32_t maxMultiplier;
 };
 
+using InputCallback = void (*)();
+
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
 class RotaryEncoderManager {
 public:
   static auto getInstance() -> RotaryEncoderManager&;
-  
+
   RotaryEncoderManager(const RotaryEncoderManager&) = delete;
   auto operator=(const RotaryEncoderManager&) -> RotaryEncoderManager& = delete;
-  
-  auto init() -> void;
-  auto getRotationDirection() -> RotaryDirection;
-  auto isButtonPressed() -> bool;
-  auto tick() -> void;
+
+  // onInput is called from interrupt context whenever the dial turns or its
+  // button changes, so the loop can sleep until there is input
+  auto init(InputCallback onInput = nullptr) -> void;
+  auto isButtonDown() const -> bool;
+
+  // Returns the signed number of detents turned since the last call
+  // (positive = clockwise), scaled by the configured acceleration.
+  auto takeSteps() -> int;
+  auto setAcceleration(const RotaryAcceleration& acceleration) -> void;
 
 private:
   RotaryEncoderManager() = default;
-  
-  std::unique_ptr<RotaryEncoder> encoder = nullptr;
-  bool lastButtonState = false;
-  bool currentButtonState = false;
-  
+
+  // Written from the encoder interrupt, drained by takeSteps()
+  std::atomic<int32_t> pendingSteps{0};
+
+  // Quadrature decoder state, only touched by the encoder interrupt: the
+  // last pin pair, the position in quarter steps and the position of the
+  // last detent
+  uint8_t quadratureState = 0;
+  int32_t quarterSteps = 0;
+  int32_t detentPosition = 0;
+
+  RotaryAcceleration acceleration{0, 0, 1};
+  unsigned long lastStepMicros = 0;
+
   auto checkPosition() -> void;
-  
-  // Static interrupt handler
+  auto accelerate(int rawSteps) -> int;
+  static auto readQuadrature() -> uint8_t;
+
+  // Static interrupt handler, dispatches through isrInstance so the ISR
+  // never touches the function-local static in getInstance(). The whole
+  // interrupt path is in IRAM, as GPIO interrupts also fire while flash is
+  // being written (NVS saves, OTA).
   static auto checkPositionStatic() -> void;
+  static RotaryEncoderManager* isrInstance;
+  static InputCallback inputCallback;
 };
 
 #endif // ROTARY_ENCODER_H
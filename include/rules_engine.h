@@ -0,0 +1,96 @@
+#ifndef RULES_ENGINE_H
+#define RULES_ENGINE_H
+
+#include "fixed_string.h"
+#include <Arduino.h>
+#include <array>
+
+// Local rules: input events published straight to their target devices,
+// so common toggles work without a round trip through Home Assistant and
+// keep working while it restarts. Rules come as JSON on the retained
+// desk-control/rules topic and are kept in NVS, e.g.
+//   {"button/1/pressed":[{"topic":"zigbee2mqtt/desk_lamp/set","payload":"{\"state\":\"TOGGLE\"}"}],
+//    "dial/double_click":[{"topic":"fan/set","payload":"OFF","retain":true}],
+//    "action/os-work":[{"topic":"office_sign/mode","payload":"work at {timestamp}"}]}
+// Events are named after the topics the panel publishes them on, below
+// desk-control/, with menu actions as action/<payload>. Payloads may use
+// {event} and {timestamp}. An empty definition clears the rules.
+//
+// Owned by the network task: definitions are taken from the MQTT client
+// callback and events are matched as their publishes are drained.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class RulesEngine {
+public:
+  static auto getInstance() -> RulesEngine&;
+
+  RulesEngine(const RulesEngine&) = delete;
+  auto operator=(const RulesEngine&) -> RulesEngine& = delete;
+
+  static constexpr size_t MAX_RULES = 32;
+  static constexpr size_t MAX_TARGETS = 64;
+  static constexpr size_t MAX_PAYLOAD_LENGTH = 256;
+
+  struct Target {
+    const char* topic;
+    const char* payload;
+    bool retained;
+  };
+
+  using Payload = FixedString<MAX_PAYLOAD_LENGTH + 1>;
+
+  // Loads the rules saved in NVS; call before the network task starts
+  auto init() -> void;
+
+  auto onDefinitionReceived(const byte* payload, unsigned int length) -> void;
+
+  // The targets for an event, or nullptr with count 0: one hash and, with
+  // the table at most half full, usually one probe
+  auto match(const char* event, size_t& count) const -> const Target*;
+
+  auto getRuleCount() const -> size_t;
+
+  static auto usesTimestamp(const char* payloadTemplate) -> bool;
+
+  // Fills in a target's payload template; false if it didn't fit. The
+  // timestamp may be null if usesTimestamp() is false.
+  static auto expand(const char* payloadTemplate, const char* event, const char* timestamp, Payload& out) -> bool;
+
+private:
+  RulesEngine() = default;
+
+  static constexpr size_t BUCKETS = MAX_RULES * 2;
+  static constexpr size_t STRING_BYTES = 2048;
+  static_assert((BUCKETS & (BUCKETS - 1)) == 0, "RulesEngine buckets must be a power of two");
+
+  class Parser;
+
+  struct Rule {
+    const char* event;
+    uint32_t hash;
+    uint8_t firstTarget;
+    uint8_t targetCount;
+  };
+
+  // Open addressing with linear probing; a null event marks a free bucket
+  struct Table {
+    std::array<Rule, BUCKETS> buckets;
+    std::array<Target, MAX_TARGETS> targets;
+    std::array<char, STRING_BYTES> strings;
+    size_t ruleCount;
+    size_t targetCount;
+    size_t stringBytes;
+  };
+
+  // A definition is parsed into the idle table and swapped in only if it
+  // is valid, so a bad one leaves the current rules in place
+  std::array<Table, 2> tables{};
+  size_t activeTable = 0;
+  uint32_t lastDefinitionHash = 0;
+
+  auto load(const char* json, size_t length) -> bool;
+  auto save(const byte* payload, unsigned int length) -> void;
+  static auto reset(Table& table) -> void;
+  static auto hash(const char* text, size_t length) -> uint32_t;
+};
+
+#endif // RULES_ENGINE_H
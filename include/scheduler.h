@@ -0,0 +1,114 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+// Runs a task and returns when it next wants to run, as an absolute
+// millis() deadline, or Scheduler::NO_DEADLINE to wait for an event
+using TaskCallback = auto (*)(unsigned long now) -> unsigned long;
+
+// Optional cheap check for work signalled by an event (ISR, callback)
+using TaskReadyCheck = auto (*)() -> bool;
+
+// Deadline-driven cooperative scheduler for one FreeRTOS task. Deadlines
+// live in a fixed-size min-heap; the owning task sleeps on a task
+// notification until the earliest deadline or until an event calls
+// notify()/signal().
+//
+// There are two: the loop scheduler runs input, menu and display on the
+// Arduino loop task (core 1), the network scheduler runs WiFi, MQTT, time
+// and OTA on the network task (core 0). Tasks are added and scheduled only
+// from the owning task, or before it starts; notify() and signal() are safe
+// from any task.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class Scheduler {
+public:
+  // The loop task's scheduler
+  static auto getInstance() -> Scheduler&;
+  static auto getNetworkInstance() -> Scheduler&;
+
+  Scheduler(const Scheduler&) = delete;
+  auto operator=(const Scheduler&) -> Scheduler& = delete;
+
+  static constexpr unsigned long NO_DEADLINE = 0xFFFFFFFFUL;
+  static constexpr uint8_t MAX_TASKS = 12;
+
+  // Must be called from the task that will run this scheduler
+  auto init() -> void;
+
+  auto addTask(const char* name, TaskCallback run, TaskReadyCheck ready = nullptr) -> uint8_t;
+  auto scheduleAt(uint8_t task, unsigned long deadline) -> void;
+
+  // Wake the owning task early. Signalling a task also makes it run on the
+  // next pass.
+  auto notify() -> void;
+  auto signal(uint8_t task) -> void;
+
+  // For interrupt handlers, which only ever wake the loop scheduler. In
+  // IRAM, so they can run while flash is being written.
+  static auto notifyFromIsr() -> void;
+  static auto signalFromIsr(uint8_t task) -> void;
+
+  // Block until the next deadline or notification
+  auto waitForWork() -> void;
+
+  // Run every task whose deadline has passed or whose ready check is true
+  auto runDue() -> void;
+
+  // Run counts, times and each task's share of the CPU since init(). The
+  // figures are read without locking, so from any other task they can be a
+  // run behind.
+  auto dumpStats(Print& output) const -> void;
+
+  // Task ids as seen by breadcrumbs are unique across both schedulers
+  static auto getTaskName(uint8_t id) -> const char*;
+
+private:
+  constexpr Scheduler(const char* name, uint8_t idBase) : name(name), idBase(idBase) {}
+
+  static constexpr uint8_t NETWORK_ID_BASE = 0x40;
+
+  struct Task {
+    const char* name;
+    TaskCallback run;
+    TaskReadyCheck ready;
+    unsigned long deadline;
+    int8_t heapIndex; // -1 when not scheduled
+    uint32_t runs;
+    uint64_t totalMicros;
+    uint32_t maxMicros;
+  };
+
+  // Namespace-scope rather than function-local so interrupt handlers never
+  // go through getInstance()
+  static Scheduler loopScheduler;
+
+  const char* name;
+  uint8_t idBase;
+
+  std::array<Task, MAX_TASKS> tasks{};
+  uint8_t taskCount = 0;
+
+  // Min-heap of task indices ordered by deadline
+  std::array<uint8_t, MAX_TASKS> heap{};
+  uint8_t heapSize = 0;
+
+  TaskHandle_t ownerTask = nullptr;
+  std::atomic<uint32_t> signalledTasks{0};
+
+  uint32_t wakeups = 0;
+  uint64_t sleepMicros = 0;
+  uint64_t elapsedMicros = 0;
+  unsigned long lastElapsedMark = 0;
+
+  auto isEarlier(uint8_t a, uint8_t b) const -> bool;
+  auto swapHeap(uint8_t i, uint8_t j) -> void;
+  auto siftUp(uint8_t index) -> void;
+  auto siftDown(uint8_t index) -> void;
+  auto removeFromHeap(uint8_t task) -> void;
+  auto runTask(uint8_t task, unsigned long now) -> void;
+};
+
+#endif // SCHEDULER_H
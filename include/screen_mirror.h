@@ -0,0 +1,81 @@
+#ifndef SCREEN_MIRROR_H
+#define SCREEN_MIRROR_H
+
+#include "display.h"
+#include "spsc_queue.h"
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+// Publishes the screen to desk-control/screen (retained) so dashboards can
+// show a live mirror. Only frames whose pixels changed are sent, at most
+// maxFps a second; a static screen draws no frames and costs nothing.
+//
+// Payload: width and height in pixels as one byte each, then the frame
+// buffer in the display's layout (see Display::getFrameBuffer()) compressed
+// with PackBits: a control byte n of 0-127 is followed by n + 1 literal
+// bytes, one of 129-255 by a single byte repeated 257 - n times.
+//
+// The rate is set with a number on desk-control/mirror/fps and kept in NVS;
+// 0 turns mirroring off.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class ScreenMirror {
+public:
+  static auto getInstance() -> ScreenMirror&;
+
+  ScreenMirror(const ScreenMirror&) = delete;
+  auto operator=(const ScreenMirror&) -> ScreenMirror& = delete;
+
+  static constexpr size_t FRAME_BYTES = Display::WIDTH * Display::HEIGHT / 8;
+  static constexpr size_t HEADER_BYTES = 2;
+  static constexpr size_t PACKBITS_RUN = 128;
+  static constexpr uint8_t MAX_FPS = 10;
+  // Worst case, no runs of three: a control byte per 128 literals, plus one
+  static constexpr size_t MAX_PAYLOAD_BYTES = HEADER_BYTES + FRAME_BYTES + FRAME_BYTES / PACKBITS_RUN + 1;
+
+  struct Frame {
+    uint16_t length;
+    std::array<uint8_t, MAX_PAYLOAD_BYTES> payload;
+  };
+
+  auto init() -> void;
+  auto setMaxFps(uint8_t fps) -> void;
+
+  // Loop side: scheduler ready check and task body, returns the next deadline
+  auto hasFrameDue() const -> bool;
+  auto update(unsigned long now) -> unsigned long;
+
+  // Network side: frames waiting to be published, oldest first. resend()
+  // queues the current frame again, e.g. after the broker connection was
+  // lost with frames dropped.
+  auto hasFrames() const -> bool;
+  auto nextFrame() -> const Frame*;
+  auto releaseFrame() -> void;
+  auto resend() -> void;
+
+private:
+  ScreenMirror() = default;
+
+  // Host benchmarks (bench/) time encode()
+  friend struct NativeBench;
+
+  static constexpr size_t FRAME_SLOTS = 2;
+  static const uint8_t DEFAULT_FPS;
+  static const uint32_t MAX_LOAD_PERCENT;
+
+  uint8_t maxFps = 0;
+  unsigned long frameInterval = 0;
+  unsigned long nextFrameAt = 0;
+  uint32_t mirroredFrame = UINT32_MAX;
+  bool published = false;
+  std::atomic<bool> resendRequested{false};
+
+  // The last frame queued, to skip redraws that changed no pixels
+  std::array<uint8_t, FRAME_BYTES> lastFrame{};
+
+  SpscQueue<Frame, FRAME_SLOTS> frames;
+
+  static auto encode(const uint8_t* frame, Frame& out) -> void;
+};
+
+#endif // SCREEN_MIRROR_H
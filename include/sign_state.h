@@ -15,10 +15,9 @@ public:
   auto operator=(const SignState&) -> SignState& = delete;
   
   auto init() -> void;
-  auto update() -> void;
   
-  // Called when new image data is received via MQTT
-  auto onImageReceived(const String& imageData) -> void;
+  // Called with the base64 payload of an image message received via MQTT
+  auto onImageReceived(const uint8_t* imageData, size_t length) -> void;
   
   // Get the current monochrome image data (32x8)
   auto getImageData() const -> const std::vector<uint8_t>&;
@@ -33,15 +32,18 @@ public:
 private:
   // Private constructor for singleton
   SignState() = default;
+
+  // Host benchmarks (bench/) time the conversion steps one by one
+  friend struct NativeBench;
   
   // Convert RGB image data to monochrome
-  auto convertToMonochrome(const String& base64Data) -> std::vector<uint8_t>;
+  auto convertToMonochrome(const uint8_t* base64Data, size_t length) -> std::vector<uint8_t>;
   
   // Parse BMP file and extract RGB data
   auto parseBMP(const std::vector<uint8_t>& bmpData) -> std::vector<uint8_t>;
   
   // Decode base64 string
-  auto decodeBase64(const String& encoded) -> std::vector<uint8_t>;
+  auto decodeBase64(const uint8_t* encoded, size_t encodedLen) -> std::vector<uint8_t>;
   
   std::vector<uint8_t> monochromeImageData;
   bool imageDataAvailable = false;
@@ -0,0 +1,67 @@
+#ifndef SOAK_TEST_H
+#define SOAK_TEST_H
+
+// Heap fragmentation soak test, compiled in only with -DSOAK_TEST (see the
+// esp32-soak environment). "soak [iterations]" on the serial console drives
+// simulated button presses, dial steps, inbound MQTT messages, sign images
+// and broker reconnects through the normal handlers, and logs the free heap
+// and the largest free block as it goes. A flat largest block over millions
+// of iterations means the repeated paths don't fragment the heap.
+
+#ifdef SOAK_TEST
+
+#include "input_recorder.h"
+#include <Arduino.h>
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class SoakTest {
+public:
+  static auto getInstance() -> SoakTest&;
+
+  SoakTest(const SoakTest&) = delete;
+  auto operator=(const SoakTest&) -> SoakTest& = delete;
+
+  static constexpr uint32_t DEFAULT_ITERATIONS = 1000000;
+
+  // Presses and dial steps go through the same handlers as real input
+  auto init(ButtonEdgeHandler buttonHandler, RotaryStepsHandler rotaryHandler) -> void;
+
+  auto start(uint32_t iterations) -> void;
+  auto stop() -> void;
+  auto isRunning() const -> bool;
+
+  // Runs one batch of iterations; while running the next deadline is now,
+  // so the loop comes straight back after the other due tasks
+  auto update(unsigned long now) -> unsigned long;
+
+private:
+  SoakTest() = default;
+
+  struct HeapSample {
+    uint32_t freeHeap;
+    uint32_t largestBlock;
+  };
+
+  ButtonEdgeHandler buttonHandler = nullptr;
+  RotaryStepsHandler rotaryHandler = nullptr;
+
+  bool running = false;
+  uint32_t iteration = 0;
+  uint32_t iterationLimit = 0;
+  unsigned long startMillis = 0;
+
+  // Taken after the warm-up, once one-time allocations have settled
+  HeapSample baseline{};
+  HeapSample lowest{};
+
+  auto runIteration(unsigned long now) -> void;
+  auto deliverMessage() -> void;
+  auto deliverSignImage() -> void;
+  auto trackHeap() -> void;
+  auto finish() -> void;
+  static auto sampleHeap() -> HeapSample;
+};
+
+#endif // SOAK_TEST
+
+#endif // SOAK_TEST_H
@@ -0,0 +1,78 @@
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+
+// Bounded lock-free queue between exactly one producer task and one
+// consumer task. Each side only writes its own index; the release store on
+// it publishes the slot contents to the other side.
+//
+// Large elements can be filled and read in place: the producer calls
+// acquire() and then publish(), the consumer front() and then release().
+template <typename T, size_t N>
+class SpscQueue {
+  static_assert(N > 0 && (N & (N - 1)) == 0, "SpscQueue capacity must be a power of two");
+
+public:
+  // Producer side. Returns false, leaving the queue untouched, when full.
+  auto push(const T& value) -> bool {
+    T* slot = acquire();
+    if (slot == nullptr) {
+      return false;
+    }
+    *slot = value;
+    publish();
+    return true;
+  }
+
+  // The next free slot, or nullptr when full. Invisible to the consumer
+  // until publish().
+  auto acquire() -> T* {
+    size_t const tail = tailIndex.load(std::memory_order_relaxed);
+    if (tail - headIndex.load(std::memory_order_acquire) == N) {
+      return nullptr;
+    }
+    return &slots[tail & (N - 1)];
+  }
+
+  auto publish() -> void { tailIndex.store(tailIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Consumer side. Returns false when empty.
+  auto pop(T& value) -> bool {
+    T* slot = front();
+    if (slot == nullptr) {
+      return false;
+    }
+    value = *slot;
+    release();
+    return true;
+  }
+
+  // The oldest element, or nullptr when empty. The consumer owns it, and may
+  // modify it in place, until release().
+  auto front() -> T* {
+    size_t const head = headIndex.load(std::memory_order_relaxed);
+    if (head == tailIndex.load(std::memory_order_acquire)) {
+      return nullptr;
+    }
+    return &slots[head & (N - 1)];
+  }
+
+  auto release() -> void { headIndex.store(headIndex.load(std::memory_order_relaxed) + 1, std::memory_order_release); }
+
+  // Either side; only a snapshot while the other side is running
+  auto empty() const -> bool {
+    return headIndex.load(std::memory_order_acquire) == tailIndex.load(std::memory_order_acquire);
+  }
+
+  static constexpr auto capacity() -> size_t { return N; }
+
+private:
+  std::array<T, N> slots{};
+  std::atomic<size_t> headIndex{0};
+  std::atomic<size_t> tailIndex{0};
+};
+
+#endif // SPSC_QUEUE_H
@@ -0,0 +1,55 @@
+#ifndef STATUS_SERVER_H
+#define STATUS_SERVER_H
+
+#include <Arduino.h>
+#include <array>
+#include <atomic>
+#include <esp_http_server.h>
+
+// Read-only HTTP endpoints on port 80, the address advertised as the
+// device's configuration URL:
+//   /status      JSON status, from a snapshot the loop task takes
+//   /screen.pbm  the current frame, streamed from the display's buffer
+//   /perf        scheduler statistics, and the profiler zones if built in
+//
+// Requests are served by the ESP-IDF server's own task on core 0. It never
+// takes a lock the loop task waits on: the snapshot is refreshed by the
+// loop task on request and copied out in a short critical section.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class StatusServer {
+public:
+  static auto getInstance() -> StatusServer&;
+
+  StatusServer(const StatusServer&) = delete;
+  auto operator=(const StatusServer&) -> StatusServer& = delete;
+
+  // Boot stage start, once WiFi is up
+  auto start() -> void;
+
+  // Loop side: scheduler ready check and task body
+  auto hasSnapshotRequest() const -> bool;
+  auto refreshSnapshot() -> void;
+
+private:
+  StatusServer() = default;
+
+  static constexpr size_t MAX_SNAPSHOT_LENGTH = 1024;
+  static const unsigned long SNAPSHOT_MAX_AGE;
+  static const unsigned long SNAPSHOT_WAIT;
+
+  httpd_handle_t server = nullptr;
+
+  std::array<char, MAX_SNAPSHOT_LENGTH> snapshot{};
+  size_t snapshotLength = 0;
+  portMUX_TYPE snapshotLock = portMUX_INITIALIZER_UNLOCKED;
+  std::atomic<unsigned long> snapshotTakenAt{0};
+  std::atomic<uint32_t> snapshotGeneration{0};
+  std::atomic<bool> snapshotRequested{false};
+
+  auto awaitFreshSnapshot() -> void;
+  static auto handleStatus(httpd_req_t* request) -> esp_err_t;
+  static auto handleScreen(httpd_req_t* request) -> esp_err_t;
+  static auto handlePerf(httpd_req_t* request) -> esp_err_t;
+};
+
+#endif // STATUS_SERVER_H
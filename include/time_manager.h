@@ -1,7 +1,9 @@
 #ifndef TIME_MANAGER_H
 #define TIME_MANAGER_H
 
+#include "fixed_string.h"
 #include <Arduino.h>
+#include <atomic>
 #include <sys/time.h>
 #include <time.h>
 
@@ -13,27 +15,52 @@ public:
   TimeManager(const TimeManager&) = delete;
   auto operator=(const TimeManager&) -> TimeManager& = delete;
   
+  // init() shows the last known time straight away; startSync() needs the
+  // network and starts SNTP in the background
   auto init() -> void;
+  auto startSync() -> void;
   auto update() -> void;
   auto getCurrentTimeString() const -> String;
   auto isTimeInitialized() const -> bool;
+  auto isTimeSynced() const -> bool;
   auto forceSync() -> void;
 
+  // Scheduling: when update() next has work, and whether SNTP has answered
+  auto getNextDeadline() const -> unsigned long;
+  auto hasPendingSync() const -> bool;
+
 private:
   TimeManager() = default;
+
+  // Host benchmarks (bench/) time formatTime()
+  friend struct NativeBench;
   
   static const unsigned long NTP_SYNC_INTERVAL;
-  static const unsigned long MINUTE_UPDATE_INTERVAL;
-  
+  static constexpr size_t MAX_TIME_STRING_LENGTH = 20;
+
+  using TimeString = FixedString<MAX_TIME_STRING_LENGTH>;
+
   unsigned long lastNTPSync = 0;
-  unsigned long lastMinuteUpdate = 0;
+  unsigned long nextMinuteUpdate = 0;
+  String posixTimezone;
   struct tm currentTime = {0};
   bool timeInitialized = false;
+  bool timeSynced = false;
+  bool ntpStarted = false;
+
+  // Set from the SNTP task, handled on the next update()
+  static std::atomic<bool> syncPending;
   
+  auto loadTimezone() -> void;
   auto setupNTP() -> void;
+  auto seedClock() -> bool;
+  auto onSyncReceived() -> void;
+  auto saveLastKnownTime() const -> void;
+  static auto onTimeSynced(struct timeval* tv) -> void;
   auto syncTimeFromNTP() const -> void;
   auto updateTimeDisplay() -> void;
-  auto formatTime(struct tm* timeInfo) const -> String;
+  auto scheduleNextMinute() -> void;
+  auto formatTime(struct tm* timeInfo) const -> TimeString;
 };
 
 #endif // TIME_MANAGER_H
@@ -0,0 +1,139 @@
+#ifndef WIFI_CONNECTION_H
+#define WIFI_CONNECTION_H
+
+#include <Arduino.h>
+#include <WiFi.h>
+#include <WiFiManager.h>
+#include <array>
+#include <atomic>
+
+// Connect phase durations in milliseconds from the start of the attempt
+// that succeeded
+struct WiFiTimings {
+  unsigned long associateMs;
+  unsigned long ipMs;
+  unsigned long totalMs;
+  bool fastConnect;
+};
+
+// What the status icon shows
+enum class LinkState : uint8_t {
+  CONNECTING,
+  UP,
+  RECONNECTING,
+  SETUP_PORTAL
+};
+
+// Connects to WiFi and keeps it connected without blocking. The BSSID and
+// channel of the last successful connection are cached in NVS so the next
+// boot can skip the scan; the credentials stay with the WiFi driver. The
+// address always comes from DHCP, or from the static IP configured in the
+// portal, never from an old lease. On first boot it falls back to a normal
+// connect and then to the WiFiManager portal.
+//
+// Once connected it supervises the link from WiFi events: a lost link is
+// retried with exponential backoff (never the portal), RSSI is sampled and
+// smoothed, and the time from loss to recovery is measured.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+class WiFiConnection {
+public:
+  static auto getInstance() -> WiFiConnection&;
+
+  WiFiConnection(const WiFiConnection&) = delete;
+  auto operator=(const WiFiConnection&) -> WiFiConnection& = delete;
+
+  // The portal must already have its parameters and callbacks set
+  auto begin(WiFiManager& portal) -> void;
+
+  // Scheduler task body; returns the next deadline. Events from the WiFi
+  // driver wake the scheduler and are reported by hasPendingEvent().
+  auto update(unsigned long now) -> unsigned long;
+  auto hasPendingEvent() const -> bool;
+
+  auto getLinkState() const -> LinkState;
+  auto isLinkUp() const -> bool;
+
+  // Smoothed RSSI in dBm and as 0-4 signal bars
+  auto getRssi() const -> int;
+  auto getSignalBars() const -> uint8_t;
+
+  auto getTimings() const -> const WiFiTimings&;
+  auto getDisconnectCount() const -> uint32_t;
+  auto getLastRecoveryMs() const -> unsigned long;
+
+private:
+  WiFiConnection() = default;
+
+  enum class Phase : uint8_t {
+    IDLE,
+    FAST_CONNECT,
+    CONNECT,
+    PORTAL,
+    BACKOFF,
+    CONNECTED
+  };
+
+  static const unsigned long FAST_CONNECT_TIMEOUT;
+  static const unsigned long CONNECT_TIMEOUT;
+  static const unsigned long RECONNECT_TIMEOUT;
+  static const unsigned long BACKOFF_BASE;
+  static const unsigned long BACKOFF_MAX;
+  static const unsigned long PORTAL_POLL_INTERVAL;
+  static const unsigned long RSSI_INTERVAL;
+  static constexpr uint32_t CACHE_VERSION = 3;
+  static constexpr size_t BSSID_LENGTH = 6;
+
+  // Stored as one NVS blob so it is written in a single operation
+  struct Cache {
+    uint32_t version;
+    std::array<uint8_t, BSSID_LENGTH> bssid;
+    int32_t channel;
+  };
+
+  struct StaticConfig {
+    IPAddress ip;
+    IPAddress gateway;
+    IPAddress subnet;
+    IPAddress dns;
+  };
+
+  WiFiManager* portal = nullptr;
+  // Read by the display on the loop task
+  std::atomic<Phase> phase{Phase::IDLE};
+  Cache cache{};
+  bool cacheValid = false;
+  StaticConfig staticConfig;
+  bool staticConfigured = false;
+
+  unsigned long attemptStartedAt = 0;
+  std::atomic<unsigned long> associatedAt{0};
+  std::atomic<unsigned long> gotIpAt{0};
+  std::atomic<bool> disconnected{false};
+  std::atomic<bool> eventPending{false};
+  WiFiTimings timings{};
+
+  // Recovery after the link was up at least once
+  std::atomic<bool> recovering{false};
+  uint8_t reconnectAttempts = 0;
+  unsigned long linkLostAt = 0;
+  unsigned long retryAt = 0;
+  uint32_t disconnectCount = 0;
+  unsigned long lastRecoveryMs = 0;
+
+  int rssi = 0;
+  std::atomic<uint8_t> signalBars{0};
+  unsigned long nextRssiSample = 0;
+
+  auto loadCache() -> void;
+  auto saveCache() -> void;
+  auto loadStaticConfig() -> void;
+  auto startAttempt(Phase attempt) -> void;
+  auto startPortal() -> void;
+  auto onConnected(unsigned long now) -> void;
+  auto onLinkLost(unsigned long now) -> void;
+  auto onAttemptFailed(unsigned long now) -> void;
+  auto sampleRssi(unsigned long now) -> void;
+  auto onEvent(WiFiEvent_t event) -> void;
+};
+
+#endif // WIFI_CONNECTION_H
@@ -1,99 +1,156 @@
 #include "app_state.h"
+#include "change_bus.h"
 #include "mqtt_manager.h"
 #include "display.h"
+#include "menu_loader.h"
+#include "scheduler.h"
 #include "ota_manager.h"
 #include <Arduino.h>
 
 const int TIMEOUT_MS = 3000;
 
+// Built-in menu, kept in flash
+constexpr std::array<MenuNode, 8> BUILTIN_MENU = {{
+  /* 0 */ {nullptr, 0, 1, 2, MenuAction::NONE, nullptr},
+  /* 1 */ {"Office Sign", 0, 3, 5, MenuAction::NONE, nullptr},
+  /* 2 */ {"Update", 0, 0, 0, MenuAction::OTA_UPDATE, nullptr},
+  /* 3 */ {"Work", 1, 0, 0, MenuAction::PUBLISH, "os-work"},
+  /* 4 */ {"Meeting", 1, 0, 0, MenuAction::PUBLISH, "os-meeting"},
+  /* 5 */ {"Focus", 1, 0, 0, MenuAction::PUBLISH, "os-focus"},
+  /* 6 */ {"Gaming", 1, 0, 0, MenuAction::PUBLISH, "os-play"},
+  /* 7 */ {"Free", 1, 0, 0, MenuAction::PUBLISH, "os-free"}
+}};
+
+// Every child range must stay inside the table and point back at its parent
+template <size_t N>
+constexpr auto isValidMenu(const std::array<MenuNode, N>& menu) -> bool {
+  for (size_t i = 0; i < N; i++) {
+    const MenuNode& node = menu[i];
+    if (node.numChildren > 0 && node.firstChild + node.numChildren > N) {
+      return false;
+    }
+    for (size_t child = node.firstChild; child < node.firstChild + node.numChildren; child++) {
+      if (menu[child].parent != i) {
+        return false;
+      }
+    }
+  }
+  return true;
+}
+static_assert(isValidMenu(BUILTIN_MENU), "Built-in menu table has broken links");
+
 auto AppState::getInstance() -> AppState& {
   static AppState instance;
   return instance;
 }
 
 void AppState::init() {
-  rootState = std::unique_ptr<DisplayState>(new DisplayState{
-      "Idle",
-      new DisplayState[2]{
-          {"Office Sign",
-           new DisplayState[5]{
-               {"Work", nullptr, 0, "os-work"},
-               {"Meeting", nullptr, 0, "os-meeting"},
-               {"Focus", nullptr, 0, "os-focus"},
-               {"Gaming", nullptr, 0, "os-play"},
-               {"Free", nullptr, 0, "os-free"}},
-           5, ""},
-          {"Update", nullptr, 0, "update"}},
-      2, ""});
-  currentState = rootState.get();
+  menu = BUILTIN_MENU.data();
+  setRootLabel("Idle");
+  resetToRoot();
 }
 
-auto AppState::getRootState() -> DisplayState* {
-  return rootState.get();
+auto AppState::getCurrentLabel() const -> const char* {
+  return currentNode == 0 ? rootLabel.data() : menu[currentNode].label;
 }
 
-auto AppState::getCurrentState() -> DisplayState* {
-  return currentState;
+auto AppState::getSelectedLabel() const -> const char* {
+  if (currentSubStateIndex == -1) {
+    return nullptr;
+  }
+  return menu[menu[currentNode].firstChild + currentSubStateIndex].label;
 }
 
 auto AppState::getCurrentSubStateIndex() const -> int {
   return currentSubStateIndex;
 }
 
+auto AppState::setRootLabel(const char* label) -> void {
+  if (strncmp(rootLabel.data(), label, rootLabel.size() - 1) == 0) {
+    return;
+  }
+  strncpy(rootLabel.data(), label, rootLabel.size() - 1);
+  rootLabel[rootLabel.size() - 1] = '\0';
+  ChangeBus::getInstance().publish(Change::MENU_LABEL);
+}
+
 void AppState::resetToRoot() {
-  currentState = rootState.get();
+  currentNode = 0;
   currentSubStateIndex = -1;
+  ChangeBus::getInstance().publish(Change::MENU_NAVIGATION);
 }
 
 void AppState::onSelect() {
-  lastInput = millis();
-  if (currentSubStateIndex == -1) {
-      currentSubStateIndex = 0;
-    } else {
-      // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic) - bounds-checked array access
-      DisplayState* targetState = &currentState->subStates[currentSubStateIndex];
-      if (targetState->numSubStates > 0) {
-        currentState = targetState;
-        currentSubStateIndex = 0;
-      } else if (!targetState->serialAction.isEmpty()) {
-        if (targetState->serialAction == "update") {
-          OTAManager::getInstance().checkForUpdate();
-        } else {
-        MQTTManager::getInstance().publishAction(targetState->serialAction);
-        resetToRoot();
-        lastInput = -1;
-        }
-      }
-    }
-}
+  // The dial button cancels an update while it runs
+  if (OTAManager::getInstance().isBusy()) {
+    OTAManager::getInstance().cancel();
+    return;
+  }
 
-void AppState::onNext() {
   lastInput = millis();
+  ChangeBus::getInstance().publish(Change::MENU_NAVIGATION);
   if (currentSubStateIndex == -1) {
     currentSubStateIndex = 0;
-  } else {
-    currentSubStateIndex++;
-    if (currentSubStateIndex >= currentState->numSubStates) {
-      currentSubStateIndex = 0;
-    }
-    currentSubStateIndex = currentSubStateIndex;
+    return;
   }
+
+  uint8_t const targetIndex = menu[currentNode].firstChild + currentSubStateIndex;
+  const MenuNode& target = menu[targetIndex];
+  if (target.numChildren > 0) {
+    currentNode = targetIndex;
+    currentSubStateIndex = 0;
+    return;
+  }
+
+  switch (target.action) {
+    case MenuAction::OTA_UPDATE:
+      OTAManager::getInstance().startUpdate();
+      resetToRoot();
+      lastInput = -1;
+      break;
+    case MenuAction::PUBLISH:
+      MQTTManager::getInstance().publishAction(target.payload);
+      resetToRoot();
+      lastInput = -1;
+      break;
+    default:
+      break;
+  }
+}
+
+void AppState::onNext(int steps) {
+  moveSelection(steps);
 }
 
-void AppState::onPrevious() {
+void AppState::onPrevious(int steps) {
+  moveSelection(-steps);
+}
+
+void AppState::moveSelection(int delta) {
   lastInput = millis();
+  ChangeBus::getInstance().publish(Change::MENU_NAVIGATION);
   if (currentSubStateIndex == -1) {
+    // The first detent only wakes the menu, the rest move through it
     currentSubStateIndex = 0;
-  } else {
-    currentSubStateIndex--;
-    if (currentSubStateIndex < 0) {
-      currentSubStateIndex = currentState->numSubStates - 1;
-    }
-    currentSubStateIndex = currentSubStateIndex;
+    delta += delta > 0 ? -1 : 1;
   }
+
+  int const count = menu[currentNode].numChildren;
+  if (count <= 0) {
+    return;
+  }
+  currentSubStateIndex = ((currentSubStateIndex + delta) % count + count) % count;
 }
 
 void AppState::tick() {
+  // Swap in a menu pushed over MQTT, always between frames
+  const MenuNode* loadedMenu = nullptr;
+  if (MenuLoader::getInstance().takePendingMenu(loadedMenu)) {
+    menu = loadedMenu != nullptr ? loadedMenu : BUILTIN_MENU.data();
+    resetToRoot();
+    lastInput = -1;
+  }
+
   unsigned long const time = millis();
   if (lastInput != -1 && time - lastInput > TIMEOUT_MS) {
     resetToRoot();
@@ -101,74 +158,98 @@ void AppState::tick() {
   }
 }
 
-auto AppState::setLightStatus(bool status) -> void {
-  lightStatus = status;
+auto AppState::getTimeoutDeadline() const -> unsigned long {
+  if (lastInput == static_cast<unsigned long>(-1)) {
+    return Scheduler::NO_DEADLINE;
+  }
+  return lastInput + TIMEOUT_MS + 1;
 }
 
-auto AppState::setFanStatus(bool status) -> void {
-  fanStatus = status;
+auto AppState::hasPendingMenu() const -> bool {
+  return MenuLoader::getInstance().hasPendingMenu();
 }
 
-auto AppState::getLightStatus() const -> bool {
-  return lightStatus;
+auto AppState::setLightStatus(bool status) -> void {
+  setTelemetryField(&Telemetry::lightStatus, status, Change::STATUS_ICONS);
 }
 
-auto AppState::getFanStatus() const -> bool {
-  return fanStatus;
+auto AppState::setFanStatus(bool status) -> void {
+  setTelemetryField(&Telemetry::fanStatus, status, Change::STATUS_ICONS);
 }
 
 auto AppState::setPcStatus(bool status) -> void {
-  pcStatus = status;
+  setTelemetryField(&Telemetry::pcStatus, status, Change::PC_TELEMETRY);
 }
 
 auto AppState::setCpuTemp(float temp) -> void {
-  cpuTemp = temp;
+  setTelemetryField(&Telemetry::cpuTemp, temp, Change::PC_TELEMETRY);
 }
 
 auto AppState::setCpuUsage(float usage) -> void {
-  cpuUsage = usage;
+  setTelemetryField(&Telemetry::cpuUsage, usage, Change::PC_TELEMETRY);
 }
 
 auto AppState::setGpuTemp(float temp) -> void {
-  gpuTemp = temp;
+  setTelemetryField(&Telemetry::gpuTemp, temp, Change::PC_TELEMETRY);
 }
 
 auto AppState::setGpuUsage(float usage) -> void {
-  gpuUsage = usage;
+  setTelemetryField(&Telemetry::gpuUsage, usage, Change::PC_TELEMETRY);
 }
 
 auto AppState::setRamUsage(float usage) -> void {
-  ramUsage = usage;
+  setTelemetryField(&Telemetry::ramUsage, usage, Change::PC_TELEMETRY);
 }
 
 auto AppState::setGpuMemUsage(float usage) -> void {
-  gpuMemUsage = usage;
-}
-
-auto AppState::getPcStatus() const -> bool {
-  return pcStatus;
+  setTelemetryField(&Telemetry::gpuMemUsage, usage, Change::PC_TELEMETRY);
 }
 
-auto AppState::getCpuTemp() const -> float {
-  return cpuTemp;
+// Telemetry has a single writer (the MQTT callback), so it may read the
+// fields directly; only readers go through the sequence check
+auto AppState::setTelemetryField(bool Telemetry::*field, bool value, Change change) -> void {
+  if (telemetry.*field == value) {
+    return;
+  }
+  uint32_t const sequence = beginTelemetryWrite();
+  telemetry.*field = value;
+  endTelemetryWrite(sequence);
+  ChangeBus::getInstance().publish(change);
 }
 
-auto AppState::getCpuUsage() const -> float {
-  return cpuUsage;
+auto AppState::setTelemetryField(float Telemetry::*field, float value, Change change) -> void {
+  if (telemetry.*field == value) {
+    return;
+  }
+  uint32_t const sequence = beginTelemetryWrite();
+  telemetry.*field = value;
+  endTelemetryWrite(sequence);
+  ChangeBus::getInstance().publish(change);
 }
 
-auto AppState::getGpuTemp() const -> float {
-  return gpuTemp;
+auto AppState::beginTelemetryWrite() -> uint32_t {
+  uint32_t const sequence = telemetrySequence.load(std::memory_order_relaxed) + 1;
+  telemetrySequence.store(sequence, std::memory_order_relaxed);
+  std::atomic_thread_fence(std::memory_order_release);
+  return sequence;
 }
 
-auto AppState::getGpuUsage() const -> float {
-  return gpuUsage;
+auto AppState::endTelemetryWrite(uint32_t sequence) -> void {
+  telemetrySequence.store(sequence + 1, std::memory_order_release);
 }
 
-auto AppState::getRamUsage() const -> float {
-  return ramUsage;
+auto AppState::getTelemetry(Telemetry& snapshot) const -> uint32_t {
+  uint32_t before = 0;
+  uint32_t after = 0;
+  do {
+    before = telemetrySequence.load(std::memory_order_acquire);
+    snapshot = telemetry;
+    std::atomic_thread_fence(std::memory_order_acquire);
+    after = telemetrySequence.load(std::memory_order_relaxed);
+  } while ((before & 1) != 0 || before != after);
+  return before / 2;
 }
 
-auto AppState::getGpuMemUsage() const -> float {
-  return gpuMemUsage;
+auto AppState::getTelemetryGeneration() const -> uint32_t {
+  return telemetrySequence.load(std::memory_order_acquire) / 2;
 }
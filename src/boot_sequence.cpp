@@ -0,0 +1,82 @@
+#include "boot_sequence.h"
+#include "change_bus.h"
+#include "scheduler.h"
+#include <Arduino.h>
+#include <logging.h>
+
+const unsigned long BootSequence::POLL_INTERVAL = 100;
+
+auto BootSequence::getInstance() -> BootSequence& {
+  static BootSequence instance;
+  return instance;
+}
+
+auto BootSequence::addStage(const char* name, uint8_t dependsOn, BootStageStart start, BootStagePoll poll) -> uint8_t {
+  if (stageCount >= MAX_STAGES) {
+    LOG_ERROR("Too many boot stages, cannot add: %s", name);
+    return 0;
+  }
+
+  stages[stageCount] = {name, dependsOn, start, poll};
+  return 1U << stageCount++;
+}
+
+auto BootSequence::update(unsigned long now) -> unsigned long {
+  const char* const previousStatus = getStatusText();
+
+  // A stage that completes immediately can unblock others in the same pass
+  bool progressed = true;
+  while (progressed) {
+    progressed = false;
+    for (uint8_t stage = 0; stage < stageCount; stage++) {
+      uint8_t const bit = 1U << stage;
+      if ((completedStages & bit) != 0) {
+        continue;
+      }
+
+      if ((startedStages & bit) == 0) {
+        if ((stages[stage].dependsOn & ~completedStages) != 0) {
+          continue;
+        }
+        LOG_DEBUG("Boot stage %s started at %lu ms", stages[stage].name, millis());
+        startedStages |= bit;
+        stages[stage].start();
+      }
+
+      if (stages[stage].poll == nullptr || stages[stage].poll()) {
+        LOG_INFO("Boot stage %s complete at %lu ms", stages[stage].name, millis());
+        completedStages |= bit;
+        progressed = true;
+      }
+    }
+  }
+
+  if (getStatusText() != previousStatus) {
+    ChangeBus::getInstance().publish(Change::BOOT_STATUS);
+  }
+  return isComplete() ? Scheduler::NO_DEADLINE : now + POLL_INTERVAL;
+}
+
+auto BootSequence::isComplete() const -> bool {
+  return completedStages == (1U << stageCount) - 1;
+}
+
+auto BootSequence::getStatusText() const -> const char* {
+  for (uint8_t stage = 0; stage < stageCount; stage++) {
+    if ((completedStages & (1U << stage)) == 0) {
+      return stages[stage].name;
+    }
+  }
+  return nullptr;
+}
+
+auto BootSequence::markMilestone(BootMilestone milestone) -> void {
+  auto const index = static_cast<size_t>(milestone);
+  if (milestones[index] == 0) {
+    milestones[index] = max(millis(), 1UL);
+  }
+}
+
+auto BootSequence::getMilestone(BootMilestone milestone) const -> unsigned long {
+  return milestones[static_cast<size_t>(milestone)];
+}
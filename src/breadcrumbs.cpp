@@ -0,0 +1,137 @@
+#include "breadcrumbs.h"
+#include <Arduino.h>
+#include <esp_system.h>
+#include <logging.h>
+
+const uint32_t Breadcrumbs::SLOW_TASK_MICROS = 100000;
+const unsigned long Breadcrumbs::HEAP_SAMPLE_INTERVAL = 1000;
+const uint32_t RTC_BREADCRUMB_MAGIC = 0x43524D32; // "CRM2"
+const uint32_t MICROS_PER_MILLI = 1000;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+RTC_NOINIT_ATTR BreadcrumbLog rtcBreadcrumbs;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+portMUX_TYPE breadcrumbLock = portMUX_INITIALIZER_UNLOCKED;
+
+auto Breadcrumbs::getInstance() -> Breadcrumbs& {
+  static Breadcrumbs instance;
+  return instance;
+}
+
+auto Breadcrumbs::init() -> void {
+  resetReason = esp_reset_reason();
+
+  // RTC memory holds garbage after a power-on reset
+  BreadcrumbLog& log = rtcBreadcrumbs;
+  hasPrevious = log.magic == RTC_BREADCRUMB_MAGIC && log.head < BreadcrumbLog::CAPACITY && log.count <= BreadcrumbLog::CAPACITY;
+  if (hasPrevious) {
+    previous = log;
+  }
+
+  log = {};
+  log.magic = RTC_BREADCRUMB_MAGIC;
+  log.bootCount = hasPrevious ? previous.bootCount + 1 : 1;
+  log.minFreeHeap = esp_get_minimum_free_heap_size();
+  log.slowestTask = NO_TASK;
+  log.runningTasks.fill(NO_TASK);
+  record(Breadcrumb::BOOT, 0, static_cast<uint16_t>(resetReason));
+
+  if (hasPrevious) {
+    LOG_INFO("Reset by %s after %lu ms (boot %u)", getResetReason(), static_cast<unsigned long>(previous.uptimeMs), log.bootCount);
+  }
+}
+
+auto Breadcrumbs::record(Breadcrumb event, uint8_t detail, uint16_t value) -> void {
+  BreadcrumbLog& log = rtcBreadcrumbs;
+  BreadcrumbEntry const entry = {static_cast<uint32_t>(millis()), static_cast<uint8_t>(event), detail, value};
+  portENTER_CRITICAL(&breadcrumbLock);
+  log.entries[log.head] = entry;
+  log.head = (log.head + 1) % BreadcrumbLog::CAPACITY;
+  if (log.count < BreadcrumbLog::CAPACITY) {
+    log.count++;
+  }
+  portEXIT_CRITICAL(&breadcrumbLock);
+}
+
+auto Breadcrumbs::beginTask(uint8_t task) -> void {
+  rtcBreadcrumbs.runningTasks[xPortGetCoreID()] = task;
+}
+
+auto Breadcrumbs::endTask(uint8_t task, uint32_t elapsedMicros) -> void {
+  BreadcrumbLog& log = rtcBreadcrumbs;
+  unsigned long const now = millis();
+  log.runningTasks[xPortGetCoreID()] = NO_TASK;
+
+  portENTER_CRITICAL(&breadcrumbLock);
+  log.uptimeMs = now;
+  if (elapsedMicros > log.maxTaskMicros) {
+    log.maxTaskMicros = elapsedMicros;
+    log.slowestTask = task;
+  }
+  bool const sampleHeap = static_cast<long>(now - nextHeapSample) >= 0;
+  if (sampleHeap) {
+    nextHeapSample = now + HEAP_SAMPLE_INTERVAL;
+  }
+  portEXIT_CRITICAL(&breadcrumbLock);
+
+  if (elapsedMicros >= SLOW_TASK_MICROS) {
+    record(Breadcrumb::SLOW_TASK, task, static_cast<uint16_t>(min(elapsedMicros / MICROS_PER_MILLI, static_cast<uint32_t>(UINT16_MAX))));
+  }
+  if (sampleHeap) {
+    log.minFreeHeap = esp_get_minimum_free_heap_size();
+  }
+}
+
+auto Breadcrumbs::getPrevious() const -> const BreadcrumbLog* {
+  return hasPrevious ? &previous : nullptr;
+}
+
+auto Breadcrumbs::getResetReason() const -> const char* {
+  switch (resetReason) {
+    case ESP_RST_POWERON:
+      return "power_on";
+    case ESP_RST_EXT:
+      return "external";
+    case ESP_RST_SW:
+      return "restart";
+    case ESP_RST_PANIC:
+      return "panic";
+    case ESP_RST_INT_WDT:
+      return "interrupt_watchdog";
+    case ESP_RST_TASK_WDT:
+      return "task_watchdog";
+    case ESP_RST_WDT:
+      return "watchdog";
+    case ESP_RST_DEEPSLEEP:
+      return "deep_sleep";
+    case ESP_RST_BROWNOUT:
+      return "brownout";
+    default:
+      return "unknown";
+  }
+}
+
+auto Breadcrumbs::getEventName(uint8_t event) -> const char* {
+  switch (static_cast<Breadcrumb>(event)) {
+    case Breadcrumb::BOOT:
+      return "boot";
+    case Breadcrumb::WIFI_UP:
+      return "wifi_up";
+    case Breadcrumb::WIFI_DOWN:
+      return "wifi_down";
+    case Breadcrumb::WIFI_PORTAL:
+      return "wifi_portal";
+    case Breadcrumb::MQTT_UP:
+      return "mqtt_connected";
+    case Breadcrumb::MQTT_LOST:
+      return "mqtt_lost";
+    case Breadcrumb::OTA_STARTED:
+      return "ota_started";
+    case Breadcrumb::OTA_FINISHED:
+      return "ota_finished";
+    case Breadcrumb::SLOW_TASK:
+      return "slow_task";
+    default:
+      return "unknown";
+  }
+}
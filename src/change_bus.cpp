@@ -0,0 +1,42 @@
+#include "change_bus.h"
+#include "scheduler.h"
+#include <Arduino.h>
+
+auto ChangeBus::getInstance() -> ChangeBus& {
+  static ChangeBus instance;
+  return instance;
+}
+
+auto ChangeBus::publish(Change change) -> void {
+  // Network tasks publish too, so the first change since the last frame
+  // wakes the loop task
+  if (dirtyRegions.fetch_or(regionsFor(change), std::memory_order_release) == 0) {
+    Scheduler::getInstance().notify();
+  }
+}
+
+auto ChangeBus::takeDirtyRegions() -> uint8_t {
+  return dirtyRegions.exchange(0, std::memory_order_acquire);
+}
+
+auto ChangeBus::hasChanges() const -> bool {
+  return dirtyRegions.load(std::memory_order_acquire) != 0;
+}
+
+auto ChangeBus::regionsFor(Change change) -> uint8_t {
+  switch (change) {
+    case Change::MENU_LABEL:
+    case Change::MENU_NAVIGATION:
+    case Change::BOOT_STATUS:
+    case Change::OTA_PROGRESS:
+      return DisplayRegion::MENU;
+    case Change::SIGN_IMAGE:
+      return DisplayRegion::SIGN;
+    case Change::STATUS_ICONS:
+      return DisplayRegion::STATUS_ICONS;
+    case Change::PC_TELEMETRY:
+      return DisplayRegion::PC_MONITORING;
+    default:
+      return DisplayRegion::ALL;
+  }
+}
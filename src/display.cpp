@@ -1,16 +1,27 @@
 #include "display.h"
 #include "sign_state.h"
 #include "app_state.h"
+#include "change_bus.h"
+#include "boot_sequence.h"
+#include "wifi_connection.h"
+#include "ota_manager.h"
+#include "profiler.h"
 #include <Arduino.h>
-#include <Elog.h>
 #include <logging.h>
 
-const int DISPLAY_WIDTH = 128;
+const int DISPLAY_WIDTH = Display::WIDTH;
 const int HALF_DISPLAY_WIDTH = DISPLAY_WIDTH / 2;
-const int DISPLAY_HEIGHT = 64;
+const int DISPLAY_HEIGHT = Display::HEIGHT;
 const int FONT_HEIGHT = 11;
 const int AVG_FONT_WIDTH = 6;
 const int BOX_SIZE = 8;
+const int TILE_SIZE = 8;
+
+// Tile-aligned screen areas owned by each region, in 8x8 tiles
+const Display::TileArea MENU_AREA = {0, 0, 16, 4};
+const Display::TileArea STATUS_ICONS_AREA = {0, 4, 5, 2};
+const Display::TileArea SIGN_AREA = {0, 6, 5, 2};
+const Display::TileArea PC_MONITORING_AREA = {5, 4, 11, 4};
 
 const byte LIGHT_ICON[] = {
   0b10010001,
@@ -43,42 +54,137 @@ auto Display::init() -> void {
   u8g2.begin();
   // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-array-to-pointer-decay,hicpp-no-array-decay) - U8g2 font data intentionally passed as pointer
   u8g2.setFont(u8g2_font_t0_12b_mf);
-  Logger.debug(MAIN_LOG, "Display setup complete.");
+  LOG_DEBUG("Display setup complete.");
+}
+
+auto Display::getFrameBuffer() -> const uint8_t* {
+  return u8g2.getBufferPtr();
+}
+
+auto Display::getFrameCount() const -> uint32_t {
+  return frameCount;
 }
 
 auto Display::update() -> void {
-  DisplayState* currentState = AppState::getInstance().getCurrentState();
-  int const currentSubStateIndex = AppState::getInstance().getCurrentSubStateIndex();
+  uint8_t const dirtyRegions = ChangeBus::getInstance().takeDirtyRegions();
+  if (dirtyRegions == 0) {
+    return; // Nothing changed since the last frame
+  }
 
-  // Clear the display and render content
-  u8g2.clearBuffer();
+  AppState& appState = AppState::getInstance();
+  if (appState.getTelemetryGeneration() != telemetryGeneration) {
+    telemetryGeneration = appState.getTelemetry(telemetry);
+  }
+
+  const std::array<Region, 4> regions = {{
+    {DisplayRegion::MENU, MENU_AREA, &Display::renderMenu},
+    {DisplayRegion::SIGN, SIGN_AREA, &Display::renderSignImage},
+    {DisplayRegion::STATUS_ICONS, STATUS_ICONS_AREA, &Display::renderStatusIcons},
+    {DisplayRegion::PC_MONITORING, PC_MONITORING_AREA, &Display::renderPcMonitoring}
+  }};
+
+  if (dirtyRegions == DisplayRegion::ALL) {
+    u8g2.clearBuffer();
+    for (const Region& region : regions) {
+      (this->*region.render)();
+    }
+    PROFILE_SCOPE("display.i2c");
+    u8g2.sendBuffer();
+    frameCount++;
+    return;
+  }
+
+  // Redraw and send only the tiles of the regions that changed
+  for (const Region& region : regions) {
+    if ((dirtyRegions & region.bit) == 0) {
+      continue;
+    }
+    clearArea(region.area);
+    (this->*region.render)();
+    PROFILE_SCOPE("display.i2c");
+    u8g2.updateDisplayArea(region.area.x, region.area.y, region.area.width, region.area.height);
+  }
+  frameCount++;
+}
+
+auto Display::clearArea(const TileArea& area) -> void {
+  u8g2.setDrawColor(0);
+  u8g2.drawBox(area.x * TILE_SIZE, area.y * TILE_SIZE, area.width * TILE_SIZE, area.height * TILE_SIZE);
+  u8g2.setDrawColor(1);
+}
+
+auto Display::renderMenu() -> void {
+  PROFILE_SCOPE("display.menu");
+  // An update in progress takes over the menu area
+  if (OTAManager::getInstance().getStatusText() != nullptr) {
+    renderOtaStatus();
+    return;
+  }
+
+  AppState& appState = AppState::getInstance();
 
   // Display current state label
-  printCentered(currentState->label.c_str(), FONT_HEIGHT);
+  printCentered(appState.getCurrentLabel(), FONT_HEIGHT);
 
-  // Display sub-state label if one is selected
-  if (currentSubStateIndex != -1) {
-    // NOLINTNEXTLINE(cppcoreguidelines-pro-bounds-pointer-arithmetic) - bounds-checked array access
-    DisplayState* targetState = &currentState->subStates[currentSubStateIndex];
-    printCentered(targetState->label.c_str(), FONT_HEIGHT * 2);
+  // Display sub-state label if one is selected, boot progress otherwise
+  const char* selectedLabel = appState.getSelectedLabel();
+  if (selectedLabel == nullptr) {
+    selectedLabel = BootSequence::getInstance().getStatusText();
   }
-  
-  // Render sign image if available
-  renderSignImage();
-  
-  // Render status icons
-  renderStatusIcons();
-  
-  // Render PC monitoring data
-  renderPcMonitoring();
-  
-  u8g2.sendBuffer();
+  if (selectedLabel != nullptr) {
+    printCentered(selectedLabel, FONT_HEIGHT * 2);
+  }
+
+  if (OTAManager::getInstance().isUpdateAvailable()) {
+    renderUpdateIcon();
+  }
+}
+
+// Small up arrow in the top right corner of the menu area
+auto Display::renderUpdateIcon() -> void {
+  const int arrowSize = 7;
+  const int tipX = DISPLAY_WIDTH - 1 - arrowSize / 2;
+  u8g2.drawTriangle(tipX, 0, tipX - arrowSize / 2, arrowSize / 2, tipX + arrowSize / 2, arrowSize / 2);
+  u8g2.drawVLine(tipX, 0, arrowSize);
+}
+
+auto Display::renderOtaStatus() -> void {
+  OTAManager& ota = OTAManager::getInstance();
+  if (ota.getState() != OTAManager::State::DOWNLOADING) {
+    printCentered(ota.getStatusText(), FONT_HEIGHT);
+    if (ota.isBusy()) {
+      printCentered("Press to cancel", FONT_HEIGHT * 2);
+    }
+    return;
+  }
+
+  size_t done = 0;
+  size_t total = 0;
+  ota.getProgress(done, total);
+  int const percent = total == 0 ? 0 : static_cast<int>(done * 100 / total);
+
+  const int lineLength = 24;
+  std::array<char, lineLength> line{};
+  snprintf(line.data(), line.size(), "%d%% %.0f KB/s", percent, ota.getKilobytesPerSecond());
+  printCentered(line.data(), FONT_HEIGHT);
+
+  // Progress bar below the text, inside the menu area
+  const int barMargin = 4;
+  const int barInset = 2;
+  const int barHeight = 8;
+  const int barX = barMargin;
+  const int barY = FONT_HEIGHT + barMargin;
+  const int barWidth = DISPLAY_WIDTH - 2 * barMargin;
+  int const fillWidth = total == 0 ? 0 : static_cast<int>((barWidth - 2 * barInset) * done / total);
+  u8g2.drawFrame(barX, barY, barWidth, barHeight);
+  u8g2.drawBox(barX + barInset, barY + barInset, fillWidth, barHeight - 2 * barInset);
 }
 
 auto Display::setLoadingMessage(const char* line1) -> void {
   u8g2.clearBuffer();
   printCentered(line1, DISPLAY_HEIGHT / 2 - FONT_HEIGHT / 2);
   u8g2.sendBuffer();
+  ChangeBus::getInstance().publish(Change::SCREEN_OVERWRITTEN);
 }
 
 auto Display::setLoadingMessage(const char* line1, const char* line2) -> void {
@@ -86,6 +192,7 @@ auto Display::setLoadingMessage(const char* line1, const char* line2) -> void {
   printCentered(line1, DISPLAY_HEIGHT / 2 - FONT_HEIGHT / 2);
   printCentered(line2, DISPLAY_HEIGHT / 2 + FONT_HEIGHT / 2);
   u8g2.sendBuffer();
+  ChangeBus::getInstance().publish(Change::SCREEN_OVERWRITTEN);
 }
 
 auto Display::setLoadingMessage(const char* line1, const char* line2, const char* line3) -> void {
@@ -94,6 +201,7 @@ auto Display::setLoadingMessage(const char* line1, const char* line2, const char
   printCentered(line2, DISPLAY_HEIGHT / 2);
   printCentered(line3, DISPLAY_HEIGHT / 2 + FONT_HEIGHT);
   u8g2.sendBuffer();
+  ChangeBus::getInstance().publish(Change::SCREEN_OVERWRITTEN);
 }
 
 auto Display::printCentered(const char* text, int y) -> void {
@@ -103,6 +211,7 @@ auto Display::printCentered(const char* text, int y) -> void {
 }
 
 auto Display::renderSignImage() -> void {
+  PROFILE_SCOPE("display.sign");
   SignState& signState = SignState::getInstance();
   
   if (!signState.hasImageData()) {
@@ -146,8 +255,7 @@ auto Display::renderSignImage() -> void {
 }
 
 auto Display::renderStatusIcons() -> void {
-  AppState& appState = AppState::getInstance();
-  
+  PROFILE_SCOPE("display.status");
   const int iconSize = 8;
   const int borderSize = 1;
   const int paddingSize = 2;
@@ -170,14 +278,46 @@ auto Display::renderStatusIcons() -> void {
   u8g2.drawFrame(fanX, iconsY, iconWithBorder, iconWithBorder);
   
   // Render light icon content if light is on
-  if (appState.getLightStatus()) {
+  if (telemetry.lightStatus) {
     renderIconContent(LIGHT_ICON, lightX, iconsY, iconSize, borderSize, paddingSize);
   }
   
   // Render fan icon content if fan is on
-  if (appState.getFanStatus()) {
+  if (telemetry.fanStatus) {
     renderIconContent(FAN_ICON, fanX, iconsY, iconSize, borderSize, paddingSize);
   }
+
+  // WiFi link in the gap between the two frames
+  renderLinkIcon(lightX + iconWithBorder + 1, iconsY + iconWithBorder - 2);
+}
+
+auto Display::renderLinkIcon(int x, int baseline) -> void {
+  const int barCount = 4;
+  const int barSpacing = 2;
+  const int barStep = 3;
+  const int crossSize = 5;
+
+  WiFiConnection& wifi = WiFiConnection::getInstance();
+  LinkState const state = wifi.getLinkState();
+
+  // The portal needs the user, so show a cross rather than empty bars
+  if (state == LinkState::SETUP_PORTAL) {
+    u8g2.drawLine(x, baseline - crossSize, x + crossSize, baseline);
+    u8g2.drawLine(x, baseline, x + crossSize, baseline - crossSize);
+    return;
+  }
+
+  // Signal bars while up, bare baseline dots while (re)connecting
+  uint8_t const bars = state == LinkState::UP ? wifi.getSignalBars() : 0;
+  for (int bar = 0; bar < barCount; bar++) {
+    int const barX = x + bar * barSpacing;
+    if (bar < bars) {
+      int const height = (bar + 1) * barStep;
+      u8g2.drawVLine(barX, baseline - height + 1, height);
+    } else {
+      u8g2.drawPixel(barX, baseline);
+    }
+  }
 }
 
 auto Display::renderIconContent(const byte* iconData, int x, int y, int iconSize, int borderSize, int paddingSize) -> void {
@@ -197,10 +337,9 @@ auto Display::renderIconContent(const byte* iconData, int x, int y, int iconSize
 }
 
 auto Display::renderPcMonitoring() -> void {
-  AppState& appState = AppState::getInstance();
-  
+  PROFILE_SCOPE("display.pc");
   // Only display if PC is on
-  if (!appState.getPcStatus()) {
+  if (!telemetry.pcStatus) {
     return;
   }
   
@@ -244,28 +383,28 @@ auto Display::renderPcMonitoring() -> void {
   
   // Row 2: Usage percentages
   char text[16];
-  snprintf(text, sizeof(text), "%.0f%%", appState.getCpuUsage());
+  snprintf(text, sizeof(text), "%.0f%%", telemetry.cpuUsage);
   u8g2.setCursor(cpuX, startY + lineHeight);
   u8g2.print(text);
   
-  snprintf(text, sizeof(text), "%.0f%%", appState.getGpuUsage());
+  snprintf(text, sizeof(text), "%.0f%%", telemetry.gpuUsage);
   u8g2.setCursor(gpuX, startY + lineHeight);
   u8g2.print(text);
   
-  snprintf(text, sizeof(text), "%.0f%%", appState.getRamUsage());
+  snprintf(text, sizeof(text), "%.0f%%", telemetry.ramUsage);
   u8g2.setCursor(ramX, startY + lineHeight);
   u8g2.print(text);
   
   // Row 3: Temperatures/VRAM
-  snprintf(text, sizeof(text), "%.0fC", appState.getCpuTemp());
+  snprintf(text, sizeof(text), "%.0fC", telemetry.cpuTemp);
   u8g2.setCursor(cpuX, startY + lineHeight * 2);
   u8g2.print(text);
   
-  snprintf(text, sizeof(text), "%.0fC", appState.getGpuTemp());
+  snprintf(text, sizeof(text), "%.0fC", telemetry.gpuTemp);
   u8g2.setCursor(gpuX, startY + lineHeight * 2);
   u8g2.print(text);
   
-  snprintf(text, sizeof(text), "%.0f%%", appState.getGpuMemUsage());
+  snprintf(text, sizeof(text), "%.0f%%", telemetry.gpuMemUsage);
   u8g2.setCursor(ramX, startY + lineHeight * 2);
   u8g2.print(text);
   
@@ -0,0 +1,99 @@
+#include "gesture_recognizer.h"
+#include <Arduino.h>
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+const GestureRecognizer::Transition GestureRecognizer::TRANSITIONS[static_cast<int>(State::COUNT)][static_cast<int>(Input::COUNT)] = {
+  //                 PRESS                                RELEASE                                  TIMEOUT
+  /* IDLE */         {{State::PRESSED, Gesture::NONE},     {State::IDLE, Gesture::NONE},            {State::IDLE, Gesture::NONE}},
+  /* PRESSED */      {{State::PRESSED, Gesture::NONE},     {State::RELEASED, Gesture::NONE},        {State::HELD, Gesture::LONG_PRESS}},
+  /* RELEASED */     {{State::SECOND_PRESS, Gesture::NONE}, {State::RELEASED, Gesture::NONE},       {State::IDLE, Gesture::CLICK}},
+  /* SECOND_PRESS */ {{State::SECOND_PRESS, Gesture::NONE}, {State::IDLE, Gesture::DOUBLE_CLICK},   {State::HELD, Gesture::LONG_PRESS}},
+  /* HELD */         {{State::HELD, Gesture::NONE},        {State::IDLE, Gesture::NONE},            {State::HELD, Gesture::HOLD_REPEAT}},
+};
+
+auto GestureRecognizer::init(uint8_t input, GestureHandler handler, const GestureConfig& config) -> void {
+  this->input = input;
+  this->handler = handler;
+  this->config = config;
+  state = State::IDLE;
+  level = false;
+  deadline = 0;
+}
+
+auto GestureRecognizer::feed(bool pressed, unsigned long timestamp) -> void {
+  if (pressed == level) {
+    return;
+  }
+  level = pressed;
+
+  // Anything that should have fired before this edge fires first
+  poll(timestamp);
+  apply(pressed ? Input::PRESS : Input::RELEASE, timestamp);
+}
+
+auto GestureRecognizer::poll(unsigned long now) -> void {
+  // Catch up on every deadline that has passed, each at its own timestamp
+  while (timeoutFor(state) != 0 && static_cast<long>(now - deadline) >= 0) {
+    apply(Input::TIMEOUT, deadline);
+  }
+}
+
+auto GestureRecognizer::getDeadline(unsigned long& deadline) const -> bool {
+  if (timeoutFor(state) == 0) {
+    return false;
+  }
+  deadline = this->deadline;
+  return true;
+}
+
+auto GestureRecognizer::finish() -> void {
+  if (state == State::RELEASED) {
+    apply(Input::TIMEOUT, deadline);
+  }
+  state = State::IDLE;
+  level = false;
+  deadline = 0;
+}
+
+auto GestureRecognizer::apply(Input event, unsigned long timestamp) -> void {
+  const Transition& transition = TRANSITIONS[static_cast<int>(state)][static_cast<int>(event)];
+
+  bool const changed = transition.next != state;
+  state = transition.next;
+  if (changed || event == Input::TIMEOUT) {
+    deadline = timestamp + timeoutFor(state);
+  }
+
+  if (transition.emit != Gesture::NONE && handler != nullptr) {
+    handler(input, transition.emit, timestamp);
+  }
+}
+
+auto GestureRecognizer::timeoutFor(State state) const -> unsigned long {
+  switch (state) {
+    case State::PRESSED:
+    case State::SECOND_PRESS: // A click then a hold is a long press
+      return config.longPressDelay;
+    case State::RELEASED:
+      return config.doubleClickWindow;
+    case State::HELD:
+      return config.holdRepeatInterval;
+    default:
+      return 0;
+  }
+}
+
+auto GestureRecognizer::getGestureName(Gesture gesture) -> const char* {
+  switch (gesture) {
+    case Gesture::CLICK:
+      return "click";
+    case Gesture::DOUBLE_CLICK:
+      return "double_click";
+    case Gesture::LONG_PRESS:
+      return "long_press";
+    case Gesture::HOLD_REPEAT:
+      return "hold_repeat";
+    default:
+      return "none";
+  }
+}
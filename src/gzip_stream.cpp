@@ -0,0 +1,194 @@
+#include "gzip_stream.h"
+#include <Arduino.h>
+#include <esp32/rom/miniz.h>
+
+// Header flag bits, RFC 1952
+const uint8_t GZIP_FLAG_HEADER_CRC = 0x02;
+const uint8_t GZIP_FLAG_EXTRA = 0x04;
+const uint8_t GZIP_FLAG_NAME = 0x08;
+const uint8_t GZIP_FLAG_COMMENT = 0x10;
+const uint8_t GZIP_MAGIC_1 = 0x1F;
+const uint8_t GZIP_MAGIC_2 = 0x8B;
+const uint8_t GZIP_METHOD_DEFLATE = 8;
+const size_t GZIP_FLAGS_OFFSET = 3;
+const size_t TRAILER_SIZE_OFFSET = 4;
+const int BITS_PER_BYTE = 8;
+
+GzipStream::GzipStream() = default;
+GzipStream::~GzipStream() = default;
+
+auto GzipStream::begin(GzipSink sink) -> bool {
+  this->sink = sink;
+  decompressor = std::make_unique<tinfl_decompressor>();
+  window.assign(TINFL_LZ_DICT_SIZE, 0);
+  tinfl_init(decompressor.get());
+
+  windowOffset = 0;
+  stage = Stage::HEADER;
+  flags = 0;
+  fieldRemaining = HEADER_SIZE;
+  fieldRead = 0;
+  trailerSize = 0;
+  outputSize = 0;
+  inflateMicros = 0;
+  return true;
+}
+
+auto GzipStream::end() -> void {
+  decompressor.reset();
+  window.clear();
+  window.shrink_to_fit();
+}
+
+auto GzipStream::write(const uint8_t* data, size_t length) -> bool {
+  while (length > 0) {
+    switch (stage) {
+      case Stage::BODY:
+        if (!inflate(data, length)) {
+          stage = Stage::FAILED;
+          return false;
+        }
+        break;
+      case Stage::TRAILER:
+        // CRC32 then the uncompressed size mod 2^32, little-endian. The image
+        // itself is verified by Update, so only the size is checked here.
+        if (fieldRead >= TRAILER_SIZE_OFFSET) {
+          trailerSize |= static_cast<uint32_t>(*data) << (BITS_PER_BYTE * (fieldRead - TRAILER_SIZE_OFFSET));
+        }
+        fieldRead++;
+        data++;
+        length--;
+        if (fieldRead == TRAILER_SIZE) {
+          stage = Stage::DONE;
+        }
+        break;
+      case Stage::DONE:
+        return true; // Ignore anything after the first member
+      case Stage::FAILED:
+        return false;
+      default:
+        parseHeaderByte(*data);
+        data++;
+        length--;
+        if (stage == Stage::FAILED) {
+          return false;
+        }
+        break;
+    }
+  }
+  return true;
+}
+
+auto GzipStream::parseHeaderByte(uint8_t value) -> void {
+  switch (stage) {
+    case Stage::HEADER:
+      if ((fieldRead == 0 && value != GZIP_MAGIC_1) || (fieldRead == 1 && value != GZIP_MAGIC_2)
+          || (fieldRead == 2 && value != GZIP_METHOD_DEFLATE)) {
+        stage = Stage::FAILED;
+        return;
+      }
+      if (fieldRead == GZIP_FLAGS_OFFSET) {
+        flags = value;
+      }
+      fieldRead++;
+      if (fieldRead == HEADER_SIZE) {
+        stage = Stage::EXTRA_LENGTH;
+        fieldRead = 0;
+        fieldRemaining = 0;
+        if ((flags & GZIP_FLAG_EXTRA) == 0) {
+          nextHeaderField();
+        }
+      }
+      break;
+    case Stage::EXTRA_LENGTH:
+      fieldRemaining |= static_cast<size_t>(value) << (BITS_PER_BYTE * fieldRead);
+      fieldRead++;
+      if (fieldRead == 2) {
+        stage = Stage::EXTRA;
+        if (fieldRemaining == 0) {
+          nextHeaderField();
+        }
+      }
+      break;
+    case Stage::EXTRA:
+    case Stage::HEADER_CRC:
+      if (--fieldRemaining == 0) {
+        nextHeaderField();
+      }
+      break;
+    case Stage::NAME:
+    case Stage::COMMENT:
+      if (value == 0) {
+        nextHeaderField();
+      }
+      break;
+    default:
+      break;
+  }
+}
+
+// Moves past the header field just finished to the next one the flags say
+// is present, ending at the deflate body
+auto GzipStream::nextHeaderField() -> void {
+  if (stage < Stage::NAME && (flags & GZIP_FLAG_NAME) != 0) {
+    stage = Stage::NAME;
+  } else if (stage < Stage::COMMENT && (flags & GZIP_FLAG_COMMENT) != 0) {
+    stage = Stage::COMMENT;
+  } else if (stage < Stage::HEADER_CRC && (flags & GZIP_FLAG_HEADER_CRC) != 0) {
+    stage = Stage::HEADER_CRC;
+    fieldRemaining = 2;
+  } else {
+    stage = Stage::BODY;
+  }
+}
+
+auto GzipStream::inflate(const uint8_t*& data, size_t& length) -> bool {
+  while (true) {
+    size_t inputBytes = length;
+    size_t outputBytes = window.size() - windowOffset;
+
+    unsigned long const start = micros();
+    tinfl_status const status = tinfl_decompress(decompressor.get(), data, &inputBytes,
+      window.data(), window.data() + windowOffset, &outputBytes, TINFL_FLAG_HAS_MORE_INPUT);
+    inflateMicros += micros() - start;
+
+    data += inputBytes;
+    length -= inputBytes;
+
+    if (outputBytes > 0) {
+      if (!sink(window.data() + windowOffset, outputBytes)) {
+        return false;
+      }
+      outputSize += outputBytes;
+      windowOffset = (windowOffset + outputBytes) & (window.size() - 1);
+    }
+
+    if (status == TINFL_STATUS_DONE) {
+      stage = Stage::TRAILER;
+      fieldRead = 0;
+      return true;
+    }
+    if (status < 0) {
+      return false;
+    }
+    // Either the window filled up or all input was consumed
+    if (status != TINFL_STATUS_HAS_MORE_OUTPUT && length == 0) {
+      return true;
+    }
+    if (inputBytes == 0 && outputBytes == 0) {
+      return false; // No progress possible
+    }
+  }
+}
+
+auto GzipStream::finish() const -> bool {
+  return stage == Stage::DONE && trailerSize == static_cast<uint32_t>(outputSize);
+}
+
+auto GzipStream::getOutputSize() const -> size_t {
+  return outputSize;
+}
+
+auto GzipStream::getInflateMicros() const -> uint64_t {
+  return inflateMicros;
+}
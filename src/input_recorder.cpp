@@ -0,0 +1,363 @@
+#include "input_recorder.h"
+#include "display.h"
+#include "mqtt_manager.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include "soak_test.h"
+#include <Arduino.h>
+#include <logging.h>
+
+const size_t HEX_BYTES_PER_LINE = 32;
+const int HEX_BASE = 16;
+const int BYTE_BITS = 8;
+const uint32_t MICROS_PER_MILLI = 1000;
+const size_t MAX_TOPIC_LENGTH = 255;
+
+auto InputRecorder::getInstance() -> InputRecorder& {
+  static InputRecorder instance;
+  return instance;
+}
+
+auto InputRecorder::init(ButtonEdgeHandler buttonHandler, RotaryStepsHandler rotaryHandler, ReplayClockHandler clockHandler) -> void {
+  this->buttonHandler = buttonHandler;
+  this->rotaryHandler = rotaryHandler;
+  this->clockHandler = clockHandler;
+  clear();
+}
+
+auto InputRecorder::update() -> void {
+  pollSerial();
+
+  if (mode == Mode::REPLAYING) {
+    replayDue();
+  }
+}
+
+auto InputRecorder::getMode() const -> Mode {
+  return mode;
+}
+
+auto InputRecorder::hasSerialInput() const -> bool {
+  return Serial.available() > 0;
+}
+
+auto InputRecorder::getNextDeadline() const -> unsigned long {
+  if (mode != Mode::REPLAYING) {
+    return Scheduler::NO_DEADLINE;
+  }
+  // Replay records are microsecond-stamped, check again next millisecond
+  return millis() + 1;
+}
+
+auto InputRecorder::startRecording() -> void {
+  clear();
+  mode = Mode::RECORDING;
+  LOG_INFO("Input recording started");
+}
+
+auto InputRecorder::stopRecording() -> void {
+  if (mode == Mode::RECORDING) {
+    mode = Mode::IDLE;
+    LOG_INFO("Input recording stopped: %u records, %u bytes", recordCount, used);
+  }
+}
+
+auto InputRecorder::clear() -> void {
+  head = 0;
+  used = 0;
+  recordCount = 0;
+  replayOffset = 0;
+}
+
+auto InputRecorder::recordButtonEdge(uint8_t input, bool pressed) -> void {
+  if (mode != Mode::RECORDING) { return; }
+
+  const std::array<uint8_t, 2> payload = {input, static_cast<uint8_t>(pressed ? 1 : 0)};
+  append(RecordType::BUTTON_EDGE, payload.data(), payload.size(), nullptr, 0);
+}
+
+auto InputRecorder::recordRotarySteps(int steps) -> void {
+  if (mode != Mode::RECORDING) { return; }
+
+  auto const value = static_cast<uint16_t>(static_cast<int16_t>(steps));
+  const std::array<uint8_t, 2> payload = {static_cast<uint8_t>(value & 0xFF), static_cast<uint8_t>(value >> BYTE_BITS)};
+  append(RecordType::ROTARY_STEPS, payload.data(), payload.size(), nullptr, 0);
+}
+
+auto InputRecorder::recordMqttMessage(const char* topic, const byte* payload, unsigned int length) -> void {
+  if (mode != Mode::RECORDING) { return; }
+
+  size_t const topicLength = strnlen(topic, MAX_TOPIC_LENGTH);
+  std::array<uint8_t, MAX_TOPIC_LENGTH + 1> prefix{};
+  prefix[0] = static_cast<uint8_t>(topicLength);
+  memcpy(&prefix[1], topic, topicLength);
+  append(RecordType::MQTT_MESSAGE, prefix.data(), topicLength + 1, payload, length);
+}
+
+auto InputRecorder::append(RecordType type, const uint8_t* first, size_t firstLength, const uint8_t* second, size_t secondLength) -> void {
+  size_t const length = firstLength + secondLength;
+  if (length > MAX_PAYLOAD_SIZE) {
+    LOG_WARNING("Input record too large to capture: %u bytes", length);
+    return;
+  }
+
+  size_t const total = HEADER_SIZE + length;
+  while (BUFFER_SIZE - used < total) {
+    dropOldest();
+  }
+
+  uint32_t const timestamp = micros();
+  const std::array<uint8_t, HEADER_SIZE> header = {
+    static_cast<uint8_t>(type),
+    static_cast<uint8_t>(length & 0xFF),
+    static_cast<uint8_t>(length >> BYTE_BITS),
+    static_cast<uint8_t>(timestamp & 0xFF),
+    static_cast<uint8_t>((timestamp >> BYTE_BITS) & 0xFF),
+    static_cast<uint8_t>((timestamp >> (BYTE_BITS * 2)) & 0xFF),
+    static_cast<uint8_t>(timestamp >> (BYTE_BITS * 3))
+  };
+
+  auto write = [this](const uint8_t* data, size_t size) {
+    for (size_t i = 0; i < size; i++) {
+      buffer[head] = data[i];
+      head = (head + 1) % BUFFER_SIZE;
+    }
+    used += size;
+  };
+  write(header.data(), header.size());
+  write(first, firstLength);
+  write(second, secondLength);
+  recordCount++;
+}
+
+auto InputRecorder::dropOldest() -> void {
+  size_t const length = readByte(1) | (readByte(2) << BYTE_BITS);
+  used -= HEADER_SIZE + length;
+  recordCount--;
+}
+
+auto InputRecorder::readByte(size_t offset) const -> uint8_t {
+  size_t const tail = (head + BUFFER_SIZE - used) % BUFFER_SIZE;
+  return buffer[(tail + offset) % BUFFER_SIZE];
+}
+
+auto InputRecorder::readRecord(size_t offset, RecordType& type, uint32_t& timestamp, size_t& length) -> const uint8_t* {
+  type = static_cast<RecordType>(readByte(offset));
+  length = readByte(offset + 1) | (readByte(offset + 2) << BYTE_BITS);
+  timestamp = 0;
+  for (int i = 0; i < 4; i++) {
+    timestamp |= static_cast<uint32_t>(readByte(offset + 3 + i)) << (BYTE_BITS * i);
+  }
+
+  length = min(length, MAX_PAYLOAD_SIZE);
+  for (size_t i = 0; i < length; i++) {
+    scratch[i] = readByte(offset + HEADER_SIZE + i);
+  }
+  return scratch.data();
+}
+
+// Records keep their captured spacing, shifted to the replay's start, so
+// the gesture recognizer sees the same press lengths and gaps
+auto InputRecorder::replayMillis(uint32_t timestamp) const -> unsigned long {
+  return replayStartMillis + (timestamp - replayBaseTimestamp) / MICROS_PER_MILLI;
+}
+
+auto InputRecorder::dispatch(RecordType type, const uint8_t* payload, size_t length, uint32_t timestamp) -> void {
+  switch (type) {
+    case RecordType::BUTTON_EDGE:
+      if (length == 2 && buttonHandler != nullptr) {
+        buttonHandler(payload[0], payload[1] != 0, replayMillis(timestamp));
+      }
+      break;
+    case RecordType::ROTARY_STEPS:
+      if (length == 2 && rotaryHandler != nullptr) {
+        rotaryHandler(static_cast<int16_t>(payload[0] | (payload[1] << BYTE_BITS)));
+      }
+      break;
+    case RecordType::MQTT_MESSAGE: {
+      size_t const topicLength = payload[0];
+      if (length < topicLength + 1) { break; }
+
+      std::array<char, MAX_TOPIC_LENGTH + 1> topic{};
+      memcpy(topic.data(), &payload[1], topicLength);
+      // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast) - the callback signature is not const-correct
+      MQTTManager::onMqttMessage(topic.data(), const_cast<uint8_t*>(&payload[topicLength + 1]), length - topicLength - 1);
+      break;
+    }
+    default:
+      LOG_WARNING("Unknown input record type: %d", static_cast<int>(type));
+      break;
+  }
+}
+
+auto InputRecorder::startReplay(bool realtime) -> void {
+  if (mode == Mode::RECORDING) {
+    stopRecording();
+  }
+  if (recordCount == 0) {
+    LOG_WARNING("No input capture to replay");
+    return;
+  }
+
+  RecordType type{};
+  size_t length = 0;
+  readRecord(0, type, replayBaseTimestamp, length);
+  replayStartMillis = millis();
+
+  if (!realtime) {
+    replayAll();
+    return;
+  }
+
+  replayOffset = 0;
+  replayStartMicros = micros();
+  mode = Mode::REPLAYING;
+  LOG_INFO("Replaying %u input records", recordCount);
+}
+
+auto InputRecorder::replayDue() -> void {
+  unsigned long const elapsed = micros() - replayStartMicros;
+
+  while (replayOffset < used) {
+    RecordType type{};
+    uint32_t timestamp = 0;
+    size_t length = 0;
+    const uint8_t* payload = readRecord(replayOffset, type, timestamp, length);
+    if (timestamp - replayBaseTimestamp > elapsed) {
+      return;
+    }
+
+    dispatch(type, payload, length, timestamp);
+    replayOffset += HEADER_SIZE + length;
+  }
+
+  mode = Mode::IDLE;
+  LOG_INFO("Input replay complete");
+}
+
+auto InputRecorder::replayAll() -> void {
+  Mode const previousMode = mode;
+  mode = Mode::REPLAYING;
+
+  unsigned long const start = micros();
+  replayRecords();
+  unsigned long const elapsed = micros() - start;
+
+  mode = previousMode;
+  LOG_INFO("Replayed %u input records in %lu us (%lu us/record)", recordCount, elapsed, elapsed / recordCount);
+}
+
+// The capture is pushed through far faster than it was recorded, so the
+// gesture timeouts are driven from the records' own times. Left to the real
+// clock they would stay pending for the length of the capture.
+auto InputRecorder::replayRecords() -> void {
+  unsigned long virtualNow = replayStartMillis;
+  size_t offset = 0;
+  while (offset < used) {
+    RecordType type{};
+    uint32_t timestamp = 0;
+    size_t length = 0;
+    const uint8_t* payload = readRecord(offset, type, timestamp, length);
+    virtualNow = replayMillis(timestamp);
+    if (clockHandler != nullptr) {
+      clockHandler(virtualNow, false);
+    }
+    dispatch(type, payload, length, timestamp);
+    Display::getInstance().update();
+    offset += HEADER_SIZE + length;
+  }
+  if (clockHandler != nullptr) {
+    clockHandler(virtualNow, true);
+  }
+}
+
+auto InputRecorder::dump(Print& output) const -> void {
+  output.printf("# capture %u bytes %u records\n", used, recordCount);
+  for (size_t offset = 0; offset < used; offset++) {
+    output.printf("%02x", readByte(offset));
+    if ((offset + 1) % HEX_BYTES_PER_LINE == 0 || offset + 1 == used) {
+      output.println();
+    }
+  }
+  output.println("# end");
+}
+
+auto InputRecorder::pollSerial() -> void {
+  while (Serial.available() > 0) {
+    int const next = Serial.read();
+    if (next == '\r') { continue; }
+
+    if (next != '\n') {
+      if (lineLength < line.size() - 1) {
+        line[lineLength++] = static_cast<char>(next);
+      }
+      continue;
+    }
+
+    line[lineLength] = '\0';
+    lineLength = 0;
+    handleCommand(line.data());
+  }
+}
+
+auto InputRecorder::handleCommand(const char* command) -> void {
+  if (mode == Mode::LOADING) {
+    if (strcmp(command, "# end") == 0) {
+      // Rebuild the record count from the loaded bytes
+      mode = Mode::IDLE;
+      recordCount = 0;
+      size_t offset = 0;
+      while (offset + HEADER_SIZE <= used) {
+        offset += HEADER_SIZE + (readByte(offset + 1) | (readByte(offset + 2) << BYTE_BITS));
+        recordCount++;
+      }
+      LOG_INFO("Loaded input capture: %u records, %u bytes", recordCount, used);
+    } else if (command[0] != '#') {
+      loadHexLine(command);
+    }
+    return;
+  }
+
+  if (strcmp(command, "rec start") == 0) {
+    startRecording();
+  } else if (strcmp(command, "rec stop") == 0) {
+    stopRecording();
+  } else if (strcmp(command, "rec dump") == 0) {
+    dump(Serial);
+  } else if (strcmp(command, "rec replay") == 0) {
+    startReplay(true);
+  } else if (strcmp(command, "rec bench") == 0) {
+    startReplay(false);
+  } else if (strcmp(command, "sched") == 0) {
+    Scheduler::getInstance().dumpStats(Serial);
+    Scheduler::getNetworkInstance().dumpStats(Serial);
+#ifdef PROFILING
+  } else if (strcmp(command, "prof") == 0) {
+    Profiler::getInstance().dump(Serial);
+  } else if (strcmp(command, "prof reset") == 0) {
+    Profiler::getInstance().reset();
+#endif
+#ifdef SOAK_TEST
+  } else if (strcmp(command, "soak stop") == 0) {
+    SoakTest::getInstance().stop();
+  } else if (strcmp(command, "soak") == 0 || strncmp(command, "soak ", 5) == 0) {
+    auto const iterations = static_cast<uint32_t>(strtoul(command + 4, nullptr, 10));
+    SoakTest::getInstance().start(iterations == 0 ? SoakTest::DEFAULT_ITERATIONS : iterations);
+#endif
+  } else if (strcmp(command, "rec load") == 0) {
+    clear();
+    mode = Mode::LOADING;
+    LOG_INFO("Send capture hex lines, finish with '# end'");
+  }
+}
+
+auto InputRecorder::loadHexLine(const char* hex) -> void {
+  std::array<char, 3> pair{};
+  for (size_t i = 0; hex[i] != '\0' && hex[i + 1] != '\0' && used < BUFFER_SIZE; i += 2) {
+    pair[0] = hex[i];
+    pair[1] = hex[i + 1];
+    buffer[head] = static_cast<uint8_t>(strtoul(pair.data(), nullptr, HEX_BASE));
+    head = (head + 1) % BUFFER_SIZE;
+    used++;
+  }
+}
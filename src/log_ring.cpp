@@ -0,0 +1,270 @@
+#include "log_ring.h"
+#include "profiler.h"
+#include <Arduino.h>
+
+const uint32_t LogRing::TASK_STACK_SIZE = 4096;
+const UBaseType_t LOG_TASK_PRIORITY = 1;
+const BaseType_t LOG_TASK_CORE = 0;
+const char* const CONVERSIONS = "diouxXcspfFeEgGaA%";
+const char* const LENGTH_MODIFIERS = "hlLqjzt";
+const size_t MAX_SPEC_LENGTH = 16;
+const size_t MAX_STRING_LENGTH = 255;
+const std::array<const char*, 5> LEVEL_NAMES = {"", "ERROR", "WARN", "INFO", "DEBUG"};
+#ifdef LOG_BINARY_OUTPUT
+const std::array<uint8_t, 2> FRAME_MARKER = {0xA5, 0x5A};
+#endif
+
+auto LogEncoder::add(const char* value) -> void {
+  if (used + 2 > capacity) {
+    used = capacity;
+    return;
+  }
+  if (value == nullptr) {
+    value = "(null)";
+  }
+
+  // Long strings are cut to whatever room is left
+  size_t const length = strnlen(value, min(capacity - used - 2, MAX_STRING_LENGTH));
+  data[used++] = static_cast<uint8_t>(LogArg::STR);
+  data[used++] = static_cast<uint8_t>(length);
+  memcpy(&data[used], value, length);
+  used += length;
+}
+
+auto LogRing::getInstance() -> LogRing& {
+  static LogRing instance;
+  return instance;
+}
+
+LogRing::LogRing() {
+  for (uint32_t i = 0; i < SLOT_COUNT; i++) {
+    slots[i].sequence.store(i, std::memory_order_relaxed);
+  }
+}
+
+auto LogRing::init(Print& output) -> void {
+  this->output = &output;
+  xTaskCreatePinnedToCore(runDrainTask, "log", TASK_STACK_SIZE, nullptr, LOG_TASK_PRIORITY, &drainTask, LOG_TASK_CORE);
+}
+
+// A slot is free for position p while its sequence is p, holds a record
+// while it is p + 1, and becomes free again for the next lap at
+// p + SLOT_COUNT once drained
+auto LogRing::reserve(uint32_t& position) -> LogRecord* {
+  position = enqueuePosition.load(std::memory_order_relaxed);
+  for (;;) {
+    Slot& slot = slots[position & (SLOT_COUNT - 1)];
+    auto const difference = static_cast<int32_t>(slot.sequence.load(std::memory_order_acquire) - position);
+    if (difference == 0) {
+      if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed)) {
+        return &slot.entry;
+      }
+    } else if (difference < 0) {
+      dropped.fetch_add(1, std::memory_order_relaxed);
+      return nullptr;
+    } else {
+      position = enqueuePosition.load(std::memory_order_relaxed);
+    }
+  }
+}
+
+auto LogRing::commit(uint32_t position) -> void {
+  slots[position & (SLOT_COUNT - 1)].sequence.store(position + 1, std::memory_order_release);
+  if (drainTask != nullptr) {
+    xTaskNotifyGive(drainTask);
+  }
+}
+
+auto LogRing::runDrainTask(void* /*parameter*/) -> void {
+  LogRing& ring = getInstance();
+  for (;;) {
+    ring.drain();
+    ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+  }
+}
+
+auto LogRing::drain() -> void {
+  for (;;) {
+    Slot& slot = slots[dequeuePosition & (SLOT_COUNT - 1)];
+    if (slot.sequence.load(std::memory_order_acquire) != dequeuePosition + 1) {
+      break;
+    }
+
+    // Free the slot before the slow serial write
+    LogRecord const entry = slot.entry;
+    slot.sequence.store(dequeuePosition + SLOT_COUNT, std::memory_order_release);
+    dequeuePosition++;
+    PROFILE_SCOPE("log.write");
+    write(entry);
+  }
+
+  uint32_t const lost = dropped.exchange(0, std::memory_order_relaxed);
+  if (lost > 0) {
+    output->printf("Log ring full, %u messages dropped\n", lost);
+  }
+}
+
+auto LogRing::write(const LogRecord& entry) -> void {
+#ifdef LOG_BINARY_OUTPUT
+  std::array<uint8_t, FRAME_MARKER.size() + 1 + sizeof(uint32_t) * 2 + 1 + sizeof(entry.payload)> frame{};
+  size_t used = 0;
+  auto const address = static_cast<uint32_t>(reinterpret_cast<uintptr_t>(entry.format));
+  memcpy(frame.data(), FRAME_MARKER.data(), FRAME_MARKER.size());
+  used += FRAME_MARKER.size();
+  frame[used++] = static_cast<uint8_t>(sizeof(uint32_t) * 2 + 1 + entry.length);
+  memcpy(&frame[used], &address, sizeof(address));
+  used += sizeof(address);
+  memcpy(&frame[used], &entry.timestamp, sizeof(entry.timestamp));
+  used += sizeof(entry.timestamp);
+  frame[used++] = entry.level;
+  memcpy(&frame[used], entry.payload.data(), entry.length);
+  used += entry.length;
+  output->write(frame.data(), used);
+#else
+  std::array<char, LINE_LENGTH> line{};
+  const char* level = entry.level < LEVEL_NAMES.size() ? LEVEL_NAMES[entry.level] : "";
+  int const prefix = snprintf(line.data(), line.size(), "%10lu %-5s ", static_cast<unsigned long>(entry.timestamp), level);
+  size_t const length = prefix + format(entry, &line[prefix], line.size() - prefix);
+  line[min(length, line.size() - 2)] = '\n';
+  output->write(reinterpret_cast<const uint8_t*>(line.data()), min(length + 1, line.size() - 1));
+#endif
+}
+
+namespace {
+
+// Formats one conversion from the payload at offset and advances past it.
+// Integers are widened to long long so the stored width never has to match
+// the length modifier in the format string.
+auto formatArgument(const char* spec, char conversion, const LogRecord& entry, size_t& offset, char* output, size_t size) -> int {
+  if (offset >= entry.length) {
+    return snprintf(output, size, "?");
+  }
+
+  auto const tag = static_cast<LogArg>(entry.payload[offset++]);
+  const uint8_t* value = &entry.payload[offset];
+  uint64_t bits = 0;
+  double real = 0.0;
+  std::array<char, sizeof(entry.payload) + 1> text{};
+  switch (tag) {
+    case LogArg::I32: {
+      int32_t signedValue = 0;
+      memcpy(&signedValue, value, sizeof(signedValue));
+      bits = static_cast<uint64_t>(static_cast<int64_t>(signedValue));
+      real = signedValue;
+      offset += sizeof(int32_t);
+      break;
+    }
+    case LogArg::U32: {
+      uint32_t unsignedValue = 0;
+      memcpy(&unsignedValue, value, sizeof(unsignedValue));
+      bits = unsignedValue;
+      real = unsignedValue;
+      offset += sizeof(uint32_t);
+      break;
+    }
+    case LogArg::I64:
+    case LogArg::U64:
+      memcpy(&bits, value, sizeof(bits));
+      real = tag == LogArg::I64 ? static_cast<double>(static_cast<int64_t>(bits)) : static_cast<double>(bits);
+      offset += sizeof(uint64_t);
+      break;
+    case LogArg::F64:
+      memcpy(&real, value, sizeof(real));
+      offset += sizeof(double);
+      break;
+    case LogArg::STR: {
+      size_t const length = min(static_cast<size_t>(value[0]), static_cast<size_t>(entry.length - offset - 1));
+      memcpy(text.data(), &value[1], length);
+      offset += 1 + length;
+      break;
+    }
+    default:
+      offset = entry.length;
+      return snprintf(output, size, "?");
+  }
+
+  // Rebuild the conversion without its length modifier
+  std::array<char, MAX_SPEC_LENGTH + 2> plain{};
+  size_t plainLength = 0;
+  for (const char* cursor = spec; *cursor != conversion; cursor++) {
+    if (strchr(LENGTH_MODIFIERS, *cursor) == nullptr) {
+      plain[plainLength++] = *cursor;
+    }
+  }
+
+  switch (conversion) {
+    case 's':
+      plain[plainLength] = 's';
+      return snprintf(output, size, plain.data(), tag == LogArg::STR ? text.data() : "?");
+    case 'c':
+      plain[plainLength] = 'c';
+      return snprintf(output, size, plain.data(), static_cast<int>(bits));
+    case 'p':
+      plain[plainLength] = 'p';
+      return snprintf(output, size, plain.data(), reinterpret_cast<void*>(static_cast<uintptr_t>(bits)));
+    case 'd':
+    case 'i':
+      plain[plainLength++] = 'l';
+      plain[plainLength++] = 'l';
+      plain[plainLength] = conversion;
+      return snprintf(output, size, plain.data(), static_cast<long long>(bits));
+    case 'o':
+    case 'u':
+    case 'x':
+    case 'X':
+      // An int printed as unsigned must not show its sign extension
+      if (tag == LogArg::I32) {
+        bits &= UINT32_MAX;
+      }
+      plain[plainLength++] = 'l';
+      plain[plainLength++] = 'l';
+      plain[plainLength] = conversion;
+      return snprintf(output, size, plain.data(), static_cast<unsigned long long>(bits));
+    default:
+      plain[plainLength] = conversion;
+      return snprintf(output, size, plain.data(), real);
+  }
+}
+
+} // namespace
+
+auto LogRing::format(const LogRecord& entry, char* output, size_t size) -> size_t {
+  if (size == 0) {
+    return 0;
+  }
+
+  size_t used = 0;
+  size_t offset = 0;
+  const char* cursor = entry.format;
+  std::array<char, MAX_SPEC_LENGTH> spec{};
+  while (*cursor != '\0' && used + 1 < size) {
+    if (*cursor != '%') {
+      output[used++] = *cursor++;
+      continue;
+    }
+
+    // Flags, width, precision and length up to the conversion character
+    size_t specLength = 0;
+    spec[specLength++] = *cursor++;
+    while (*cursor != '\0' && strchr(CONVERSIONS, *cursor) == nullptr && specLength < spec.size() - 2) {
+      spec[specLength++] = *cursor++;
+    }
+    if (*cursor == '\0') {
+      break;
+    }
+    char const conversion = *cursor++;
+    spec[specLength++] = conversion;
+    spec[specLength] = '\0';
+
+    if (conversion == '%') {
+      output[used++] = '%';
+      continue;
+    }
+    int const written = formatArgument(spec.data(), conversion, entry, offset, &output[used], size - used);
+    if (written > 0) {
+      used += min(static_cast<size_t>(written), size - used - 1);
+    }
+  }
+  output[used] = '\0';
+  return used;
+}
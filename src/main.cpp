@@ -1,16 +1,28 @@
 #include "app_state.h"
+#include "boot_sequence.h"
+#include "breadcrumbs.h"
+#include "change_bus.h"
 #include "display.h"
+#include "gesture_recognizer.h"
+#include "input_recorder.h"
 #include "mqtt_manager.h"
+#include "network_task.h"
 #include "ota_manager.h"
+#include "profiler.h"
 #include "rotary_encoder.h"
+#include "rules_engine.h"
+#include "scheduler.h"
+#include "screen_mirror.h"
 #include "sign_state.h"
+#include "soak_test.h"
+#include "status_server.h"
 #include "time_manager.h"
+#include "wifi_connection.h"
 #include <Arduino.h>
 #include <WiFi.h>
 #include <WiFiManager.h>
 #include <Wire.h>
 #include <Preferences.h>
-#include <Elog.h>
 #include <logging.h>
 
 // NOLINTNEXTLINE
@@ -28,6 +40,29 @@ WiFiManagerParameter mqtt_username("mqtt_username", "MQTT Username", "", MAX_MQT
 // NOLINTNEXTLINE
 WiFiManagerParameter mqtt_password("mqtt_password", "MQTT Password", "", MAX_MQTT_CONFIG_LENGTH);
 
+// NOLINTNEXTLINE(cert-err58-cpp)
+const int MAX_TIMEZONE_LENGTH = 64;
+
+// POSIX TZ string, e.g. "EST5EDT,M3.2.0,M11.1.0" or "CET-1CEST,M3.5.0,M10.5.0/3"
+// NOLINTNEXTLINE
+WiFiManagerParameter posix_timezone("timezone", "POSIX Time Zone", "EST5EDT,M3.2.0,M11.1.0", MAX_TIMEZONE_LENGTH);
+
+// NOLINTNEXTLINE(cert-err58-cpp)
+const int MAX_IP_LENGTH = 16;
+
+// Optional static IP; leave the address empty to use DHCP
+// NOLINTNEXTLINE
+WiFiManagerParameter static_ip("static_ip", "Static IP (optional)", "", MAX_IP_LENGTH);
+// NOLINTNEXTLINE
+WiFiManagerParameter static_gateway("static_gateway", "Gateway", "", MAX_IP_LENGTH);
+// NOLINTNEXTLINE
+WiFiManagerParameter static_subnet("static_subnet", "Subnet Mask", "255.255.255.0", MAX_IP_LENGTH);
+// NOLINTNEXTLINE
+WiFiManagerParameter static_dns("static_dns", "DNS Server", "", MAX_IP_LENGTH);
+
+// NOLINTNEXTLINE
+WiFiManager wifiManager;
+
 enum {
 BUTTON_1_PIN = 13,
 BUTTON_2_PIN = 12,
@@ -47,76 +82,339 @@ const std::array<int, BUTTON_COUNT> BUTTON_PINS = {
 
 const int SERIAL_BAUD_RATE = 115200;
 
+// Gesture recognizers for the five buttons, with the dial button last
+const int DIAL_GESTURE_INPUT = BUTTON_COUNT;
+const std::array<const char*, BUTTON_COUNT + 1> GESTURE_INPUT_NAMES = {
+  "button/1",
+  "button/2",
+  "button/3",
+  "button/4",
+  "button/5",
+  "dial"
+};
+const GestureConfig GESTURE_CONFIG = {
+  250, // double click window
+  600, // long press delay
+  200  // hold repeat interval
+};
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::array<GestureRecognizer, BUTTON_COUNT + 1> gestureRecognizers;
+
+// A slow turn moves one item per detent, a fast spin up to four
+const RotaryAcceleration ROTARY_ACCELERATION = {
+  8,  // threshold, detents per second
+  40, // saturation, detents per second
+  4   // max multiplier
+};
+
+// Scheduler task ids, assigned in setup_scheduler()
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint8_t inputTask = Scheduler::MAX_TASKS;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint8_t appTask = Scheduler::MAX_TASKS;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint8_t wifiTask = Scheduler::MAX_TASKS;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+uint8_t mqttTask = Scheduler::MAX_TASKS;
+
 void setup_buttons();
+void setup_boot_stages();
+void setup_scheduler();
+void start_wifi();
+void start_mqtt();
+void IRAM_ATTR onInputInterrupt();
+void onSerialReceive();
+auto runInput(unsigned long now) -> unsigned long;
+auto runConsole(unsigned long now) -> unsigned long;
+auto runBoot(unsigned long now) -> unsigned long;
+auto runWifi(unsigned long now) -> unsigned long;
+auto runOta(unsigned long now) -> unsigned long;
+auto runMqtt(unsigned long now) -> unsigned long;
+auto runTime(unsigned long now) -> unsigned long;
+auto runInbound(unsigned long now) -> unsigned long;
+auto runStatus(unsigned long now) -> unsigned long;
+auto runMirror(unsigned long now) -> unsigned long;
+auto runApp(unsigned long now) -> unsigned long;
+auto runDisplay(unsigned long now) -> unsigned long;
+#ifdef SOAK_TEST
+auto runSoak(unsigned long now) -> unsigned long;
+#endif
+void onGesture(uint8_t input, Gesture gesture, unsigned long timestamp);
+void onButtonEdge(uint8_t input, bool pressed, unsigned long timestamp);
+void onRotarySteps(int steps);
+void onReplayClock(unsigned long now, bool finished);
 void saveConfigCallback();
-void init_wifi();
 
 void setup() {
+  Breadcrumbs::getInstance().init();
+  Scheduler::getInstance().init();
   setup_buttons();
 
   Serial.begin(SERIAL_BAUD_RATE);
+  Serial.onReceive(onSerialReceive);
 
-  Logger.configure(100, true);
-  Logger.registerSerial(MAIN_LOG, ELOG_LEVEL_DEBUG, "APP", Serial);
+  LogRing::getInstance().init(Serial);
 
-  Logger.debug(MAIN_LOG, "Initializing...");
+  LOG_DEBUG("Initializing...");
 
+  // Everything that works offline comes up straight away; the network
+  // stages run from the scheduler once loop() starts
   Display::getInstance().init();
-
-  init_wifi();
-  
-  OTAManager::getInstance().init();
   AppState::getInstance().init();
   SignState::getInstance().init();
   TimeManager::getInstance().init();
-  MQTTManager::getInstance().init();
+  OTAManager::getInstance().init();
+  ScreenMirror::getInstance().init();
+  RulesEngine::getInstance().init();
+
+  RotaryEncoderManager::getInstance().init(onInputInterrupt);
+  RotaryEncoderManager::getInstance().setAcceleration(ROTARY_ACCELERATION);
+  InputRecorder::getInstance().init(onButtonEdge, onRotarySteps, onReplayClock);
+#ifdef SOAK_TEST
+  SoakTest::getInstance().init(onButtonEdge, onRotarySteps);
+#endif
 
-  RotaryEncoderManager::getInstance().init();
+  setup_boot_stages();
+  setup_scheduler();
+  NetworkTask::getInstance().start();
 
-  Logger.debug(MAIN_LOG, "Setup complete. Starting main loop...");
+  LOG_DEBUG("Setup complete. Starting main loop...");
 }
 
 void loop() {
-  static std::array<bool, BUTTON_COUNT> button_states = {false, false, false, false, false};
-  static long const lastInput = -1;
+  Scheduler& scheduler = Scheduler::getInstance();
+  scheduler.waitForWork();
+  PROFILE_SCOPE("loop");
+  scheduler.runDue();
+}
+
+void setup_buttons() {
+  for (int const i : BUTTON_PINS) {
+    pinMode(i, INPUT_PULLUP);
+    attachInterrupt(digitalPinToInterrupt(i), onInputInterrupt, CHANGE);
+  }
 
-  RotaryEncoderManager::getInstance().tick();
+  for (size_t i = 0; i < gestureRecognizers.size(); i++) {
+    gestureRecognizers[i].init(i, onGesture, GESTURE_CONFIG);
+  }
+}
 
-  // Handle time updates
-  TimeManager::getInstance().update();
+// Tasks run in this order on each pass, so input and inbound messages are
+// handled before the menu state they change and the display is drawn last.
+// The network tasks run on their own scheduler on core 0 (see NetworkTask).
+void setup_scheduler() {
+  Scheduler& scheduler = Scheduler::getInstance();
+  inputTask = scheduler.addTask("input", runInput);
+  scheduler.addTask("console", runConsole, [] { return InputRecorder::getInstance().hasSerialInput(); });
+  scheduler.addTask("inbound", runInbound, [] { return NetworkTask::getInstance().hasInbound(); });
+  appTask = scheduler.addTask("app", runApp, [] { return AppState::getInstance().hasPendingMenu(); });
+#ifdef SOAK_TEST
+  scheduler.addTask("soak", runSoak, [] { return SoakTest::getInstance().isRunning(); });
+#endif
+  scheduler.addTask("display", runDisplay, [] { return ChangeBus::getInstance().hasChanges(); });
+  scheduler.addTask("mirror", runMirror, [] { return ScreenMirror::getInstance().hasFrameDue(); });
+  scheduler.addTask("status", runStatus, [] { return StatusServer::getInstance().hasSnapshotRequest(); });
 
-  // Handle sign state updates
-  SignState::getInstance().update();
+  Scheduler& network = Scheduler::getNetworkInstance();
+  network.addTask("boot", runBoot);
+  wifiTask = network.addTask("wifi", runWifi, [] { return WiFiConnection::getInstance().hasPendingEvent(); });
+  mqttTask = network.addTask("mqtt", runMqtt, [] { return MQTTManager::getInstance().hasPendingPublishes(); });
+  uint8_t const otaTask = network.addTask("ota", runOta, [] { return OTAManager::getInstance().hasPendingEvent(); });
+  network.addTask("time", runTime, [] { return TimeManager::getInstance().hasPendingSync(); });
 
-  // Handle MQTT connection
-  MQTTManager::getInstance().update();
+  // Background release checks keep their own deadline from here on
+  network.scheduleAt(otaTask, millis());
+}
+
+// Network bring-up, in dependency order. Each stage starts as soon as the
+// stages it depends on have completed.
+void setup_boot_stages() {
+  BootSequence& boot = BootSequence::getInstance();
+  uint8_t const wifi = boot.addStage("Connecting WiFi", 0, start_wifi, [] { return WiFiConnection::getInstance().isLinkUp(); });
+  boot.addStage("Starting SNTP", wifi, [] { TimeManager::getInstance().startSync(); });
+  boot.addStage("Connecting MQTT", wifi, start_mqtt, [] { return MQTTManager::getInstance().isConnected(); });
+  boot.addStage("Starting HTTP", wifi, [] { StatusServer::getInstance().start(); });
+}
+
+void start_wifi() {
+  wifiManager.addParameter(&mqtt_server);
+  wifiManager.addParameter(&mqtt_port);
+  wifiManager.addParameter(&mqtt_username);
+  wifiManager.addParameter(&mqtt_password);
+  wifiManager.addParameter(&posix_timezone);
+  wifiManager.addParameter(&static_ip);
+  wifiManager.addParameter(&static_gateway);
+  wifiManager.addParameter(&static_subnet);
+  wifiManager.addParameter(&static_dns);
+  wifiManager.setSaveConfigCallback(saveConfigCallback);
+
+  WiFiConnection::getInstance().begin(wifiManager);
+  Scheduler::getNetworkInstance().scheduleAt(wifiTask, millis());
+}
+
+void start_mqtt() {
+  MQTTManager::getInstance().init();
+  Scheduler::getNetworkInstance().scheduleAt(mqttTask, millis());
+}
 
-  for(int i = 0; i < BUTTON_COUNT; i++) {
-    bool const currentState = digitalRead(BUTTON_PINS[i]) == LOW;
+void IRAM_ATTR onInputInterrupt() {
+  Scheduler::signalFromIsr(inputTask);
+}
+
+void onSerialReceive() {
+  Scheduler::getInstance().notify();
+}
+
+auto runInput(unsigned long now) -> unsigned long {
+  PROFILE_SCOPE("input");
+  static std::array<bool, BUTTON_COUNT + 1> button_states = {false, false, false, false, false, false};
+
+  BootSequence::getInstance().markMilestone(BootMilestone::INPUT_READY);
+
+  for (int i = 0; i <= BUTTON_COUNT; i++) {
+    bool const currentState = i == DIAL_GESTURE_INPUT
+      ? RotaryEncoderManager::getInstance().isButtonDown()
+      : digitalRead(BUTTON_PINS[i]) == LOW;
     if (currentState != button_states[i]) {
       button_states[i] = currentState;
-      MQTTManager::getInstance().publishButtonState(i + 1, currentState);
+      InputRecorder::getInstance().recordButtonEdge(i, currentState);
+      onButtonEdge(i, currentState, now);
     }
   }
 
-  if (RotaryEncoderManager::getInstance().isButtonPressed()) {
-    AppState::getInstance().onSelect();
+  int const rotarySteps = RotaryEncoderManager::getInstance().takeSteps();
+  if (rotarySteps != 0) {
+    InputRecorder::getInstance().recordRotarySteps(rotarySteps);
+    onRotarySteps(rotarySteps);
   }
-  RotaryDirection const rotaryDirection = RotaryEncoderManager::getInstance().getRotationDirection();
-  if (rotaryDirection == RotaryDirection::COUNTERCLOCKWISE) {
-    AppState::getInstance().onNext();
-  } else if (rotaryDirection == RotaryDirection::CLOCKWISE) {
-    AppState::getInstance().onPrevious();
+
+  // Wake again only for the earliest pending gesture timeout
+  unsigned long next = Scheduler::NO_DEADLINE;
+  for (GestureRecognizer& recognizer : gestureRecognizers) {
+    recognizer.poll(now);
+    unsigned long deadline = 0;
+    if (recognizer.getDeadline(deadline) && (next == Scheduler::NO_DEADLINE || static_cast<long>(deadline - next) < 0)) {
+      next = deadline;
+    }
+  }
+  return next;
+}
+
+auto runConsole(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("console");
+  InputRecorder::getInstance().update();
+  return InputRecorder::getInstance().getNextDeadline();
+}
+
+auto runBoot(unsigned long now) -> unsigned long {
+  PROFILE_SCOPE("boot");
+  return BootSequence::getInstance().update(now);
+}
+
+auto runWifi(unsigned long now) -> unsigned long {
+  PROFILE_SCOPE("wifi");
+  WiFiConnection& wifi = WiFiConnection::getInstance();
+  bool const wasUp = wifi.isLinkUp();
+  unsigned long const next = wifi.update(now);
+
+  // MQTT sleeps while the link is down, wake it on every change
+  if (wifi.isLinkUp() != wasUp) {
+    Scheduler::getNetworkInstance().scheduleAt(mqttTask, now);
   }
+  return next;
+}
+
+auto runMqtt(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("mqtt");
+  MQTTManager::getInstance().update();
+  return MQTTManager::getInstance().getNextDeadline();
+}
+
+auto runOta(unsigned long now) -> unsigned long {
+  PROFILE_SCOPE("ota");
+  return OTAManager::getInstance().update(now);
+}
+
+auto runTime(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("time");
+  TimeManager::getInstance().update();
+  return TimeManager::getInstance().getNextDeadline();
+}
+
+auto runInbound(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("inbound");
+  NetworkTask::getInstance().dispatchInbound();
+  return Scheduler::NO_DEADLINE;
+}
+
+auto runMirror(unsigned long now) -> unsigned long {
+  return ScreenMirror::getInstance().update(now);
+}
+
+auto runStatus(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("status");
+  StatusServer::getInstance().refreshSnapshot();
+  return Scheduler::NO_DEADLINE;
+}
+
+auto runApp(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("app");
   AppState::getInstance().tick();
+  return AppState::getInstance().getTimeoutDeadline();
+}
 
+auto runDisplay(unsigned long /*now*/) -> unsigned long {
+  PROFILE_SCOPE("display");
   Display::getInstance().update();
+  BootSequence::getInstance().markMilestone(BootMilestone::FIRST_FRAME);
+  return Scheduler::NO_DEADLINE;
 }
 
-void setup_buttons() {
-  for (int const i : BUTTON_PINS) {
-    pinMode(i, INPUT_PULLUP);
+#ifdef SOAK_TEST
+auto runSoak(unsigned long now) -> unsigned long {
+  return SoakTest::getInstance().update(now);
+}
+#endif
+
+void onButtonEdge(uint8_t input, bool pressed, unsigned long timestamp) {
+  if (input == DIAL_GESTURE_INPUT) {
+    if (pressed) {
+      AppState::getInstance().onSelect();
+    }
+  } else {
+    MQTTManager::getInstance().publishButtonState(input + 1, pressed);
+  }
+  gestureRecognizers[input].feed(pressed, timestamp);
+  Scheduler::getInstance().scheduleAt(appTask, timestamp);
+}
+
+void onRotarySteps(int steps) {
+  if (steps < 0) {
+    AppState::getInstance().onNext(-steps);
+  } else if (steps > 0) {
+    AppState::getInstance().onPrevious(steps);
   }
+  Scheduler::getInstance().scheduleAt(appTask, millis());
+}
+
+// Timeouts fire between replayed records as they would have when captured.
+// At the end the last gestures complete and the recognizers and the app
+// task go back to the real clock.
+void onReplayClock(unsigned long now, bool finished) {
+  for (GestureRecognizer& recognizer : gestureRecognizers) {
+    recognizer.poll(now);
+    if (finished) {
+      recognizer.finish();
+    }
+  }
+  if (finished) {
+    Scheduler::getInstance().scheduleAt(appTask, millis());
+  }
+}
+
+void onGesture(uint8_t input, Gesture gesture, unsigned long /*timestamp*/) {
+  MQTTManager::getInstance().publishGesture(GESTURE_INPUT_NAMES[input], gesture);
 }
 
 // Callback function to save config when WiFiManager saves parameters
@@ -127,34 +425,15 @@ void saveConfigCallback() {
   preferences.putString("username", mqtt_username.getValue());
   preferences.putString("password", mqtt_password.getValue());
   preferences.end();
-}
-
-void init_wifi()
-{
-  Display::getInstance().setLoadingMessage("Connecting to WiFi");
-  WiFiManager wifiManager;
 
-  // wifiManager.resetSettings();
-  
-  wifiManager.addParameter(&mqtt_server);
-  wifiManager.addParameter(&mqtt_port);
-  wifiManager.addParameter(&mqtt_username);
-  wifiManager.addParameter(&mqtt_password);
-  wifiManager.setSaveConfigCallback(saveConfigCallback);
-
-  bool const res = wifiManager.autoConnect("Desk Control Panel");
+  preferences.begin("time", false);
+  preferences.putString("tz", posix_timezone.getValue());
+  preferences.end();
 
-  const int RETRY_DELAY_MS = 1000;
-  if (!res)
-  {
-    Logger.debug(MAIN_LOG, "Failed to connect to WiFi. Restarting...");
-    Display::getInstance().setLoadingMessage("Failed to connect", "Restarting...");
-    delay(RETRY_DELAY_MS);
-    wifiManager.resetSettings();
-    ESP.restart();
-  }
-  else
-  {
-    Logger.debug(MAIN_LOG, "Connected to WiFi.");
-  }
-}
\ No newline at end of file
+  preferences.begin("wifi", false);
+  preferences.putString("ip", static_ip.getValue());
+  preferences.putString("gateway", static_gateway.getValue());
+  preferences.putString("subnet", static_subnet.getValue());
+  preferences.putString("dns", static_dns.getValue());
+  preferences.end();
+}
@@ -0,0 +1,340 @@
+#include "menu_loader.h"
+#include <Arduino.h>
+#include <logging.h>
+
+const int MAX_MENU_DEPTH = 4;
+const size_t MAX_MENU_NODES = 255;
+const uint32_t FNV_OFFSET_BASIS = 2166136261U;
+const uint32_t FNV_PRIME = 16777619U;
+
+auto MenuArena::allocate(size_t bytes, size_t alignment) -> void* {
+  size_t const start = (used + alignment - 1) & ~(alignment - 1);
+  if (start + bytes > CAPACITY) {
+    return nullptr;
+  }
+  used = start + bytes;
+  return &storage[start];
+}
+
+auto MenuArena::reset() -> void {
+  used = 0;
+}
+
+auto MenuArena::getUsed() const -> size_t {
+  return used;
+}
+
+namespace {
+
+// Recursive descent parser for the menu schema. It runs twice over the same
+// payload: a measuring pass that validates and counts nodes and string bytes,
+// then an emitting pass that writes into storage sized from the first pass.
+// Children are reserved as one contiguous block before recursing, so the
+// resulting table has the same layout as the built-in one.
+class MenuParser {
+public:
+  MenuParser(const char* json, size_t length, MenuNode* nodes, char* strings)
+    : cursor(json), end(json + length), nodes(nodes), strings(strings) {}
+
+  auto parse() -> bool {
+    nodeCount = 1;
+    if (!parseNode(0, 0, 0)) {
+      return false;
+    }
+    skipWhitespace();
+    return check(cursor == end, "trailing data");
+  }
+
+  auto getNodeCount() const -> size_t { return nodeCount; }
+  auto getStringBytes() const -> size_t { return stringBytes; }
+  auto getError() const -> const char* { return error; }
+
+private:
+  const char* cursor;
+  const char* end;
+  MenuNode* nodes;
+  char* strings;
+  size_t nodeCount = 0;
+  size_t stringBytes = 0;
+  const char* error = nullptr;
+
+  // Records the first failure; returns the condition so calls can chain
+  auto check(bool condition, const char* message) -> bool {
+    if (!condition && error == nullptr) {
+      error = message;
+    }
+    return condition;
+  }
+
+  auto skipWhitespace() -> void {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t')) {
+      cursor++;
+    }
+  }
+
+  auto consume(char expected) -> bool {
+    skipWhitespace();
+    if (cursor < end && *cursor == expected) {
+      cursor++;
+      return true;
+    }
+    return false;
+  }
+
+  // Parses a string into the string region (when emitting) and returns it
+  auto parseString(const char*& out) -> bool {
+    if (!check(consume('"'), "expected string")) {
+      return false;
+    }
+
+    char* target = strings == nullptr ? nullptr : strings + stringBytes;
+    while (cursor < end && *cursor != '"') {
+      char next = *cursor++;
+      if (next == '\\') {
+        if (!check(cursor < end, "unterminated escape")) {
+          return false;
+        }
+        next = *cursor++;
+        if (!check(next == '"' || next == '\\' || next == '/', "unsupported escape")) {
+          return false;
+        }
+      }
+      if (strings != nullptr) {
+        strings[stringBytes] = next;
+      }
+      stringBytes++;
+    }
+    if (!check(cursor < end, "unterminated string")) {
+      return false;
+    }
+    cursor++;
+
+    if (strings != nullptr) {
+      strings[stringBytes] = '\0';
+    }
+    stringBytes++;
+    out = target;
+    return true;
+  }
+
+  // Keys are compared in place and never copied into the arena
+  auto parseKey(const char*& key, size_t& length) -> bool {
+    if (!check(consume('"'), "expected key")) {
+      return false;
+    }
+    key = cursor;
+    while (cursor < end && *cursor != '"') {
+      cursor++;
+    }
+    length = cursor - key;
+    if (!check(cursor < end, "unterminated key")) {
+      return false;
+    }
+    cursor++;
+    return check(consume(':'), "expected ':'");
+  }
+
+  auto skipValue() -> bool {
+    skipWhitespace();
+    if (!check(cursor < end, "unexpected end")) {
+      return false;
+    }
+
+    if (*cursor == '"') {
+      cursor++;
+      while (cursor < end && *cursor != '"') {
+        cursor += *cursor == '\\' ? 2 : 1;
+      }
+      cursor++;
+      return check(cursor <= end, "unterminated string");
+    }
+
+    if (*cursor == '{' || *cursor == '[') {
+      int nesting = 0;
+      do {
+        if (*cursor == '"') {
+          if (!skipValue()) {
+            return false;
+          }
+          continue;
+        }
+        if (*cursor == '{' || *cursor == '[') {
+          nesting++;
+        } else if (*cursor == '}' || *cursor == ']') {
+          nesting--;
+        }
+        cursor++;
+      } while (cursor < end && nesting > 0);
+      return check(nesting == 0, "unbalanced brackets");
+    }
+
+    // Numbers, true, false, null
+    while (cursor < end && *cursor != ',' && *cursor != '}' && *cursor != ']') {
+      cursor++;
+    }
+    return true;
+  }
+
+  auto countArrayElements() -> size_t {
+    const char* const saved = cursor;
+    size_t count = 0;
+    if (!consume(']')) {
+      do {
+        if (!skipValue()) {
+          break;
+        }
+        count++;
+      } while (consume(','));
+    }
+    cursor = saved;
+    return count;
+  }
+
+  auto parseItems(uint8_t index, int depth) -> bool {
+    if (!check(consume('['), "items must be an array") || !check(depth < MAX_MENU_DEPTH, "menu too deep")) {
+      return false;
+    }
+
+    size_t const count = countArrayElements();
+    if (!check(count > 0, "empty items") || !check(nodeCount + count <= MAX_MENU_NODES, "too many menu nodes")) {
+      return false;
+    }
+
+    auto const first = static_cast<uint8_t>(nodeCount);
+    nodeCount += count;
+    if (nodes != nullptr) {
+      nodes[index].firstChild = first;
+      nodes[index].numChildren = static_cast<uint8_t>(count);
+    }
+
+    for (size_t i = 0; i < count; i++) {
+      if ((i > 0 && !check(consume(','), "expected ','")) || !parseNode(first + i, index, depth + 1)) {
+        return false;
+      }
+    }
+    return check(consume(']'), "expected ']'");
+  }
+
+  auto parseNode(uint8_t index, uint8_t parent, int depth) -> bool {
+    if (!check(consume('{'), "expected object")) {
+      return false;
+    }
+
+    MenuNode node{nullptr, parent, 0, 0, MenuAction::NONE, nullptr};
+    if (nodes != nullptr) {
+      nodes[index] = node;
+    }
+    bool hasLabel = false;
+    bool hasAction = false;
+    bool hasItems = false;
+
+    if (!consume('}')) {
+      do {
+        const char* key = nullptr;
+        size_t keyLength = 0;
+        if (!parseKey(key, keyLength)) {
+          return false;
+        }
+
+        if (keyLength == 5 && strncmp(key, "label", keyLength) == 0) {
+          hasLabel = parseString(node.label);
+        } else if (keyLength == 6 && strncmp(key, "action", keyLength) == 0) {
+          hasAction = parseString(node.payload);
+        } else if (keyLength == 5 && strncmp(key, "items", keyLength) == 0) {
+          hasItems = parseItems(index, depth);
+        } else {
+          skipValue();
+        }
+        if (error != nullptr) {
+          return false;
+        }
+      } while (consume(','));
+    }
+    if (!check(consume('}'), "expected '}'")) {
+      return false;
+    }
+
+    if (!check(index == 0 || hasLabel, "missing label") ||
+        !check(index != 0 || (hasItems && !hasAction), "root needs items") ||
+        !check(hasItems || hasAction, "leaf without action") ||
+        !check(!(hasItems && hasAction), "node with both items and action")) {
+      return false;
+    }
+
+    if (nodes != nullptr) {
+      nodes[index].label = node.label;
+      if (hasAction) {
+        bool const isUpdate = strcmp(node.payload, "update") == 0;
+        nodes[index].action = isUpdate ? MenuAction::OTA_UPDATE : MenuAction::PUBLISH;
+        nodes[index].payload = isUpdate ? nullptr : node.payload;
+      }
+    }
+    return true;
+  }
+};
+
+} // namespace
+
+auto MenuLoader::getInstance() -> MenuLoader& {
+  static MenuLoader instance;
+  return instance;
+}
+
+auto MenuLoader::onDefinitionReceived(const byte* payload, unsigned int length) -> void {
+  // Retained definitions are redelivered on every reconnect, only parse changes
+  uint32_t hash = FNV_OFFSET_BASIS;
+  for (unsigned int i = 0; i < length; i++) {
+    hash = (hash ^ payload[i]) * FNV_PRIME;
+  }
+  if (hash == lastDefinitionHash) {
+    return;
+  }
+  lastDefinitionHash = hash;
+
+  if (length == 0) {
+    LOG_INFO("Menu definition cleared, using built-in menu");
+    pendingMenu = nullptr;
+    menuPending.store(true, std::memory_order_release);
+    return;
+  }
+
+  const char* json = reinterpret_cast<const char*>(payload);
+  MenuParser measure(json, length, nullptr, nullptr);
+  if (!measure.parse()) {
+    LOG_ERROR("Rejected menu definition: %s", measure.getError());
+    return;
+  }
+
+  // Build into whichever arena is not on screen
+  int const target = activeArena == 0 ? 1 : 0;
+  MenuArena& arena = arenas[target];
+  arena.reset();
+  auto* nodes = static_cast<MenuNode*>(arena.allocate(sizeof(MenuNode) * measure.getNodeCount(), alignof(MenuNode)));
+  auto* strings = static_cast<char*>(arena.allocate(measure.getStringBytes(), 1));
+  if (nodes == nullptr || strings == nullptr) {
+    LOG_ERROR("Menu definition too large: %u nodes, %u string bytes", measure.getNodeCount(), measure.getStringBytes());
+    return;
+  }
+
+  MenuParser emit(json, length, nodes, strings);
+  emit.parse();
+
+  LOG_INFO("Loaded menu definition: %u nodes, %u arena bytes", measure.getNodeCount(), arena.getUsed());
+  stagedArena = target;
+  pendingMenu = nodes;
+  menuPending.store(true, std::memory_order_release);
+}
+
+auto MenuLoader::hasPendingMenu() const -> bool {
+  return menuPending.load(std::memory_order_acquire);
+}
+
+auto MenuLoader::takePendingMenu(const MenuNode*& menu) -> bool {
+  if (!menuPending.exchange(false, std::memory_order_acquire)) {
+    return false;
+  }
+
+  menu = pendingMenu;
+  activeArena = menu == nullptr ? -1 : stagedArena;
+  return true;
+}
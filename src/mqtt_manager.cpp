@@ -2,10 +2,19 @@
 #include "config.h"
 #include "sign_state.h"
 #include "app_state.h"
+#include "input_recorder.h"
+#include "menu_loader.h"
+#include "boot_sequence.h"
+#include "breadcrumbs.h"
+#include "wifi_connection.h"
+#include "network_task.h"
+#include "scheduler.h"
+#include "screen_mirror.h"
+#include "profiler.h"
+#include "rules_engine.h"
 #include <Arduino.h>
 #include <ctime>
 #include <Preferences.h>
-#include <Elog.h>
 #include <logging.h>
 #include <display.h>
 
@@ -14,6 +23,7 @@ const char* MQTTManager::mqtt_client_id = "desk-control-panel";
 // NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables) - static const class member
 const char* MQTTManager::mqtt_topic_prefix = "desk-control/";
 const unsigned long MQTTManager::MQTT_RECONNECT_INTERVAL = 5000; // 5 seconds
+const unsigned long MQTTManager::MQTT_POLL_INTERVAL = 25; // PubSubClient has no data-ready callback
 const int DEFAULT_MQTT_PORT = 1883;
 
 auto MQTTManager::getInstance() -> MQTTManager& {
@@ -22,9 +32,7 @@ auto MQTTManager::getInstance() -> MQTTManager& {
 }
 
 auto MQTTManager::init() -> void {
-  Logger.debug(MAIN_LOG, "Initializing MQTT manager...");
-
-  Display::getInstance().setLoadingMessage("Connecting to", "Home Assistant");
+  LOG_DEBUG("Initializing MQTT manager...");
 
   Preferences preferences;
   preferences.begin("mqtt_config", true);
@@ -34,14 +42,45 @@ auto MQTTManager::init() -> void {
   this->mqtt_password = preferences.getString("password", "");
   preferences.end();
 
+  for (size_t i = 0; i < BUTTON_COUNT; i++) {
+    buttonTopics[i] = fullTopic("button/");
+    buttonTopics[i].appendf("%u/pressed", static_cast<unsigned int>(i + 1));
+  }
+
   setupMQTT();
-  Logger.debug(MAIN_LOG, "MQTT manager initialized.");
+  initialized = true;
+
+  // Connect on the next update rather than blocking the caller
+  lastMqttReconnectAttempt = millis() - MQTT_RECONNECT_INTERVAL;
+  LOG_DEBUG("MQTT manager initialized.");
 }
 
 auto MQTTManager::update() -> void {
+  // Queued publishes are sent, or fail with a log line, like direct ones did
+  drainPublishes();
+
+  if (!initialized) {
+    return;
+  }
+
   unsigned long const currentMillis = millis();
+
+  // Connect attempts without a link only burn time in DNS and TCP timeouts
+  if (!WiFiConnection::getInstance().isLinkUp()) {
+    if (mqtt_client.connected()) {
+      mqtt_client.disconnect();
+    }
+    wasConnected = false;
+    lastMqttReconnectAttempt = currentMillis - MQTT_RECONNECT_INTERVAL; // Retry as soon as the link is back
+    clientState.store(mqtt_client.state());
+    return;
+  }
   
   if (!mqtt_client.connected()) {
+    if (wasConnected) {
+      wasConnected = false;
+      Breadcrumbs::getInstance().record(Breadcrumb::MQTT_LOST, 0, static_cast<uint16_t>(mqtt_client.state()));
+    }
     if (currentMillis - lastMqttReconnectAttempt >= MQTT_RECONNECT_INTERVAL) {
       lastMqttReconnectAttempt = currentMillis;
       mqttReconnect();
@@ -49,86 +88,268 @@ auto MQTTManager::update() -> void {
   } else {
     mqtt_client.loop();
   }
+  clientState.store(mqtt_client.state());
+}
+
+auto MQTTManager::getNextDeadline() -> unsigned long {
+  if (!initialized || !WiFiConnection::getInstance().isLinkUp()) {
+    return Scheduler::NO_DEADLINE;
+  }
+  if (mqtt_client.connected()) {
+    return millis() + MQTT_POLL_INTERVAL;
+  }
+  return lastMqttReconnectAttempt + MQTT_RECONNECT_INTERVAL;
 }
 
 auto MQTTManager::isConnected() -> bool {
   return mqtt_client.connected();
 }
 
+auto MQTTManager::getClientState() const -> int {
+  return clientState.load();
+}
+
 auto MQTTManager::publishMessage(const char* topic, const char* message) -> void {
+  publishToTopic(fullTopic(topic).c_str(), message);
+}
+
+auto MQTTManager::publishToTopic(const char* topic, const char* message) -> void {
   if (mqtt_client.connected()) {
-    String const full_topic = String(mqtt_topic_prefix) + topic;
-    mqtt_client.publish(full_topic.c_str(), message);
-    Logger.debug(MAIN_LOG, "MQTT: %s -> %s", full_topic.c_str(), message);
+    mqtt_client.publish(topic, message);
+    LOG_DEBUG("MQTT: %s -> %s", topic, message);
   } else {
-    Logger.error(MAIN_LOG, "MQTT not connected, failed to send: %s -> %s", topic, message);
+    LOG_ERROR("MQTT not connected, failed to send: %s -> %s", topic, message);
+  }
+}
+
+// Streamed into the client, so the document can outgrow the client buffer
+// and is never held as text
+auto MQTTManager::publishJson(const char* topic, const JsonDocument& doc, bool retained) -> bool {
+  if (doc.overflowed()) {
+    LOG_ERROR("JSON for %s ran out of memory", topic);
+    return false;
   }
+
+  size_t const json_size = measureJson(doc);
+  if (mqtt_client.beginPublish(topic, json_size, retained) &&
+      serializeJson(doc, mqtt_client) == json_size &&
+      mqtt_client.endPublish() != 0) {
+    LOG_DEBUG("MQTT: %s (%u bytes of JSON)", topic, static_cast<unsigned int>(json_size));
+    return true;
+  }
+  LOG_ERROR("Failed to publish %s, MQTT client state: %d", topic, mqtt_client.state());
+  return false;
+}
+
+auto MQTTManager::fullTopic(const char* topic) -> Topic {
+  Topic full(mqtt_topic_prefix);
+  full.append(topic);
+  return full;
 }
 
 auto MQTTManager::publishButtonState(int button_num, bool pressed) -> void {
   // Only publish on button press, not release
-  if (pressed) {
-    // Get current time and format as ISO timestamp
-    struct tm timeInfo{};
-    if (getLocalTime(&timeInfo)) {
-      const int TIMESTAMP_LENGTH = 32;
-      std::array<char, TIMESTAMP_LENGTH> timestamp{};
-      strftime(timestamp.data(), timestamp.size(), "%Y-%m-%dT%H:%M:%S%z", &timeInfo);
-      
-      String const topic = "button/" + String(button_num) + "/pressed";
-      publishMessage((const char*)topic.c_str(), (const char*)timestamp.data());
-    } else {
-      // Fallback to millis if time not available
-      String const topic = "button/" + String(button_num) + "/pressed";
-      String const message = String(millis());
-      publishMessage((const char*)topic.c_str(), (const char*)message.c_str());
+  if (pressed && button_num >= 1 && button_num <= static_cast<int>(BUTTON_COUNT)) {
+    PublishRequest request{};
+    request.kind = PublishRequest::Kind::BUTTON;
+    request.button = static_cast<uint8_t>(button_num);
+    enqueue(request);
+  }
+}
+
+auto MQTTManager::publishGesture(const char* input, Gesture gesture) -> void {
+  PublishRequest request{};
+  request.kind = PublishRequest::Kind::GESTURE;
+  request.input = input;
+  request.gesture = gesture;
+  enqueue(request);
+}
+
+auto MQTTManager::publishAction(const char* action) -> void {
+  PublishRequest request{};
+  request.kind = PublishRequest::Kind::ACTION;
+  request.action.append(action);
+  if (request.action.isTruncated()) {
+    LOG_ERROR("Action too long to publish: %s", action);
+    return;
+  }
+  enqueue(request);
+}
+
+#ifdef SOAK_TEST
+auto MQTTManager::reconnect() -> void {
+  PublishRequest request{};
+  request.kind = PublishRequest::Kind::RECONNECT;
+  enqueue(request);
+}
+#endif
+
+auto MQTTManager::hasPendingPublishes() const -> bool {
+  return !outbound.empty() || ScreenMirror::getInstance().hasFrames();
+}
+
+auto MQTTManager::enqueue(const PublishRequest& request) -> void {
+  if (!outbound.push(request)) {
+    droppedPublishes++;
+    LOG_WARNING("Publish queue full, %u publishes dropped", droppedPublishes);
+    return;
+  }
+  Scheduler::getNetworkInstance().notify();
+}
+
+auto MQTTManager::drainPublishes() -> void {
+  PublishRequest request{};
+  while (outbound.pop(request)) {
+    sendRequest(request);
+  }
+
+  // Frames are dropped while offline; resend() catches up on reconnect
+  ScreenMirror& mirror = ScreenMirror::getInstance();
+  while (const ScreenMirror::Frame* frame = mirror.nextFrame()) {
+    if (mqtt_client.connected()) {
+      mqtt_client.publish(fullTopic("screen").c_str(), frame->payload.data(), frame->length, true);
     }
+    mirror.releaseFrame();
   }
 }
 
-auto MQTTManager::publishAction(const String& action) -> void {
-  publishMessage("action", action.c_str());
+// Events are named after their topics below the prefix, so a button's
+// event is the tail of its prebuilt topic
+auto MQTTManager::sendRequest(const PublishRequest& request) -> void {
+  size_t const prefixLength = strlen(mqtt_topic_prefix);
+  switch (request.kind) {
+    case PublishRequest::Kind::BUTTON: {
+      const Topic& topic = buttonTopics[request.button - 1];
+      Timestamp const timestamp = currentTimestamp();
+      publishRuleTargets(topic.c_str() + prefixLength, timestamp.c_str());
+      publishToTopic(topic.c_str(), timestamp.c_str());
+      break;
+    }
+    case PublishRequest::Kind::GESTURE: {
+      Topic topic = fullTopic(request.input);
+      topic.append('/').append(GestureRecognizer::getGestureName(request.gesture));
+      Timestamp const timestamp = currentTimestamp();
+      publishRuleTargets(topic.c_str() + prefixLength, timestamp.c_str());
+      publishToTopic(topic.c_str(), timestamp.c_str());
+      break;
+    }
+    case PublishRequest::Kind::ACTION: {
+      FixedString<MAX_ACTION_LENGTH + sizeof("action/")> event("action/");
+      event.append(request.action.c_str());
+      publishRuleTargets(event.c_str(), nullptr);
+      publishMessage("action", request.action.c_str());
+      break;
+    }
+#ifdef PROFILING
+    case PublishRequest::Kind::PROFILE:
+      publishProfile();
+      break;
+#endif
+#ifdef SOAK_TEST
+    case PublishRequest::Kind::RECONNECT:
+      mqtt_client.disconnect();
+      mqttReconnect();
+      break;
+#endif
+    default:
+      break;
+  }
+}
+
+// Direct publishes for an event, sent back to back ahead of the Home
+// Assistant one so the target device hears first. Without a timestamp one
+// is only made if a payload uses it.
+auto MQTTManager::publishRuleTargets(const char* event, const char* timestamp) -> void {
+  size_t count = 0;
+  const RulesEngine::Target* targets = RulesEngine::getInstance().match(event, count);
+  if (count == 0) {
+    return;
+  }
+  if (!mqtt_client.connected()) {
+    LOG_ERROR("MQTT not connected, %u rule publishes for %s dropped", static_cast<unsigned int>(count), event);
+    return;
+  }
+
+  Timestamp ownTimestamp;
+  RulesEngine::Payload payload;
+  for (size_t i = 0; i < count; i++) {
+    const RulesEngine::Target& target = targets[i];
+    if (timestamp == nullptr && RulesEngine::usesTimestamp(target.payload)) {
+      ownTimestamp = currentTimestamp();
+      timestamp = ownTimestamp.c_str();
+    }
+    if (!RulesEngine::expand(target.payload, event, timestamp, payload)) {
+      LOG_ERROR("Rule payload for %s too long after expansion", target.topic);
+      continue;
+    }
+    if (!mqtt_client.publish(target.topic, reinterpret_cast<const uint8_t*>(payload.c_str()), payload.length(),
+                             target.retained)) {
+      LOG_ERROR("Failed to publish rule target %s", target.topic);
+    }
+  }
+  LOG_DEBUG("MQTT: %s -> %u rule publishes", event, static_cast<unsigned int>(count));
+}
+
+auto MQTTManager::currentTimestamp() -> Timestamp {
+  // Get current time and format as ISO timestamp
+  struct tm timeInfo{};
+  Timestamp timestamp;
+  // Don't wait for an unset clock, this runs on the network task
+  if (getLocalTime(&timeInfo, 0)) {
+    std::array<char, MAX_TIMESTAMP_LENGTH> formatted{};
+    strftime(formatted.data(), formatted.size(), "%Y-%m-%dT%H:%M:%S%z", &timeInfo);
+    return timestamp.append(formatted.data());
+  }
+
+  // Fallback to millis if time not available
+  return timestamp.appendf("%lu", millis());
 }
 
 
 auto MQTTManager::setupMQTT() -> void {
-  Logger.debug(MAIN_LOG, "Setting up MQTT connection...");
+  LOG_DEBUG("Setting up MQTT connection...");
 
   mqtt_client.setServer(mqtt_server.c_str(), mqtt_port);
-  mqtt_client.setCallback(onMqttMessage);
+  // Handled on the loop task; the client reuses its buffer for the next one.
+  // Rules are matched on the network task, so they are loaded here.
+  mqtt_client.setCallback([](char* topic, byte* payload, unsigned int length) {
+    if (strcmp(topic, "desk-control/rules") == 0) {
+      RulesEngine::getInstance().onDefinitionReceived(payload, length);
+      return;
+    }
+    NetworkTask::getInstance().postMessage(topic, payload, length);
+  });
 
   // Increase MQTT buffer size to handle larger discovery messages
   mqtt_client.setBufferSize(2048);
-  
-  // Initial connection attempt
-  mqttReconnect();
 }
 
 auto MQTTManager::mqttReconnect() -> void {
   if (mqtt_client.connected()) {
     return;
   }
+  PROFILE_SCOPE("mqtt.reconnect");
 
-  Logger.debug(MAIN_LOG, "Attempting MQTT connection...");
+  LOG_DEBUG("Attempting MQTT connection...");
 
-  Logger.debug(MAIN_LOG, "Server: %s, Port: %d, Username: %s", mqtt_server.c_str(), mqtt_port, mqtt_username.c_str());
+  LOG_DEBUG("Server: %s, Port: %d, Username: %s", mqtt_server.c_str(), mqtt_port, mqtt_username.c_str());
 
   // Set up Last Will and Testament
-  String const will_topic = String(mqtt_topic_prefix) + "status";
+  Topic const will_topic = fullTopic("status");
 
   if (mqtt_client.connect(mqtt_client_id, mqtt_username.c_str(), mqtt_password.c_str(), will_topic.c_str(), 0, true, "offline")) {
-    Logger.debug(MAIN_LOG, "MQTT connected");
+    LOG_DEBUG("MQTT connected");
+    wasConnected = true;
+    Breadcrumbs::getInstance().record(Breadcrumb::MQTT_UP);
     
     // Publish online status
     mqtt_client.publish(will_topic.c_str(), "online", true);
     
     // Publish device info
-    String topic = String(mqtt_topic_prefix) + "device_info";
-    mqtt_client.publish(topic.c_str(), "desk-control-panel", true);
+    mqtt_client.publish(fullTopic("device_info").c_str(), "desk-control-panel", true);
     
     // Publish firmware version or build info
-    topic = String(mqtt_topic_prefix) + "version";
-    mqtt_client.publish(topic.c_str(), VERSION, true);
+    mqtt_client.publish(fullTopic("version").c_str(), VERSION, true);
     
     // Publish Home Assistant discovery message
     publishDiscoveryMessage();
@@ -141,17 +362,130 @@ auto MQTTManager::mqttReconnect() -> void {
     
     // Subscribe to PC monitoring topics
     subscribeToPcMonitoring();
+
+    // Subscribe to the retained menu definition
+    subscribeToMenuDefinition();
+
+    // Subscribe to the mirror rate, and catch the mirror up on frames
+    // dropped while offline
+    subscribeToMirrorConfig();
+    ScreenMirror::getInstance().resend();
+
+    // Subscribe to the retained local rules
+    subscribeToRules();
+
+#ifdef PROFILING
+    subscribeToProfileRequests();
+#endif
+
+    publishLinkStats();
+
+    if (BootSequence::getInstance().getMilestone(BootMilestone::MQTT_READY) == 0) {
+      BootSequence::getInstance().markMilestone(BootMilestone::MQTT_READY);
+      publishBootMetrics();
+      publishBreadcrumbs();
+    }
     
   } else {
-    Logger.error(MAIN_LOG, "MQTT connection failed, rc=%d. Retrying in %lu ms", mqtt_client.state(), MQTT_RECONNECT_INTERVAL);
+    LOG_ERROR("MQTT connection failed, rc=%d. Retrying in %lu ms", mqtt_client.state(), MQTT_RECONNECT_INTERVAL);
   }
 }
 
+auto MQTTManager::publishOtaReport(const OtaReport& report) -> void {
+  JsonDocument doc;
+  doc["result"] = report.result;
+  doc["compressed"] = report.compressed;
+  doc["bytes"] = report.bytes;
+  doc["image_bytes"] = report.imageBytes;
+  doc["duration_ms"] = report.durationMs;
+  doc["inflate_ms"] = report.inflateMs;
+  doc["kbps"] = report.kilobytesPerSecond;
+
+  publishJson(fullTopic("ota").c_str(), doc, false);
+}
+
+auto MQTTManager::publishLinkStats() -> void {
+  WiFiConnection& wifi = WiFiConnection::getInstance();
+
+  JsonDocument doc;
+  doc["rssi"] = wifi.getRssi();
+  doc["disconnects"] = wifi.getDisconnectCount();
+  doc["last_recovery_ms"] = wifi.getLastRecoveryMs();
+
+  publishJson(fullTopic("wifi").c_str(), doc, true);
+}
+
+auto MQTTManager::publishBootMetrics() -> void {
+  BootSequence& boot = BootSequence::getInstance();
+
+  JsonDocument doc;
+  doc["first_frame_ms"] = boot.getMilestone(BootMilestone::FIRST_FRAME);
+  doc["input_ms"] = boot.getMilestone(BootMilestone::INPUT_READY);
+  doc["mqtt_ms"] = boot.getMilestone(BootMilestone::MQTT_READY);
+
+  const WiFiTimings& wifi = WiFiConnection::getInstance().getTimings();
+  JsonObject wifiTimings = doc["wifi"].to<JsonObject>();
+  wifiTimings["fast"] = wifi.fastConnect;
+  wifiTimings["associate_ms"] = wifi.associateMs;
+  wifiTimings["ip_ms"] = wifi.ipMs;
+  wifiTimings["total_ms"] = wifi.totalMs;
+
+  publishJson(fullTopic("boot").c_str(), doc, true);
+  LOG_INFO("Boot timings: first frame %lu ms, input %lu ms, MQTT %lu ms, WiFi %lu ms", boot.getMilestone(BootMilestone::FIRST_FRAME),
+           boot.getMilestone(BootMilestone::INPUT_READY), boot.getMilestone(BootMilestone::MQTT_READY),
+           wifi.totalMs);
+}
+
+// What the previous boot left behind, so field resets can be diagnosed
+// without a serial cable
+auto MQTTManager::publishBreadcrumbs() -> void {
+  Breadcrumbs& breadcrumbs = Breadcrumbs::getInstance();
+
+  JsonDocument doc;
+  doc["reset_reason"] = breadcrumbs.getResetReason();
+
+  const BreadcrumbLog* log = breadcrumbs.getPrevious();
+  if (log != nullptr) {
+    doc["boot"] = log->bootCount;
+    doc["uptime_ms"] = log->uptimeMs;
+    doc["min_free_heap"] = log->minFreeHeap;
+    doc["max_task_us"] = log->maxTaskMicros;
+    doc["slowest_task"] = Scheduler::getTaskName(log->slowestTask);
+    JsonArray running = doc["running_tasks"].to<JsonArray>();
+    for (uint8_t const task : log->runningTasks) {
+      if (task != Breadcrumbs::NO_TASK) {
+        running.add(Scheduler::getTaskName(task));
+      }
+    }
+
+    // Oldest first: [timestamp_ms, event, detail, value]
+    JsonArray events = doc["events"].to<JsonArray>();
+    size_t const oldest = (log->head + BreadcrumbLog::CAPACITY - log->count) % BreadcrumbLog::CAPACITY;
+    for (size_t i = 0; i < log->count; i++) {
+      const BreadcrumbEntry& entry = log->entries[(oldest + i) % BreadcrumbLog::CAPACITY];
+      JsonArray event = events.add<JsonArray>();
+      event.add(entry.timestamp);
+      event.add(Breadcrumbs::getEventName(entry.event));
+      event.add(entry.detail);
+      event.add(entry.value);
+    }
+  }
+
+  publishJson(fullTopic("breadcrumbs").c_str(), doc, true);
+}
+
 auto MQTTManager::publishDiscoveryMessage() -> void {
-  Logger.debug(MAIN_LOG, "Publishing Home Assistant discovery message...");
+  LOG_DEBUG("Publishing Home Assistant discovery message...");
+
+  // Names and topics are built in fixed buffers and handed over as char*,
+  // which ArduinoJson copies into the document (it keeps const char* by
+  // pointer)
+  using Name = FixedString<64>;
 
   // Get device IP for the origin URL
-  String const device_ip = WiFi.localIP().toString();
+  IPAddress const ip = WiFi.localIP();
+  Name device_url;
+  device_url.appendf("http://%u.%u.%u.%u", ip[0], ip[1], ip[2], ip[3]);
   
   // Create the discovery JSON document with larger buffer
   JsonDocument doc;
@@ -169,40 +503,76 @@ auto MQTTManager::publishDiscoveryMessage() -> void {
   JsonObject origin = doc["o"].to<JsonObject>();
   origin["name"] = "Desk Control Panel";
   origin["sw"] = VERSION;
-  origin["url"] = "http://" + device_ip;
+  origin["url"] = device_url.data();
   
   // Components
   JsonObject cmps = doc["cmps"].to<JsonObject>();
   
   // Add button components as timestamp sensors
-  const int NUM_BUTTONS = 5;
-  for (int i = 1; i <= NUM_BUTTONS; i++) {
-    String const component_id = String(mqtt_client_id) + "_button_" + String(i);
-    JsonObject button = cmps[component_id].to<JsonObject>();
+  for (size_t i = 0; i < BUTTON_COUNT; i++) {
+    unsigned int const number = i + 1;
+    Name component_id(mqtt_client_id);
+    component_id.appendf("_button_%u", number);
+    Name name;
+    name.appendf("Button %u", number);
+    JsonObject button = cmps[component_id.data()].to<JsonObject>();
     button["p"] = "sensor";
-    button["unique_id"] = component_id;
-    button["name"] = "Button " + String(i);
-    button["state_topic"] = String(mqtt_topic_prefix) + "button/" + String(i) + "/pressed";
+    button["unique_id"] = component_id.data();
+    button["name"] = name.data();
+    button["state_topic"] = buttonTopics[i].c_str();
     button["device_class"] = "timestamp";
     button["icon"] = "mdi:button-pointer";
   }
+
+  // Add gesture triggers for the buttons and the dial
+  const std::array<Gesture, 4> gestures = {Gesture::CLICK, Gesture::DOUBLE_CLICK, Gesture::LONG_PRESS, Gesture::HOLD_REPEAT};
+  const std::array<const char*, 4> trigger_types = {"button_short_press", "button_double_press", "button_long_press", "button_hold_repeat"};
+  for (size_t i = 0; i <= BUTTON_COUNT; i++) {
+    bool const is_dial = i == BUTTON_COUNT;
+    Name input;
+    Name subtype;
+    if (is_dial) {
+      input.append("dial");
+      subtype.append("dial");
+    } else {
+      input.appendf("button/%u", static_cast<unsigned int>(i + 1));
+      subtype.appendf("button_%u", static_cast<unsigned int>(i + 1));
+    }
+    for (size_t g = 0; g < gestures.size(); g++) {
+      const char* gesture_name = GestureRecognizer::getGestureName(gestures[g]);
+      Name component_id(mqtt_client_id);
+      component_id.append('_').append(subtype.c_str()).append('_').append(gesture_name);
+      Topic topic = fullTopic(input.c_str());
+      topic.append('/').append(gesture_name);
+      JsonObject trigger = cmps[component_id.data()].to<JsonObject>();
+      trigger["p"] = "device_automation";
+      trigger["automation_type"] = "trigger";
+      trigger["topic"] = topic.data();
+      trigger["type"] = trigger_types[g];
+      trigger["subtype"] = subtype.data();
+    }
+  }
   
   // Add action sensor component
-  String const action_component_id = String(mqtt_client_id) + "_action";
-  JsonObject action = cmps[action_component_id].to<JsonObject>();
+  Name action_component_id(mqtt_client_id);
+  action_component_id.append("_action");
+  Topic action_topic = fullTopic("action");
+  JsonObject action = cmps[action_component_id.data()].to<JsonObject>();
   action["p"] = "sensor";
-  action["unique_id"] = action_component_id;
+  action["unique_id"] = action_component_id.data();
   action["name"] = "Last Action";
-  action["state_topic"] = String(mqtt_topic_prefix) + "action";
+  action["state_topic"] = action_topic.data();
   action["icon"] = "mdi:gesture-tap";
   
   // Add status sensor component
-  String const status_component_id = String(mqtt_client_id) + "_status";
-  JsonObject status = cmps[status_component_id].to<JsonObject>();
+  Name status_component_id(mqtt_client_id);
+  status_component_id.append("_status");
+  Topic status_topic = fullTopic("status");
+  JsonObject status = cmps[status_component_id.data()].to<JsonObject>();
   status["p"] = "binary_sensor";
-  status["unique_id"] = status_component_id;
+  status["unique_id"] = status_component_id.data();
   status["name"] = "Status";
-  status["state_topic"] = String(mqtt_topic_prefix) + "status";
+  status["state_topic"] = status_topic.data();
   status["payload_on"] = "online";
   status["payload_off"] = "offline";
   status["device_class"] = "connectivity";
@@ -210,35 +580,20 @@ auto MQTTManager::publishDiscoveryMessage() -> void {
   // QoS
   doc["qos"] = 2;
   
-  // Serialize and publish
-  String json_string;
-  size_t json_size = serializeJson(doc, json_string);
-
-  if (json_size == 0) {
-    Logger.error(MAIN_LOG, "Failed to serialize discovery message");
-    return;
-  }
-
-  Logger.debug(MAIN_LOG, "Discover Message JSON size: %d bytes", json_size);
-  Logger.debug(MAIN_LOG, "JSON content preview: %.200s...", json_string.c_str());
-
-  String const discovery_topic = "homeassistant/device/" + String(mqtt_client_id) + "/config";
-  
-  if (mqtt_client.publish(discovery_topic.c_str(), json_string.c_str(), true)) {
-    Logger.debug(MAIN_LOG, "Discovery message published successfully");
-    Logger.debug(MAIN_LOG, "Topic: %s", discovery_topic.c_str());
-    Logger.debug(MAIN_LOG, "Payload length: %d bytes", json_string.length());
-  } else {
-    Logger.error(MAIN_LOG, "Failed to publish discovery message, MQTT client state: %d", mqtt_client.state());
+  // The gesture triggers push the document well past the client buffer
+  Topic discovery_topic("homeassistant/device/");
+  discovery_topic.append(mqtt_client_id).append("/config");
+  if (publishJson(discovery_topic.c_str(), doc, true)) {
+    LOG_DEBUG("Discovery message published successfully");
   }
 }
 
 auto MQTTManager::subscribeToSignImage() -> void {
   const char* topic = "office_sign/image/set";
   if (mqtt_client.subscribe(topic)) {
-    Logger.debug(MAIN_LOG, "Subscribed to sign image topic: %s", topic);
+    LOG_DEBUG("Subscribed to sign image topic: %s", topic);
   } else {
-    Logger.error(MAIN_LOG, "Failed to subscribe to sign image topic: %s", topic);
+    LOG_ERROR("Failed to subscribe to sign image topic: %s", topic);
   }
 }
 
@@ -247,15 +602,15 @@ auto MQTTManager::subscribeToStatusTopics() -> void {
   const char* fanTopic = "desk-control/fan-status";
   
   if (mqtt_client.subscribe(lightTopic)) {
-    Logger.debug(MAIN_LOG, "Subscribed to light status topic: %s", lightTopic);
+    LOG_DEBUG("Subscribed to light status topic: %s", lightTopic);
   } else {
-    Logger.error(MAIN_LOG, "Failed to subscribe to light status topic: %s", lightTopic);
+    LOG_ERROR("Failed to subscribe to light status topic: %s", lightTopic);
   }
   
   if (mqtt_client.subscribe(fanTopic)) {
-    Logger.debug(MAIN_LOG, "Subscribed to fan status topic: %s", fanTopic);
+    LOG_DEBUG("Subscribed to fan status topic: %s", fanTopic);
   } else {
-    Logger.error(MAIN_LOG, "Failed to subscribe to fan status topic: %s", fanTopic);
+    LOG_ERROR("Failed to subscribe to fan status topic: %s", fanTopic);
   }
 }
 
@@ -273,27 +628,107 @@ auto MQTTManager::subscribeToPcMonitoring() -> void {
   
   for (const char* topic : topics) {
     if (mqtt_client.subscribe(topic)) {
-      Logger.debug(MAIN_LOG, "Subscribed to PC monitoring topic: %s", topic);
+      LOG_DEBUG("Subscribed to PC monitoring topic: %s", topic);
     } else {
-      Logger.error(MAIN_LOG, "Failed to subscribe to PC monitoring topic: %s", topic);
+      LOG_ERROR("Failed to subscribe to PC monitoring topic: %s", topic);
     }
   }
 }
 
+auto MQTTManager::subscribeToMenuDefinition() -> void {
+  const char* topic = "desk-control/menu";
+  if (mqtt_client.subscribe(topic)) {
+    LOG_DEBUG("Subscribed to menu definition topic: %s", topic);
+  } else {
+    LOG_ERROR("Failed to subscribe to menu definition topic: %s", topic);
+  }
+}
+
+auto MQTTManager::subscribeToMirrorConfig() -> void {
+  const char* topic = "desk-control/mirror/fps";
+  if (mqtt_client.subscribe(topic)) {
+    LOG_DEBUG("Subscribed to screen mirror rate: %s", topic);
+  } else {
+    LOG_ERROR("Failed to subscribe to screen mirror rate: %s", topic);
+  }
+}
+
+auto MQTTManager::subscribeToRules() -> void {
+  const char* topic = "desk-control/rules";
+  if (mqtt_client.subscribe(topic)) {
+    LOG_DEBUG("Subscribed to rules topic: %s", topic);
+  } else {
+    LOG_ERROR("Failed to subscribe to rules topic: %s", topic);
+  }
+}
+
+#ifdef PROFILING
+auto MQTTManager::subscribeToProfileRequests() -> void {
+  const char* topic = "desk-control/profile/dump";
+  if (mqtt_client.subscribe(topic)) {
+    LOG_DEBUG("Subscribed to profile requests: %s", topic);
+  } else {
+    LOG_ERROR("Failed to subscribe to profile requests: %s", topic);
+  }
+}
+
+auto MQTTManager::publishProfile() -> void {
+  Profiler& profiler = Profiler::getInstance();
+
+  JsonDocument doc;
+  JsonObject zones = doc["zones"].to<JsonObject>();
+  for (uint8_t i = 0; i < profiler.getZoneCount(); i++) {
+    const ProfileZone& entry = profiler.getZone(i);
+    if (entry.name == nullptr) {
+      continue;
+    }
+    JsonObject zone = zones[entry.name].to<JsonObject>();
+    zone["n"] = entry.count;
+    zone["min_us"] = profiler.toMicros(entry.minCycles);
+    zone["avg_us"] = entry.count == 0 ? 0 : profiler.toMicros(entry.totalCycles / entry.count);
+    zone["max_us"] = profiler.toMicros(entry.maxCycles);
+    JsonArray histogram = zone["histogram"].to<JsonArray>();
+    for (uint32_t const count : entry.histogram) {
+      histogram.add(count);
+    }
+  }
+
+  publishJson(fullTopic("profile").c_str(), doc, false);
+}
+#endif
+
 auto MQTTManager::onMqttMessage(char* topic, byte* payload, unsigned int length) -> void {
-  // Convert payload to string
-  String message;
-  message.reserve(length + 1);
-  for (unsigned int i = 0; i < length; i++) {
-    message += static_cast<char>(payload[i]);
+  PROFILE_SCOPE("mqtt.message");
+  InputRecorder::getInstance().recordMqttMessage(topic, payload, length);
+
+  // Menu definitions are parsed straight from the payload
+  if (strcmp(topic, "desk-control/menu") == 0) {
+    MenuLoader::getInstance().onDefinitionReceived(payload, length);
+    return;
   }
-  
-  // Check if this is a sign image update
+
+#ifdef PROFILING
+  if (strcmp(topic, "desk-control/profile/dump") == 0) {
+    PublishRequest request{};
+    request.kind = PublishRequest::Kind::PROFILE;
+    MQTTManager::getInstance().enqueue(request);
+    return;
+  }
+#endif
+
+  // Sign images are decoded straight from the payload
   if (strcmp(topic, "office_sign/image/set") == 0) {
-    SignState::getInstance().onImageReceived(message);
+    SignState::getInstance().onImageReceived(payload, length);
+    return;
   }
+
+  // Everything else is a short state or number; longer payloads are cut
+  // off rather than copied to the heap
+  FixedString<MAX_STATE_LENGTH> message;
+  message.append(reinterpret_cast<const char*>(payload), length);
+  
   // Check if this is a light status update
-  else if (strcmp(topic, "desk-control/light-status") == 0) {
+  if (strcmp(topic, "desk-control/light-status") == 0) {
     bool const lightOn = (message == "on");
     AppState::getInstance().setLightStatus(lightOn);
   }
@@ -309,32 +744,36 @@ auto MQTTManager::onMqttMessage(char* topic, byte* payload, unsigned int length)
   }
   // Check if this is a CPU temperature update
   else if (strcmp(topic, "homeassistant/sensor/pc_status_monitor_cpu_temp_avg/state") == 0) {
-    float const temp = message.toFloat();
+    float const temp = strtof(message.c_str(), nullptr);
     AppState::getInstance().setCpuTemp(temp);
   }
   // Check if this is a CPU usage update
   else if (strcmp(topic, "homeassistant/sensor/pc_status_monitor_cpu_usage_avg/state") == 0) {
-    float const usage = message.toFloat();
+    float const usage = strtof(message.c_str(), nullptr);
     AppState::getInstance().setCpuUsage(usage);
   }
   // Check if this is a GPU temperature update
   else if (strcmp(topic, "homeassistant/sensor/pc_status_monitor_gpu_temp/state") == 0) {
-    float const temp = message.toFloat();
+    float const temp = strtof(message.c_str(), nullptr);
     AppState::getInstance().setGpuTemp(temp);
   }
   // Check if this is a GPU usage update
   else if (strcmp(topic, "homeassistant/sensor/pc_status_monitor_gpu_util/state") == 0) {
-    float const usage = message.toFloat();
+    float const usage = strtof(message.c_str(), nullptr);
     AppState::getInstance().setGpuUsage(usage);
   }
   // Check if this is a RAM usage update
   else if (strcmp(topic, "homeassistant/sensor/pc_status_monitor_ram_usage/state") == 0) {
-    float const usage = message.toFloat();
+    float const usage = strtof(message.c_str(), nullptr);
     AppState::getInstance().setRamUsage(usage);
   }
   // Check if this is a GPU memory usage update
   else if (strcmp(topic, "homeassistant/sensor/pc_status_monitor_gpu_mem_util/state") == 0) {
-    float const usage = message.toFloat();
+    float const usage = strtof(message.c_str(), nullptr);
     AppState::getInstance().setGpuMemUsage(usage);
   }
+  else if (strcmp(topic, "desk-control/mirror/fps") == 0) {
+    long const fps = strtol(message.c_str(), nullptr, 10); // NOLINT - base10, safe conversion
+    ScreenMirror::getInstance().setMaxFps(static_cast<uint8_t>(min(max(fps, 0L), static_cast<long>(ScreenMirror::MAX_FPS))));
+  }
 }
@@ -0,0 +1,93 @@
+#include "network_task.h"
+#include "app_state.h"
+#include "mqtt_manager.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include <Arduino.h>
+#include <logging.h>
+
+const uint32_t NETWORK_TASK_STACK_SIZE = 8192;
+const UBaseType_t NETWORK_TASK_PRIORITY = 1;
+const BaseType_t NETWORK_TASK_CORE = 0; // Away from the loop task on core 1
+
+auto NetworkTask::getInstance() -> NetworkTask& {
+  static NetworkTask instance;
+  return instance;
+}
+
+auto NetworkTask::start() -> void {
+  if (xTaskCreatePinnedToCore(run, "network", NETWORK_TASK_STACK_SIZE, nullptr, NETWORK_TASK_PRIORITY, nullptr,
+                              NETWORK_TASK_CORE) != pdPASS) {
+    LOG_ERROR("Failed to start network task");
+  }
+}
+
+auto NetworkTask::run(void* /*parameter*/) -> void {
+  Scheduler& scheduler = Scheduler::getNetworkInstance();
+  scheduler.init();
+  for (;;) {
+    scheduler.waitForWork();
+    PROFILE_SCOPE("network");
+    scheduler.runDue();
+  }
+}
+
+auto NetworkTask::acquireSlot() -> InboundUpdate* {
+  InboundUpdate* slot = inbound.acquire();
+  if (slot == nullptr) {
+    droppedUpdates++;
+    LOG_WARNING("Inbound queue full, %u updates dropped", droppedUpdates);
+  }
+  return slot;
+}
+
+auto NetworkTask::postMessage(const char* topic, const uint8_t* payload, unsigned int length) -> bool {
+  if (length > MAX_PAYLOAD_LENGTH) {
+    LOG_ERROR("MQTT message on %s too long: %u bytes", topic, length);
+    return false;
+  }
+  InboundUpdate* slot = acquireSlot();
+  if (slot == nullptr) {
+    return false;
+  }
+
+  slot->kind = InboundUpdate::Kind::MQTT_MESSAGE;
+  slot->text.clear();
+  slot->text.append(topic);
+  slot->length = static_cast<uint16_t>(length);
+  memcpy(slot->payload.data(), payload, length);
+  inbound.publish();
+  Scheduler::getInstance().notify();
+  return true;
+}
+
+auto NetworkTask::postRootLabel(const char* label) -> bool {
+  InboundUpdate* slot = acquireSlot();
+  if (slot == nullptr) {
+    return false;
+  }
+
+  slot->kind = InboundUpdate::Kind::ROOT_LABEL;
+  slot->text.clear();
+  slot->text.append(label);
+  slot->length = 0;
+  inbound.publish();
+  Scheduler::getInstance().notify();
+  return true;
+}
+
+auto NetworkTask::hasInbound() const -> bool {
+  return !inbound.empty();
+}
+
+// Handled in place, so the slot is only freed once its payload is consumed
+auto NetworkTask::dispatchInbound() -> void {
+  while (InboundUpdate* update = inbound.front()) {
+    if (update->kind == InboundUpdate::Kind::MQTT_MESSAGE) {
+      MQTTManager::onMqttMessage(update->text.data(), update->payload.data(), update->length);
+    } else {
+      AppState::getInstance().setRootLabel(update->text.c_str());
+    }
+    inbound.release();
+  }
+}
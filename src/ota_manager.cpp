@@ -1,10 +1,37 @@
 #include "ota_manager.h"
-#include "display.h"
+#include "breadcrumbs.h"
+#include "change_bus.h"
+#include "mqtt_manager.h"
+#include "scheduler.h"
 #include "config.h"
+#include "gzip_stream.h"
+#include "wifi_connection.h"
+#include <ArduinoJson.h>
+#include <HTTPClient.h>
+#include <Preferences.h>
+#include <Update.h>
 #include <WiFi.h>
+#include <logging.h>
 #include <ota-github-defaults.h>
 #include <OTA-Hub.hpp>
 
+const unsigned long OTAManager::RESULT_DISPLAY_TIME = 2000;
+const unsigned long OTAManager::RESTART_DELAY = 2000;
+const uint32_t OTAManager::TASK_STACK_SIZE = 8192;
+const unsigned long OTAManager::READ_TIMEOUT = 10000;
+const UBaseType_t OTA_TASK_PRIORITY = 1;
+const BaseType_t OTA_TASK_CORE = 0; // Away from the loop task on core 1
+const int PERCENT = 100;
+const float BYTES_PER_KILOBYTE = 1024.0F;
+const float MILLIS_PER_SECOND = 1000.0F;
+const uint64_t MICROS_PER_MILLI = 1000;
+const unsigned long OTAManager::FIRST_CHECK_DELAY = 60000;
+const unsigned long OTAManager::CHECK_INTERVAL = 6UL * 60 * 60 * 1000;
+const unsigned long OTAManager::CHECK_JITTER = 30UL * 60 * 1000;
+const unsigned long OTAManager::CHECK_RETRY_INTERVAL = 5UL * 60 * 1000;
+const char* const LATEST_RELEASE_URL = "https://api.github.com/repos/" OTAGH_OWNER_NAME "/" OTAGH_REPO_NAME "/releases/latest";
+const char* const RELEASE_CACHE_NAMESPACE = "ota";
+
 auto OTAManager::getInstance() -> OTAManager& {
   static OTAManager instance;
   return instance;
@@ -13,43 +40,507 @@ auto OTAManager::getInstance() -> OTAManager& {
 auto OTAManager::init() -> void
 {
   wifi_client.setInsecure(); // Disable certificate verification
+  check_client.setInsecure();
   OTA::init(wifi_client);
+
+  // The cached release shows the indicator before the first check runs
+  loadReleaseCache();
+  updateAvailable = !isRunningLatest();
+
+  // Spread the first check so a room full of panels doesn't hit GitHub at once
+  nextCheckAt = millis() + FIRST_CHECK_DELAY + esp_random() % FIRST_CHECK_DELAY;
 }
 
-auto OTAManager::checkForUpdate() -> void
+auto OTAManager::startUpdate() -> void
 {
-  if (WiFi.status() != WL_CONNECTED) {
-    Serial.println("WiFi not connected. Cannot check for updates.");
-    Display::getInstance().setLoadingMessage("WiFi not connected");
-    delay(2000);
+  if (isBusy()) {
     return;
   }
 
-  Display::getInstance().setLoadingMessage("Checking for", "updates...");
-  delay(1000);
+  if (!WiFiConnection::getInstance().isLinkUp()) {
+    LOG_ERROR("WiFi not connected. Cannot check for updates.");
+    setState(State::FAILED);
+    return;
+  }
 
+  cancelRequested.store(false);
+  bytesDone.store(0);
+  bytesTotal.store(0);
+  downloadStartedAt.store(0);
+  downloadFinishedAt.store(0);
+  compressed = false;
+  imageBytes = 0;
+  inflateMicros = 0;
+  lastPercent = -1;
+  setState(State::CHECKING);
+
+  // Two TLS sessions don't fit in the heap together, so the download waits
+  // for a background release check to finish. startCheck() tests the state
+  // after claiming checkRunning, so one of the two always sees the other.
+  if (checkRunning.load()) {
+    LOG_INFO("Update waits for the release check to finish");
+    updateDeferred.store(true);
+    Scheduler::getNetworkInstance().notify();
+    return;
+  }
+  launchUpdateTask();
+}
+
+auto OTAManager::launchUpdateTask() -> void {
+  Breadcrumbs::getInstance().record(Breadcrumb::OTA_STARTED);
+  if (xTaskCreatePinnedToCore(runTask, "ota", TASK_STACK_SIZE, nullptr, OTA_TASK_PRIORITY, nullptr, OTA_TASK_CORE) != pdPASS) {
+    LOG_ERROR("Failed to start OTA task");
+    setState(State::FAILED);
+  }
+}
+
+auto OTAManager::cancel() -> void {
+  if (isBusy()) {
+    LOG_INFO("Cancelling update...");
+    cancelRequested.store(true);
+  }
+}
+
+auto OTAManager::runTask(void* /*parameter*/) -> void {
+  getInstance().performUpdate();
+  vTaskDelete(nullptr);
+}
+
+auto OTAManager::performUpdate() -> void {
   OTA::UpdateObject details = OTA::isUpdateAvailable();
   details.print();
-  if (OTA::NO_UPDATE != details.condition)
-  {
-      if (OTA::performUpdate(&details, true, false) != OTA::SUCCESS)
-      {
-          Serial.println("Update failed. Continuing...");
-          Display::getInstance().setLoadingMessage("Update failed");
-          delay(2000);
+
+  if (cancelRequested.load()) {
+    setState(State::CANCELLED);
+    return;
+  }
+  if (OTA::NO_UPDATE == details.condition) {
+    LOG_INFO("No new update available. Continuing...");
+    setState(State::UP_TO_DATE);
+    return;
+  }
+
+  downloadStartedAt.store(millis());
+  setState(State::DOWNLOADING);
+  DownloadResult result = downloadCompressed(details.tag_name);
+  if (result == DownloadResult::UNAVAILABLE && !cancelRequested.load()) {
+    LOG_INFO("No compressed image in this release, downloading firmware.bin");
+    result = OTA::performUpdate(&details, true, false, onProgress) == OTA::SUCCESS ? DownloadResult::SUCCEEDED : DownloadResult::FAILED;
+    imageBytes = bytesDone.load();
+  }
+  downloadFinishedAt.store(millis());
+
+  if (cancelRequested.load()) {
+    setState(State::CANCELLED);
+  } else if (result != DownloadResult::SUCCEEDED) {
+    setState(State::FAILED);
+  } else {
+    setState(State::SUCCEEDED);
+
+    // Leave the result on screen and give MQTT a chance to report it
+    vTaskDelay(pdMS_TO_TICKS(RESTART_DELAY));
+    ESP.restart();
+  }
+}
+
+auto OTAManager::compressedImageUrl(const String& tagName) -> String {
+#ifdef OTA_STAND_IN_URL
+  (void)tagName;
+  return String(OTA_STAND_IN_URL) + "/firmware.bin.gz";
+#else
+  return "https://github.com/" OTAGH_OWNER_NAME "/" OTAGH_REPO_NAME "/releases/download/" + tagName + "/firmware.bin.gz";
+#endif
+}
+
+// Streams the gzip image through the inflater into the OTA partition, so
+// only one network chunk and the 32 KB deflate window are held in RAM
+auto OTAManager::downloadCompressed(const String& tagName) -> DownloadResult {
+#ifdef OTA_STAND_IN_URL
+  WiFiClient& client = stand_in_client;
+#else
+  WiFiClient& client = wifi_client;
+#endif
+
+  String const url = compressedImageUrl(tagName);
+  HTTPClient http;
+  http.setFollowRedirects(HTTPC_FORCE_FOLLOW_REDIRECTS); // GitHub redirects to its asset storage
+  http.setUserAgent("desk-control-panel");
+  http.setTimeout(READ_TIMEOUT);
+  if (!http.begin(client, url)) {
+    return DownloadResult::UNAVAILABLE;
+  }
+
+  int const code = http.GET();
+  if (code != HTTP_CODE_OK) {
+    LOG_DEBUG("Compressed image not available (HTTP %d): %s", code, url.c_str());
+    http.end();
+    return DownloadResult::UNAVAILABLE;
+  }
+
+  // The inflated size is only known at the end, from the gzip trailer
+  int const total = http.getSize(); // -1 for a chunked response
+  if (!Update.begin(UPDATE_SIZE_UNKNOWN)) {
+    LOG_ERROR("Not enough space for the update");
+    http.end();
+    return DownloadResult::FAILED;
+  }
+
+  compressed = true;
+  GzipStream gzip;
+  gzip.begin(writeImage);
+
+  WiFiClient* stream = http.getStreamPtr();
+  std::array<uint8_t, CHUNK_SIZE> chunk{};
+  size_t done = 0;
+  unsigned long lastData = millis();
+  bool succeeded = true;
+  while (succeeded && (total < 0 || done < static_cast<size_t>(total))) {
+    if (cancelRequested.load()) {
+      succeeded = false;
+      break;
+    }
+
+    size_t const available = stream->available();
+    if (available == 0) {
+      if (!http.connected() || millis() - lastData >= READ_TIMEOUT) {
+        break; // A chunked response ends when the server closes
+      }
+      vTaskDelay(1);
+      continue;
+    }
+
+    size_t const read = stream->readBytes(chunk.data(), min(available, chunk.size()));
+    lastData = millis();
+    succeeded = gzip.write(chunk.data(), read);
+    done += read;
+    onProgress(done, total < 0 ? 0 : total);
+  }
+
+  succeeded = succeeded && gzip.finish();
+  imageBytes = gzip.getOutputSize();
+  inflateMicros = gzip.getInflateMicros();
+  gzip.end();
+  http.end();
+
+  if (!succeeded) {
+    LOG_ERROR("Compressed update failed after %u bytes", done);
+    Update.abort();
+    return DownloadResult::FAILED;
+  }
+  return Update.end(true) ? DownloadResult::SUCCEEDED : DownloadResult::FAILED;
+}
+
+// The flash cache is off during each write, but buttons and the dial stay
+// live so the update can be cancelled. Their interrupt handlers must stay in
+// IRAM (see Scheduler::signalFromIsr and RotaryEncoderManager).
+auto OTAManager::writeImage(const uint8_t* data, size_t length) -> bool {
+  // NOLINTNEXTLINE(cppcoreguidelines-pro-type-const-cast) - Update::write is not const-correct
+  return Update.write(const_cast<uint8_t*>(data), length) == length;
+}
+
+auto OTAManager::onProgress(size_t done, size_t total) -> void {
+  // Runs on the OTA task between chunks
+  OTAManager& ota = getInstance();
+  if (ota.cancelRequested.load()) {
+    Update.abort(); // Every further write fails and the download unwinds
+    return;
+  }
+
+  ota.bytesDone.store(done);
+  ota.bytesTotal.store(total);
+
+  // Only wake the display when the bar visibly moves
+  int const percent = total == 0 ? 0 : static_cast<int>(done * PERCENT / total);
+  if (percent != ota.lastPercent) {
+    ota.lastPercent = percent;
+    ChangeBus::getInstance().publish(Change::OTA_PROGRESS);
+  }
+}
+
+auto OTAManager::runCheckTask(void* /*parameter*/) -> void {
+  OTAManager& ota = getInstance();
+  ota.checkResult = ota.checkLatestRelease();
+  ota.checkFinished.store(true);
+  ota.checkRunning.store(false);
+  Scheduler::getNetworkInstance().notify();
+  vTaskDelete(nullptr);
+}
+
+// Conditional request for the latest release. GitHub answers 304 without a
+// body while the ETag still matches, and those don't count against the
+// unauthenticated rate limit.
+auto OTAManager::checkLatestRelease() -> CheckResult {
+  HTTPClient http;
+  http.setUserAgent("desk-control-panel");
+  http.setTimeout(READ_TIMEOUT);
+  if (!http.begin(check_client, LATEST_RELEASE_URL)) {
+    return CheckResult::FAILED;
+  }
+  http.addHeader("Accept", "application/vnd.github+json");
+  if (etag[0] != '\0') {
+    http.addHeader("If-None-Match", etag.data());
+  }
+  std::array<const char*, 1> headers = {"ETag"};
+  http.collectHeaders(headers.data(), headers.size());
+
+  int const code = http.GET();
+  if (code == HTTP_CODE_NOT_MODIFIED) {
+    http.end();
+    return CheckResult::NOT_MODIFIED;
+  }
+  if (code != HTTP_CODE_OK) {
+    LOG_WARNING("Release check failed (HTTP %d)", code);
+    http.end();
+    return CheckResult::FAILED;
+  }
+
+  // The release JSON lists every asset; only keep the two fields we need
+  JsonDocument filter;
+  filter["tag_name"] = true;
+  filter["name"] = true;
+  JsonDocument doc;
+  DeserializationError const error = deserializeJson(doc, http.getStream(), DeserializationOption::Filter(filter));
+  String const newEtag = http.header("ETag");
+  http.end();
+  if (error) {
+    LOG_WARNING("Release check returned invalid JSON: %s", error.c_str());
+    return CheckResult::FAILED;
+  }
+
+  strlcpy(latestTag.data(), doc["tag_name"] | "", latestTag.size());
+  strlcpy(latestName.data(), doc["name"] | "", latestName.size());
+  strlcpy(etag.data(), newEtag.c_str(), etag.size());
+  saveReleaseCache();
+  return CheckResult::CHANGED;
+}
+
+auto OTAManager::loadReleaseCache() -> void {
+  Preferences preferences;
+  preferences.begin(RELEASE_CACHE_NAMESPACE, true);
+  strlcpy(etag.data(), preferences.getString("etag", "").c_str(), etag.size());
+  strlcpy(latestTag.data(), preferences.getString("tag", "").c_str(), latestTag.size());
+  strlcpy(latestName.data(), preferences.getString("name", "").c_str(), latestName.size());
+  preferences.end();
+}
+
+auto OTAManager::saveReleaseCache() const -> void {
+  Preferences preferences;
+  preferences.begin(RELEASE_CACHE_NAMESPACE, false);
+  preferences.putString("etag", etag.data());
+  preferences.putString("tag", latestTag.data());
+  preferences.putString("name", latestName.data());
+  preferences.end();
+}
+
+auto OTAManager::isRunningLatest() const -> bool {
+  if (latestTag[0] == '\0') {
+    return true; // Nothing known yet
+  }
+#ifdef OTA_BUILT_ON_GITHUB
+  // Release builds are stamped with the release name
+  return strcmp(latestName.data(), OTA_VERSION) == 0;
+#else
+  const char* tag = latestTag.data();
+  if (*tag == 'v' || *tag == 'V') {
+    tag++;
+  }
+  return strcmp(tag, VERSION) == 0;
+#endif
+}
+
+auto OTAManager::withJitter(unsigned long interval) -> unsigned long {
+  return interval - CHECK_JITTER + esp_random() % (2 * CHECK_JITTER);
+}
+
+auto OTAManager::startCheck(unsigned long now) -> void {
+  if (!WiFiConnection::getInstance().isLinkUp()) {
+    nextCheckAt = now + CHECK_RETRY_INTERVAL;
+    return;
+  }
+
+  // Claimed before testing the state, see startUpdate()
+  checkRunning.store(true);
+  if (isBusy()) {
+    checkRunning.store(false);
+    nextCheckAt = now + CHECK_RETRY_INTERVAL;
+    return;
+  }
+
+  if (xTaskCreatePinnedToCore(runCheckTask, "ota-check", TASK_STACK_SIZE, nullptr, OTA_TASK_PRIORITY, nullptr, OTA_TASK_CORE) != pdPASS) {
+    LOG_ERROR("Failed to start release check task");
+    checkRunning.store(false);
+    nextCheckAt = now + CHECK_RETRY_INTERVAL;
+  }
+}
+
+auto OTAManager::updateCheck(unsigned long now) -> unsigned long {
+  if (checkRunning.load()) {
+    return Scheduler::NO_DEADLINE; // The task notifies when it is done
+  }
+
+  if (checkFinished.exchange(false)) {
+    if (checkResult == CheckResult::FAILED) {
+      nextCheckAt = now + CHECK_RETRY_INTERVAL;
+    } else {
+      nextCheckAt = now + withJitter(CHECK_INTERVAL);
+      if (checkResult == CheckResult::CHANGED) {
+        LOG_INFO("Latest release: %s (%s)", latestTag.data(), latestName.data());
       }
-      else
-      {
-          Serial.println("Update successful. Restarting...");
-          Display::getInstance().setLoadingMessage("Update successful", "Restarting...");
-          delay(2000);
-          ESP.restart();
+
+      bool const available = !isRunningLatest();
+      if (available != updateAvailable) {
+        updateAvailable = available;
+        ChangeBus::getInstance().publish(Change::OTA_PROGRESS);
       }
+    }
+  }
+
+  if (static_cast<long>(now - nextCheckAt) >= 0) {
+    startCheck(now);
+    return checkRunning.load() ? Scheduler::NO_DEADLINE : nextCheckAt;
+  }
+  return nextCheckAt;
+}
+
+auto OTAManager::setState(State next) -> void {
+  state.store(next);
+  eventPending.store(true);
+  ChangeBus::getInstance().publish(Change::OTA_PROGRESS);
+  Scheduler::getNetworkInstance().notify();
+}
+
+auto OTAManager::update(unsigned long now) -> unsigned long {
+  eventPending.store(false);
+
+  if (!checkRunning.load() && updateDeferred.exchange(false)) {
+    if (cancelRequested.load()) {
+      setState(State::CANCELLED);
+    } else {
+      launchUpdateTask();
+    }
+  }
+
+  unsigned long const checkDeadline = updateCheck(now);
+  unsigned long const resultDeadline = updateResult(now);
+  if (checkDeadline == Scheduler::NO_DEADLINE) {
+    return resultDeadline;
   }
-  else
-  {
-      Serial.println("No new update available. Continuing...");
-      Display::getInstance().setLoadingMessage("Up to Date");
-      delay(2000);
+  if (resultDeadline == Scheduler::NO_DEADLINE) {
+    return checkDeadline;
   }
-}
\ No newline at end of file
+  return static_cast<long>(checkDeadline - resultDeadline) < 0 ? checkDeadline : resultDeadline;
+}
+
+auto OTAManager::updateResult(unsigned long now) -> unsigned long {
+  State const current = state.load();
+  if (current == State::IDLE || isBusy()) {
+    reportedState = current;
+    return Scheduler::NO_DEADLINE;
+  }
+
+  if (current != reportedState) {
+    reportedState = current;
+    resultClearAt = now + RESULT_DISPLAY_TIME;
+
+    // A success restarts from the OTA task shortly, so this is the last trace of it
+    Breadcrumbs::getInstance().record(Breadcrumb::OTA_FINISHED, static_cast<uint8_t>(current));
+    OtaReport const report = getReport();
+    LOG_INFO("Update %s: %u bytes (%s, %u inflated) in %lu ms (%.1f KB/s, %lu ms inflating)",
+      report.result, report.bytes, report.compressed ? "gzip" : "raw", report.imageBytes,
+      report.durationMs, report.kilobytesPerSecond, report.inflateMs);
+    MQTTManager::getInstance().publishOtaReport(report);
+
+    // The manual check is authoritative over a stale cached release
+    if (current == State::UP_TO_DATE && updateAvailable) {
+      updateAvailable = false;
+      ChangeBus::getInstance().publish(Change::OTA_PROGRESS);
+    }
+  }
+
+  // A successful update restarts from the OTA task
+  if (current != State::SUCCEEDED && static_cast<long>(now - resultClearAt) >= 0) {
+    state.store(State::IDLE);
+    reportedState = State::IDLE;
+    ChangeBus::getInstance().publish(Change::OTA_PROGRESS);
+    return Scheduler::NO_DEADLINE;
+  }
+  return resultClearAt;
+}
+
+auto OTAManager::hasPendingEvent() const -> bool {
+  return eventPending.load() || checkFinished.load();
+}
+
+auto OTAManager::getState() const -> State {
+  return state.load();
+}
+
+auto OTAManager::isBusy() const -> bool {
+  State const current = state.load();
+  return current == State::CHECKING || current == State::DOWNLOADING;
+}
+
+auto OTAManager::getStatusText() const -> const char* {
+  switch (state.load()) {
+    case State::CHECKING:
+      return "Checking for updates";
+    case State::DOWNLOADING:
+      return "Updating";
+    case State::UP_TO_DATE:
+      return "Up to Date";
+    case State::FAILED:
+      return "Update failed";
+    case State::CANCELLED:
+      return "Update cancelled";
+    case State::SUCCEEDED:
+      return "Restarting...";
+    default:
+      return nullptr;
+  }
+}
+
+auto OTAManager::getProgress(size_t& done, size_t& total) const -> void {
+  done = bytesDone.load();
+  total = bytesTotal.load();
+}
+
+auto OTAManager::getKilobytesPerSecond() const -> float {
+  unsigned long const end = state.load() == State::DOWNLOADING ? millis() : downloadFinishedAt.load();
+  unsigned long const elapsed = end - downloadStartedAt.load();
+  if (elapsed == 0) {
+    return 0.0F;
+  }
+  return static_cast<float>(bytesDone.load()) / BYTES_PER_KILOBYTE * MILLIS_PER_SECOND / static_cast<float>(elapsed);
+}
+
+auto OTAManager::isUpdateAvailable() const -> bool {
+  return updateAvailable;
+}
+
+auto OTAManager::getReport() const -> OtaReport {
+  const char* result = "failed";
+  switch (state.load()) {
+    case State::UP_TO_DATE:
+      result = "up_to_date";
+      break;
+    case State::CANCELLED:
+      result = "cancelled";
+      break;
+    case State::SUCCEEDED:
+      result = "succeeded";
+      break;
+    default:
+      break;
+  }
+
+  bool const downloaded = downloadStartedAt.load() != 0 && bytesDone.load() > 0;
+  return {
+    result,
+    compressed,
+    bytesDone.load(),
+    imageBytes,
+    downloaded ? downloadFinishedAt.load() - downloadStartedAt.load() : 0,
+    static_cast<unsigned long>(inflateMicros / MICROS_PER_MILLI),
+    downloaded ? getKilobytesPerSecond() : 0.0F
+  };
+}
@@ -0,0 +1,84 @@
+#include "profiler.h"
+
+#ifdef PROFILING
+
+#include <logging.h>
+
+auto Profiler::getInstance() -> Profiler& {
+  static Profiler instance;
+  return instance;
+}
+
+Profiler::Profiler() : cyclesPerMicro(max(ESP.getCpuFreqMHz(), static_cast<uint32_t>(1))) {}
+
+auto Profiler::addZone(const char* name) -> uint8_t {
+  uint8_t const count = min(zoneCount.load(), MAX_ZONES);
+  for (uint8_t zone = 0; zone < count; zone++) {
+    if (zones[zone].name != nullptr && strcmp(zones[zone].name, name) == 0) {
+      return zone;
+    }
+  }
+
+  uint8_t const zone = zoneCount.fetch_add(1);
+  if (zone >= MAX_ZONES) {
+    zoneCount.store(MAX_ZONES);
+    LOG_ERROR("Profiler full, cannot add zone: %s", name);
+    return NO_ZONE;
+  }
+  zones[zone].name = name;
+  return zone;
+}
+
+auto Profiler::record(uint8_t zone, uint32_t cycles) -> void {
+  if (zone >= MAX_ZONES) {
+    return;
+  }
+
+  ProfileZone& entry = zones[zone];
+  entry.minCycles = entry.count == 0 ? cycles : min(entry.minCycles, cycles);
+  entry.maxCycles = max(entry.maxCycles, cycles);
+  entry.totalCycles += cycles;
+  entry.count++;
+
+  uint32_t const micros = cycles / cyclesPerMicro;
+  size_t const bucket = micros == 0 ? 0 : 32 - __builtin_clz(micros);
+  entry.histogram[min(bucket, ProfileZone::BUCKETS - 1)]++;
+}
+
+auto Profiler::reset() -> void {
+  for (ProfileZone& zone : zones) {
+    zone = {zone.name, 0, 0, 0, 0, {}};
+  }
+}
+
+auto Profiler::getZoneCount() const -> uint8_t {
+  return min(zoneCount.load(), MAX_ZONES);
+}
+
+auto Profiler::getZone(uint8_t zone) const -> const ProfileZone& {
+  return zones[zone];
+}
+
+auto Profiler::toMicros(uint64_t cycles) const -> uint32_t {
+  return static_cast<uint32_t>(cycles / cyclesPerMicro);
+}
+
+auto Profiler::dump(Print& output) const -> void {
+  output.printf("# profile: %u zones, times in us, histogram buckets <1 <2 <4 ... >=%u\n", getZoneCount(),
+                1U << (ProfileZone::BUCKETS - 2));
+  for (uint8_t zone = 0; zone < getZoneCount(); zone++) {
+    const ProfileZone& entry = zones[zone];
+    if (entry.name == nullptr) {
+      continue;
+    }
+    uint32_t const average = entry.count == 0 ? 0 : toMicros(entry.totalCycles / entry.count);
+    output.printf("%-16s n=%u min=%u avg=%u max=%u |", entry.name, entry.count, toMicros(entry.minCycles), average,
+                  toMicros(entry.maxCycles));
+    for (uint32_t const count : entry.histogram) {
+      output.printf(" %u", count);
+    }
+    output.println();
+  }
+}
+
+#endif // PROFILING
@@ -1,6 +1,6 @@
 #include "rotary_encoder.h"
 #include <Arduino.h>
-#include <Elog.h>
+#include <hal/gpio_ll.h>
 #include <logging.h>
 
 // Pin definitions
@@ -10,70 +10,122 @@ ROTARY_DT_PIN = 33,
 ROTARY_CLK_PIN = 32
 };
 
+const unsigned long MICROS_PER_SECOND = 1000000;
+
+// Quarter steps per transition, indexed by (previous pin pair << 2) | pin
+// pair, with DT as bit 0 and CLK as bit 1. No change or a skipped state
+// counts 0. A plain array in DRAM so the interrupt can read it with the
+// flash cache disabled.
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-c-arrays,hicpp-avoid-c-arrays,modernize-avoid-c-arrays)
+DRAM_ATTR const int8_t QUADRATURE_STEPS[16] = {0, -1, 1, 0, 1, 0, 0, -1, -1, 0, 0, 1, 0, 1, -1, 0};
+const int QUARTER_STEPS_PER_DETENT_SHIFT = 2;
+// The dial rests with both pins low between detents
+const uint8_t DETENT_STATE = 0;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+RotaryEncoderManager* RotaryEncoderManager::isrInstance = nullptr;
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+InputCallback RotaryEncoderManager::inputCallback = nullptr;
+
 auto RotaryEncoderManager::getInstance() -> RotaryEncoderManager& {
   static RotaryEncoderManager instance;
   return instance;
 }
 
-auto RotaryEncoderManager::init() -> void {
+auto RotaryEncoderManager::init(InputCallback onInput) -> void {
+  inputCallback = onInput;
+
   // Initialize button pin
   pinMode(ROTARY_BUTTON_PIN, INPUT_PULLUP);
   
   // Initialize rotary encoder
-  encoder = std::unique_ptr<RotaryEncoder>(new RotaryEncoder(ROTARY_DT_PIN, ROTARY_CLK_PIN, RotaryEncoder::LatchMode::FOUR0));
+  pinMode(ROTARY_DT_PIN, INPUT_PULLUP);
+  pinMode(ROTARY_CLK_PIN, INPUT_PULLUP);
+  quadratureState = readQuadrature();
+  quarterSteps = 0;
+  detentPosition = 0;
+  pendingSteps.store(0);
+  isrInstance = this;
   
   // Set up interrupts for encoder pins
   attachInterrupt(digitalPinToInterrupt(ROTARY_DT_PIN), checkPositionStatic, CHANGE);
   attachInterrupt(digitalPinToInterrupt(ROTARY_CLK_PIN), checkPositionStatic, CHANGE);
-  
-  // Initialize button state
-  currentButtonState = digitalRead(ROTARY_BUTTON_PIN) == LOW;
-  lastButtonState = currentButtonState;
 
-  Logger.debug(MAIN_LOG, "Rotary encoder setup complete.");
+  // The button only needs to wake the loop, it is read there
+  if (inputCallback != nullptr) {
+    attachInterrupt(digitalPinToInterrupt(ROTARY_BUTTON_PIN), inputCallback, CHANGE);
+  }
+
+  LOG_DEBUG("Rotary encoder setup complete.");
 }
 
-auto RotaryEncoderManager::getRotationDirection() -> RotaryDirection {
-  if (encoder == nullptr) { return RotaryDirection::NONE; }
+auto RotaryEncoderManager::isButtonDown() const -> bool {
+  return digitalRead(ROTARY_BUTTON_PIN) == LOW;
+}
 
-  // NOLINTNEXTLINE(cppcoreguidelines-init-variables) - variable is initialized by method call
-  RotaryEncoder::Direction const direction = encoder->getDirection();
-  
-  switch (direction) {
-    case RotaryEncoder::Direction::CLOCKWISE:
-      return RotaryDirection::CLOCKWISE;
-    case RotaryEncoder::Direction::COUNTERCLOCKWISE:
-      return RotaryDirection::COUNTERCLOCKWISE;
-    default:
-      return RotaryDirection::NONE;
-  }
+auto RotaryEncoderManager::takeSteps() -> int {
+  int const rawSteps = pendingSteps.exchange(0);
+  if (rawSteps == 0) { return 0; }
+
+  return accelerate(rawSteps);
 }
 
-auto RotaryEncoderManager::isButtonPressed() -> bool {
-  // Read current button state
-  currentButtonState = digitalRead(ROTARY_BUTTON_PIN) == LOW;
-  
-  // Check if button was just pressed (transition from not pressed to pressed)
-  bool const wasPressed = !lastButtonState && currentButtonState;
-  
-  // Update last button state
-  lastButtonState = currentButtonState;
-  
-  return wasPressed;
+auto RotaryEncoderManager::setAcceleration(const RotaryAcceleration& acceleration) -> void {
+  this->acceleration = acceleration;
 }
 
-auto RotaryEncoderManager::tick() -> void {
-  if (encoder != nullptr) {
-    encoder->tick();
+auto RotaryEncoderManager::accelerate(int rawSteps) -> int {
+  unsigned long const now = micros();
+  unsigned long const elapsed = now - lastStepMicros;
+  lastStepMicros = now;
+
+  if (acceleration.maxMultiplier <= 1 || elapsed == 0) {
+    return rawSteps;
+  }
+
+  unsigned long const magnitude = rawSteps < 0 ? -rawSteps : rawSteps;
+  unsigned long const stepsPerSecond = magnitude * MICROS_PER_SECOND / elapsed;
+  if (stepsPerSecond <= acceleration.thresholdStepsPerSecond) {
+    return rawSteps;
+  }
+
+  unsigned long multiplier = acceleration.maxMultiplier;
+  if (stepsPerSecond < acceleration.saturationStepsPerSecond) {
+    unsigned long const span = acceleration.saturationStepsPerSecond - acceleration.thresholdStepsPerSecond;
+    multiplier = 1 + (acceleration.maxMultiplier - 1) * (stepsPerSecond - acceleration.thresholdStepsPerSecond) / span;
   }
+
+  return rawSteps * static_cast<int>(multiplier);
+}
+
+// Reads the registers directly, digitalRead() is in flash
+auto IRAM_ATTR RotaryEncoderManager::readQuadrature() -> uint8_t {
+  int const dt = gpio_ll_get_level(&GPIO, static_cast<gpio_num_t>(ROTARY_DT_PIN));
+  int const clk = gpio_ll_get_level(&GPIO, static_cast<gpio_num_t>(ROTARY_CLK_PIN));
+  return static_cast<uint8_t>(dt | (clk << 1));
 }
 
-auto RotaryEncoderManager::checkPosition() -> void {
-  if (encoder != nullptr) {
-    encoder->tick();
+auto IRAM_ATTR RotaryEncoderManager::checkPosition() -> void {
+  uint8_t const state = readQuadrature();
+  quarterSteps += QUADRATURE_STEPS[(quadratureState << 2) | state];
+  quadratureState = state;
+
+  // Steps are counted only once the dial settles in a detent
+  if (state != DETENT_STATE) {
+    return;
+  }
+  int32_t const position = quarterSteps >> QUARTER_STEPS_PER_DETENT_SHIFT;
+  if (position != detentPosition) {
+    pendingSteps.fetch_add(position - detentPosition);
+    detentPosition = position;
+    if (inputCallback != nullptr) {
+      inputCallback();
+    }
   }
 }
 
-auto RotaryEncoderManager::checkPositionStatic() -> void {
-  getInstance().checkPosition();
+auto IRAM_ATTR RotaryEncoderManager::checkPositionStatic() -> void {
+  if (isrInstance != nullptr) {
+    isrInstance->checkPosition();
+  }
 }
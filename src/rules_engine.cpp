@@ -0,0 +1,371 @@
+#include "rules_engine.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <logging.h>
+#include <vector>
+
+const char* const RULES_NAMESPACE = "rules";
+const char* const RULES_KEY = "json";
+// Definitions arrive through the MQTT client buffer, so none is longer
+const size_t MAX_DEFINITION_BYTES = 2048;
+const uint32_t FNV_OFFSET_BASIS = 2166136261U;
+const uint32_t FNV_PRIME = 16777619U;
+
+const char EVENT_PLACEHOLDER[] = "{event}";
+const char TIMESTAMP_PLACEHOLDER[] = "{timestamp}";
+
+// Single pass parser for the rules schema. Strings are unescaped into the
+// table's string region and each rule's targets are laid out contiguously,
+// so a match is a slice of the target array.
+class RulesEngine::Parser {
+public:
+  Parser(const char* json, size_t length, Table& table)
+    : cursor(json), end(json + length), table(table) {}
+
+  auto parse() -> bool {
+    if (!check(consume('{'), "expected object")) {
+      return false;
+    }
+    if (!consume('}')) {
+      do {
+        if (!parseRule()) {
+          return false;
+        }
+      } while (consume(','));
+      if (!check(consume('}'), "expected '}'")) {
+        return false;
+      }
+    }
+    skipWhitespace();
+    return check(cursor == end, "trailing data");
+  }
+
+  auto getError() const -> const char* { return error; }
+
+private:
+  const char* cursor;
+  const char* end;
+  Table& table;
+  const char* error = nullptr;
+
+  // Records the first failure; returns the condition so calls can chain
+  auto check(bool condition, const char* message) -> bool {
+    if (!condition && error == nullptr) {
+      error = message;
+    }
+    return condition;
+  }
+
+  auto skipWhitespace() -> void {
+    while (cursor < end && (*cursor == ' ' || *cursor == '\n' || *cursor == '\r' || *cursor == '\t')) {
+      cursor++;
+    }
+  }
+
+  auto consume(char expected) -> bool {
+    skipWhitespace();
+    if (cursor < end && *cursor == expected) {
+      cursor++;
+      return true;
+    }
+    return false;
+  }
+
+  auto consumeWord(const char* word) -> bool {
+    skipWhitespace();
+    size_t const length = strlen(word);
+    if (static_cast<size_t>(end - cursor) >= length && strncmp(cursor, word, length) == 0) {
+      cursor += length;
+      return true;
+    }
+    return false;
+  }
+
+  auto appendChar(char next) -> bool {
+    if (!check(table.stringBytes < table.strings.size(), "rules too large")) {
+      return false;
+    }
+    table.strings[table.stringBytes++] = next;
+    return true;
+  }
+
+  auto parseString(const char*& out) -> bool {
+    if (!check(consume('"'), "expected string")) {
+      return false;
+    }
+
+    const char* const start = &table.strings[table.stringBytes];
+    while (cursor < end && *cursor != '"') {
+      char next = *cursor++;
+      if (next == '\\') {
+        if (!check(cursor < end, "unterminated escape")) {
+          return false;
+        }
+        next = *cursor++;
+        if (next == 'n') {
+          next = '\n';
+        } else if (next == 't') {
+          next = '\t';
+        } else if (next == 'r') {
+          next = '\r';
+        } else if (!check(next == '"' || next == '\\' || next == '/', "unsupported escape")) {
+          return false;
+        }
+      }
+      if (!appendChar(next)) {
+        return false;
+      }
+    }
+    if (!check(cursor < end, "unterminated string") || !appendChar('\0')) {
+      return false;
+    }
+    cursor++;
+    out = start;
+    return true;
+  }
+
+  // Keys are compared in place and never copied into the table
+  auto parseKey(const char*& key, size_t& length) -> bool {
+    if (!check(consume('"'), "expected key")) {
+      return false;
+    }
+    key = cursor;
+    while (cursor < end && *cursor != '"') {
+      cursor++;
+    }
+    length = cursor - key;
+    if (!check(cursor < end, "unterminated key")) {
+      return false;
+    }
+    cursor++;
+    return check(consume(':'), "expected ':'");
+  }
+
+  auto parseBool(bool& out) -> bool {
+    if (consumeWord("true")) {
+      out = true;
+      return true;
+    }
+    if (consumeWord("false")) {
+      out = false;
+      return true;
+    }
+    return check(false, "expected true or false");
+  }
+
+  auto parseTarget() -> bool {
+    if (!check(consume('{'), "expected target object")) {
+      return false;
+    }
+
+    Target target{nullptr, "", false};
+    if (!consume('}')) {
+      do {
+        const char* key = nullptr;
+        size_t keyLength = 0;
+        if (!parseKey(key, keyLength)) {
+          return false;
+        }
+
+        bool parsed = false;
+        if (keyLength == 5 && strncmp(key, "topic", keyLength) == 0) {
+          parsed = parseString(target.topic);
+        } else if (keyLength == 7 && strncmp(key, "payload", keyLength) == 0) {
+          parsed = parseString(target.payload);
+        } else if (keyLength == 6 && strncmp(key, "retain", keyLength) == 0) {
+          parsed = parseBool(target.retained);
+        } else {
+          parsed = check(false, "unknown target key");
+        }
+        if (!parsed) {
+          return false;
+        }
+      } while (consume(','));
+      if (!check(consume('}'), "expected '}'")) {
+        return false;
+      }
+    }
+
+    if (!check(target.topic != nullptr && target.topic[0] != '\0', "target without topic") ||
+        !check(strlen(target.payload) <= MAX_PAYLOAD_LENGTH, "payload too long") ||
+        !check(table.targetCount < table.targets.size(), "too many targets")) {
+      return false;
+    }
+    table.targets[table.targetCount++] = target;
+    return true;
+  }
+
+  auto parseRule() -> bool {
+    const char* event = nullptr;
+    if (!parseString(event) || !check(consume(':'), "expected ':'") ||
+        !check(consume('['), "targets must be an array")) {
+      return false;
+    }
+
+    size_t const first = table.targetCount;
+    if (!consume(']')) {
+      do {
+        if (!parseTarget()) {
+          return false;
+        }
+      } while (consume(','));
+      if (!check(consume(']'), "expected ']'")) {
+        return false;
+      }
+    }
+
+    if (!check(table.targetCount > first, "rule without targets") ||
+        !check(table.ruleCount < MAX_RULES, "too many rules")) {
+      return false;
+    }
+
+    uint32_t const eventHash = hash(event, strlen(event));
+    for (size_t probe = 0; probe < BUCKETS; probe++) {
+      Rule& bucket = table.buckets[(eventHash + probe) & (BUCKETS - 1)];
+      if (bucket.event == nullptr) {
+        bucket = {event, eventHash, static_cast<uint8_t>(first), static_cast<uint8_t>(table.targetCount - first)};
+        table.ruleCount++;
+        return true;
+      }
+      if (!check(bucket.hash != eventHash || strcmp(bucket.event, event) != 0, "duplicate event")) {
+        return false;
+      }
+    }
+    return false;
+  }
+};
+
+auto RulesEngine::getInstance() -> RulesEngine& {
+  static RulesEngine instance;
+  return instance;
+}
+
+auto RulesEngine::init() -> void {
+  lastDefinitionHash = hash("", 0);
+
+  Preferences preferences;
+  preferences.begin(RULES_NAMESPACE, true);
+  size_t const length = preferences.isKey(RULES_KEY) ? preferences.getBytesLength(RULES_KEY) : 0;
+  if (length > 0 && length <= MAX_DEFINITION_BYTES) {
+    // Once at boot, so the definition doesn't hold a buffer afterwards
+    std::vector<char> json(length);
+    preferences.getBytes(RULES_KEY, json.data(), length);
+    if (load(json.data(), length)) {
+      lastDefinitionHash = hash(json.data(), length);
+      LOG_INFO("Loaded %u rules from NVS", static_cast<unsigned int>(getRuleCount()));
+    }
+  }
+  preferences.end();
+}
+
+auto RulesEngine::onDefinitionReceived(const byte* payload, unsigned int length) -> void {
+  // Retained definitions are redelivered on every reconnect, only load and
+  // save changes
+  const char* json = reinterpret_cast<const char*>(payload);
+  uint32_t const definitionHash = hash(json, length);
+  if (definitionHash == lastDefinitionHash) {
+    return;
+  }
+
+  if (length == 0) {
+    activeTable = 1 - activeTable;
+    reset(tables[activeTable]);
+    LOG_INFO("Rules cleared");
+  } else if (load(json, length)) {
+    LOG_INFO("Loaded %u rules, %u targets", static_cast<unsigned int>(getRuleCount()),
+             static_cast<unsigned int>(tables[activeTable].targetCount));
+  } else {
+    return;
+  }
+  lastDefinitionHash = definitionHash;
+  save(payload, length);
+}
+
+auto RulesEngine::match(const char* event, size_t& count) const -> const Target* {
+  const Table& table = tables[activeTable];
+  count = 0;
+  if (table.ruleCount == 0) {
+    return nullptr;
+  }
+
+  uint32_t const eventHash = hash(event, strlen(event));
+  for (size_t probe = 0; probe < BUCKETS; probe++) {
+    const Rule& rule = table.buckets[(eventHash + probe) & (BUCKETS - 1)];
+    if (rule.event == nullptr) {
+      return nullptr;
+    }
+    if (rule.hash == eventHash && strcmp(rule.event, event) == 0) {
+      count = rule.targetCount;
+      return &table.targets[rule.firstTarget];
+    }
+  }
+  return nullptr;
+}
+
+auto RulesEngine::getRuleCount() const -> size_t {
+  return tables[activeTable].ruleCount;
+}
+
+auto RulesEngine::usesTimestamp(const char* payloadTemplate) -> bool {
+  return strstr(payloadTemplate, TIMESTAMP_PLACEHOLDER) != nullptr;
+}
+
+auto RulesEngine::expand(const char* payloadTemplate, const char* event, const char* timestamp, Payload& out) -> bool {
+  out.clear();
+  const char* cursor = payloadTemplate;
+  while (const char* open = strchr(cursor, '{')) {
+    out.append(cursor, open - cursor);
+    if (strncmp(open, EVENT_PLACEHOLDER, sizeof(EVENT_PLACEHOLDER) - 1) == 0) {
+      out.append(event);
+      cursor = open + sizeof(EVENT_PLACEHOLDER) - 1;
+    } else if (strncmp(open, TIMESTAMP_PLACEHOLDER, sizeof(TIMESTAMP_PLACEHOLDER) - 1) == 0) {
+      out.append(timestamp);
+      cursor = open + sizeof(TIMESTAMP_PLACEHOLDER) - 1;
+    } else {
+      // Literal braces, e.g. a JSON payload
+      out.append('{');
+      cursor = open + 1;
+    }
+  }
+  out.append(cursor);
+  return !out.isTruncated();
+}
+
+auto RulesEngine::load(const char* json, size_t length) -> bool {
+  Table& staging = tables[1 - activeTable];
+  reset(staging);
+
+  Parser parser(json, length, staging);
+  if (!parser.parse()) {
+    LOG_ERROR("Rejected rules definition: %s", parser.getError());
+    return false;
+  }
+  activeTable = 1 - activeTable;
+  return true;
+}
+
+auto RulesEngine::save(const byte* payload, unsigned int length) -> void {
+  Preferences preferences;
+  preferences.begin(RULES_NAMESPACE, false);
+  if (length == 0) {
+    preferences.remove(RULES_KEY);
+  } else if (preferences.putBytes(RULES_KEY, payload, length) != length) {
+    LOG_ERROR("Failed to save rules to NVS");
+  }
+  preferences.end();
+}
+
+auto RulesEngine::reset(Table& table) -> void {
+  table.buckets.fill(Rule{nullptr, 0, 0, 0});
+  table.ruleCount = 0;
+  table.targetCount = 0;
+  table.stringBytes = 0;
+}
+
+auto RulesEngine::hash(const char* text, size_t length) -> uint32_t {
+  uint32_t value = FNV_OFFSET_BASIS;
+  for (size_t i = 0; i < length; i++) {
+    value = (value ^ static_cast<uint8_t>(text[i])) * FNV_PRIME;
+  }
+  return value;
+}
@@ -0,0 +1,218 @@
+#include "scheduler.h"
+#include "breadcrumbs.h"
+#include <Arduino.h>
+#include <logging.h>
+
+const double PERCENT = 100.0;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+Scheduler Scheduler::loopScheduler("loop", 0);
+
+auto Scheduler::getInstance() -> Scheduler& {
+  return loopScheduler;
+}
+
+auto Scheduler::getNetworkInstance() -> Scheduler& {
+  static Scheduler instance("network", NETWORK_ID_BASE);
+  return instance;
+}
+
+auto Scheduler::init() -> void {
+  ownerTask = xTaskGetCurrentTaskHandle();
+  lastElapsedMark = micros();
+}
+
+auto Scheduler::addTask(const char* name, TaskCallback run, TaskReadyCheck ready) -> uint8_t {
+  if (taskCount >= MAX_TASKS) {
+    LOG_ERROR("Scheduler full, cannot add task: %s", name);
+    return MAX_TASKS;
+  }
+
+  uint8_t const task = taskCount++;
+  tasks[task] = {name, run, ready, NO_DEADLINE, -1, 0, 0, 0};
+
+  // New tasks run on the next pass to compute their first deadline
+  scheduleAt(task, millis());
+  return task;
+}
+
+auto Scheduler::scheduleAt(uint8_t task, unsigned long deadline) -> void {
+  if (task >= taskCount) {
+    return;
+  }
+
+  removeFromHeap(task);
+  tasks[task].deadline = deadline;
+  if (deadline == NO_DEADLINE) {
+    return;
+  }
+
+  uint8_t const index = heapSize++;
+  heap[index] = task;
+  tasks[task].heapIndex = static_cast<int8_t>(index);
+  siftUp(index);
+}
+
+auto Scheduler::notify() -> void {
+  if (ownerTask != nullptr) {
+    xTaskNotifyGive(ownerTask);
+  }
+}
+
+auto IRAM_ATTR Scheduler::notifyFromIsr() -> void {
+  if (loopScheduler.ownerTask == nullptr) {
+    return;
+  }
+  BaseType_t higherPriorityTaskWoken = pdFALSE;
+  vTaskNotifyGiveFromISR(loopScheduler.ownerTask, &higherPriorityTaskWoken);
+  portYIELD_FROM_ISR(higherPriorityTaskWoken);
+}
+
+auto Scheduler::signal(uint8_t task) -> void {
+  if (task < MAX_TASKS) {
+    signalledTasks.fetch_or(1U << task);
+  }
+  notify();
+}
+
+auto IRAM_ATTR Scheduler::signalFromIsr(uint8_t task) -> void {
+  if (task < MAX_TASKS) {
+    loopScheduler.signalledTasks.fetch_or(1U << task);
+  }
+  notifyFromIsr();
+}
+
+auto Scheduler::waitForWork() -> void {
+  TickType_t timeout = portMAX_DELAY;
+  if (heapSize > 0) {
+    long const remaining = static_cast<long>(tasks[heap[0]].deadline - millis());
+    timeout = remaining <= 0 ? 0 : pdMS_TO_TICKS(remaining);
+  }
+
+  if (timeout > 0) {
+    unsigned long const start = micros();
+    ulTaskNotifyTake(pdTRUE, timeout);
+    sleepMicros += micros() - start;
+  }
+  wakeups++;
+
+  // Accumulated in steps so it outlasts the 32-bit micros() wrap
+  unsigned long const mark = micros();
+  elapsedMicros += mark - lastElapsedMark;
+  lastElapsedMark = mark;
+}
+
+auto Scheduler::runDue() -> void {
+  unsigned long const now = millis();
+  uint32_t const signalled = signalledTasks.exchange(0);
+
+  // Tasks run in registration order so earlier tasks can feed later ones
+  for (uint8_t task = 0; task < taskCount; task++) {
+    bool const due = tasks[task].heapIndex >= 0 && static_cast<long>(now - tasks[task].deadline) >= 0;
+    bool const ready = (signalled & (1U << task)) != 0 || (tasks[task].ready != nullptr && tasks[task].ready());
+    if (due || ready) {
+      runTask(task, now);
+    }
+  }
+}
+
+auto Scheduler::runTask(uint8_t task, unsigned long now) -> void {
+  Task& entry = tasks[task];
+  Breadcrumbs& breadcrumbs = Breadcrumbs::getInstance();
+
+  auto const id = static_cast<uint8_t>(idBase + task);
+  breadcrumbs.beginTask(id);
+  unsigned long const start = micros();
+  unsigned long const next = entry.run(now);
+  auto const elapsed = static_cast<uint32_t>(micros() - start);
+  breadcrumbs.endTask(id, elapsed);
+
+  entry.runs++;
+  entry.totalMicros += elapsed;
+  entry.maxMicros = max(entry.maxMicros, elapsed);
+
+  scheduleAt(task, next);
+}
+
+auto Scheduler::getTaskName(uint8_t id) -> const char* {
+  const Scheduler& scheduler = id >= NETWORK_ID_BASE ? getNetworkInstance() : loopScheduler;
+  uint8_t const task = id - scheduler.idBase;
+  return task < scheduler.taskCount ? scheduler.tasks[task].name : "none";
+}
+
+auto Scheduler::dumpStats(Print& output) const -> void {
+  // Share of the wall time since init(), so the figures for one scheduler
+  // add up to its core's load from scheduled work
+  double const elapsed = elapsedMicros == 0 ? 1.0 : static_cast<double>(elapsedMicros);
+  uint64_t busyMicros = 0;
+  for (uint8_t task = 0; task < taskCount; task++) {
+    busyMicros += tasks[task].totalMicros;
+  }
+  output.printf("# %s scheduler: %u wakeups, %llu us asleep, %.1f%% busy\n", name, wakeups, sleepMicros,
+                static_cast<double>(busyMicros) * PERCENT / elapsed);
+  for (uint8_t task = 0; task < taskCount; task++) {
+    const Task& entry = tasks[task];
+    uint32_t const average = entry.runs == 0 ? 0 : static_cast<uint32_t>(entry.totalMicros / entry.runs);
+    output.printf("%-8s runs=%u total=%lluus avg=%uus max=%uus cpu=%.2f%%\n", entry.name, entry.runs, entry.totalMicros,
+                  average, entry.maxMicros, static_cast<double>(entry.totalMicros) * PERCENT / elapsed);
+  }
+}
+
+auto Scheduler::isEarlier(uint8_t a, uint8_t b) const -> bool {
+  return static_cast<long>(tasks[heap[a]].deadline - tasks[heap[b]].deadline) < 0;
+}
+
+auto Scheduler::swapHeap(uint8_t i, uint8_t j) -> void {
+  std::swap(heap[i], heap[j]);
+  tasks[heap[i]].heapIndex = static_cast<int8_t>(i);
+  tasks[heap[j]].heapIndex = static_cast<int8_t>(j);
+}
+
+auto Scheduler::siftUp(uint8_t index) -> void {
+  while (index > 0) {
+    uint8_t const parent = (index - 1) / 2;
+    if (!isEarlier(index, parent)) {
+      return;
+    }
+    swapHeap(index, parent);
+    index = parent;
+  }
+}
+
+auto Scheduler::siftDown(uint8_t index) -> void {
+  while (true) {
+    uint8_t const left = 2 * index + 1;
+    uint8_t const right = left + 1;
+    uint8_t earliest = index;
+    if (left < heapSize && isEarlier(left, earliest)) {
+      earliest = left;
+    }
+    if (right < heapSize && isEarlier(right, earliest)) {
+      earliest = right;
+    }
+    if (earliest == index) {
+      return;
+    }
+    swapHeap(index, earliest);
+    index = earliest;
+  }
+}
+
+auto Scheduler::removeFromHeap(uint8_t task) -> void {
+  int8_t const index = tasks[task].heapIndex;
+  if (index < 0) {
+    return;
+  }
+
+  tasks[task].heapIndex = -1;
+  uint8_t const last = --heapSize;
+  if (index == last) {
+    return;
+  }
+
+  uint8_t const moved = heap[last];
+  heap[index] = moved;
+  tasks[moved].heapIndex = index;
+  siftUp(index);
+  siftDown(tasks[moved].heapIndex);
+}
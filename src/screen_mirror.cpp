@@ -0,0 +1,149 @@
+#include "screen_mirror.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <logging.h>
+
+const uint8_t ScreenMirror::DEFAULT_FPS = 2;
+// Mirroring may take this share of the loop however slow encoding gets
+const uint32_t ScreenMirror::MAX_LOAD_PERCENT = 2;
+const unsigned long MILLIS_PER_SECOND = 1000;
+const uint32_t MICROS_PER_MILLI = 1000;
+const uint32_t PERCENT = 100;
+const size_t MIN_ENCODED_RUN = 3; // Shorter runs cost as much as literals
+const unsigned int PACKBITS_REPEAT_BASE = 257;
+
+auto ScreenMirror::getInstance() -> ScreenMirror& {
+  static ScreenMirror instance;
+  return instance;
+}
+
+auto ScreenMirror::init() -> void {
+  Preferences preferences;
+  preferences.begin("mirror", true);
+  maxFps = min(preferences.getUChar("fps", DEFAULT_FPS), MAX_FPS);
+  preferences.end();
+  frameInterval = maxFps == 0 ? 0 : MILLIS_PER_SECOND / maxFps;
+}
+
+auto ScreenMirror::setMaxFps(uint8_t fps) -> void {
+  fps = min(fps, MAX_FPS);
+  if (fps == maxFps) {
+    return;
+  }
+
+  maxFps = fps;
+  frameInterval = maxFps == 0 ? 0 : MILLIS_PER_SECOND / maxFps;
+  nextFrameAt = millis();
+  // Whatever is on screen now goes out straight away
+  published = false;
+  mirroredFrame = UINT32_MAX;
+
+  Preferences preferences;
+  preferences.begin("mirror", false);
+  preferences.putUChar("fps", maxFps);
+  preferences.end();
+  LOG_INFO("Screen mirror: %u fps", maxFps);
+}
+
+auto ScreenMirror::hasFrameDue() const -> bool {
+  return maxFps > 0 && (Display::getInstance().getFrameCount() != mirroredFrame || resendRequested.load());
+}
+
+auto ScreenMirror::update(unsigned long now) -> unsigned long {
+  if (maxFps == 0) {
+    return Scheduler::NO_DEADLINE;
+  }
+  if (resendRequested.exchange(false)) {
+    published = false;
+    mirroredFrame = UINT32_MAX;
+  }
+
+  Display& display = Display::getInstance();
+  uint32_t const frameCount = display.getFrameCount();
+  if (frameCount == mirroredFrame) {
+    return Scheduler::NO_DEADLINE;
+  }
+  if (static_cast<long>(now - nextFrameAt) < 0) {
+    return nextFrameAt;
+  }
+
+  // Redraws often leave the pixels as they were
+  const uint8_t* frame = display.getFrameBuffer();
+  if (published && memcmp(frame, lastFrame.data(), lastFrame.size()) == 0) {
+    mirroredFrame = frameCount;
+    return Scheduler::NO_DEADLINE;
+  }
+
+  // With the network task behind, try again later with whatever is newest
+  Frame* slot = frames.acquire();
+  if (slot == nullptr) {
+    return now + frameInterval;
+  }
+
+  PROFILE_SCOPE("mirror");
+  unsigned long const start = micros();
+  encode(frame, *slot);
+  frames.publish();
+  memcpy(lastFrame.data(), frame, lastFrame.size());
+  mirroredFrame = frameCount;
+  published = true;
+  Scheduler::getNetworkInstance().notify();
+
+  unsigned long const cooldown = (micros() - start) * PERCENT / MAX_LOAD_PERCENT / MICROS_PER_MILLI;
+  nextFrameAt = now + max(frameInterval, cooldown);
+  return Scheduler::NO_DEADLINE;
+}
+
+auto ScreenMirror::hasFrames() const -> bool {
+  return !frames.empty();
+}
+
+auto ScreenMirror::nextFrame() -> const Frame* {
+  return frames.front();
+}
+
+auto ScreenMirror::releaseFrame() -> void {
+  frames.release();
+}
+
+auto ScreenMirror::resend() -> void {
+  resendRequested.store(true);
+  Scheduler::getInstance().notify();
+}
+
+auto ScreenMirror::encode(const uint8_t* frame, Frame& out) -> void {
+  uint8_t* payload = out.payload.data();
+  size_t used = 0;
+  payload[used++] = Display::WIDTH;
+  payload[used++] = Display::HEIGHT;
+
+  size_t i = 0;
+  while (i < FRAME_BYTES) {
+    size_t run = 1;
+    while (i + run < FRAME_BYTES && run < PACKBITS_RUN && frame[i + run] == frame[i]) {
+      run++;
+    }
+    if (run > 1) {
+      payload[used++] = static_cast<uint8_t>(PACKBITS_REPEAT_BASE - run);
+      payload[used++] = frame[i];
+      i += run;
+      continue;
+    }
+
+    // Literals up to the next run worth encoding
+    size_t const first = i;
+    while (i < FRAME_BYTES && i - first < PACKBITS_RUN) {
+      if (i + MIN_ENCODED_RUN <= FRAME_BYTES && frame[i] == frame[i + 1] && frame[i] == frame[i + 2]) {
+        break;
+      }
+      i++;
+    }
+    size_t const count = i - first;
+    payload[used++] = static_cast<uint8_t>(count - 1);
+    memcpy(&payload[used], &frame[first], count);
+    used += count;
+  }
+  out.length = static_cast<uint16_t>(used);
+}
@@ -1,6 +1,6 @@
 #include "sign_state.h"
+#include "change_bus.h"
 #include <Arduino.h>
-#include <Elog.h>
 #include <logging.h>
 #include <mbedtls/base64.h>
 
@@ -10,33 +10,30 @@ auto SignState::getInstance() -> SignState& {
 }
 
 auto SignState::init() -> void {
-  Logger.debug(MAIN_LOG, "Initializing SignState...");
+  LOG_DEBUG("Initializing SignState...");
   
   // Initialize with empty image data
   monochromeImageData.clear();
   monochromeImageData.resize((IMAGE_WIDTH * IMAGE_HEIGHT) / 8, 0); // 1 bit per pixel, packed into bytes
   imageDataAvailable = false;
   
-  Logger.debug(MAIN_LOG, "SignState initialized.");
+  LOG_DEBUG("SignState initialized.");
 }
 
-auto SignState::update() -> void {
-  // SignState is event-driven via MQTT, no periodic updates needed
-}
-
-auto SignState::onImageReceived(const String& imageData) -> void {
-  Logger.debug(MAIN_LOG, "Received new image data, length: %d", imageData.length());
+auto SignState::onImageReceived(const uint8_t* imageData, size_t length) -> void {
+  LOG_DEBUG("Received new image data, length: %d", length);
   
   try {
-    monochromeImageData = convertToMonochrome(imageData);
+    monochromeImageData = convertToMonochrome(imageData, length);
     imageDataAvailable = true;
     lastImageUpdate = millis();
     
-    Logger.debug(MAIN_LOG, "Image converted to monochrome successfully");
+    LOG_DEBUG("Image converted to monochrome successfully");
   } catch (const std::exception& e) {
-    Logger.error(MAIN_LOG, "Failed to process image data: %s", e.what());
+    LOG_ERROR("Failed to process image data: %s", e.what());
     imageDataAvailable = false;
   }
+  ChangeBus::getInstance().publish(Change::SIGN_IMAGE);
 }
 
 auto SignState::getImageData() const -> const std::vector<uint8_t>& {
@@ -47,11 +44,11 @@ auto SignState::hasImageData() const -> bool {
   return imageDataAvailable;
 }
 
-auto SignState::convertToMonochrome(const String& base64Data) -> std::vector<uint8_t> {
+auto SignState::convertToMonochrome(const uint8_t* base64Data, size_t length) -> std::vector<uint8_t> {
   // Decode base64 to get BMP data
-  std::vector<uint8_t> bmpData = decodeBase64(base64Data);
+  std::vector<uint8_t> bmpData = decodeBase64(base64Data, length);
   
-  Logger.debug(MAIN_LOG, "Decoded BMP data size: %d bytes", bmpData.size());
+  LOG_DEBUG("Decoded BMP data size: %d bytes", bmpData.size());
   
   // Parse BMP to extract RGB data
   std::vector<uint8_t> rgbData = parseBMP(bmpData);
@@ -59,7 +56,7 @@ auto SignState::convertToMonochrome(const String& base64Data) -> std::vector<uin
   // Expected size: 32 * 8 * 3 = 768 bytes (RGB)
   const size_t expectedSize = IMAGE_WIDTH * IMAGE_HEIGHT * 3;
   if (rgbData.size() != expectedSize) {
-    Logger.error(MAIN_LOG, "Invalid RGB data size: %d, expected: %d", rgbData.size(), expectedSize);
+    LOG_ERROR("Invalid RGB data size: %d, expected: %d", rgbData.size(), expectedSize);
     throw std::runtime_error("Invalid RGB data size");
   }
   
@@ -89,9 +86,8 @@ auto SignState::convertToMonochrome(const String& base64Data) -> std::vector<uin
   return monoData;
 }
 
-auto SignState::decodeBase64(const String& encoded) -> std::vector<uint8_t> {
+auto SignState::decodeBase64(const uint8_t* encoded, size_t encodedLen) -> std::vector<uint8_t> {
   // Calculate decoded size
-  size_t const encodedLen = encoded.length();
   size_t const maxDecodedLen = (encodedLen * 3) / 4 + 4; // Add some padding
   
   std::vector<uint8_t> decoded(maxDecodedLen);
@@ -99,15 +95,15 @@ auto SignState::decodeBase64(const String& encoded) -> std::vector<uint8_t> {
   // Use mbedtls base64 decode function
   size_t actualLength = 0;
   int const result = mbedtls_base64_decode(decoded.data(), maxDecodedLen, &actualLength,
-                                          reinterpret_cast<const unsigned char*>(encoded.c_str()), encodedLen);
+                                          encoded, encodedLen);
   
   if (result != 0) {
-    Logger.error(MAIN_LOG, "Base64 decode failed with error: %d", result);
+    LOG_ERROR("Base64 decode failed with error: %d", result);
     throw std::runtime_error("Base64 decode failed");
   }
   
   decoded.resize(actualLength);
-  Logger.debug(MAIN_LOG, "Base64 decoded %d bytes from %d encoded bytes", actualLength, encodedLen);
+  LOG_DEBUG("Base64 decoded %d bytes from %d encoded bytes", actualLength, encodedLen);
   
   return decoded;
 }
@@ -128,17 +124,17 @@ auto SignState::parseBMP(const std::vector<uint8_t>& bmpData) -> std::vector<uin
   uint32_t const height = bmpData[22] | (bmpData[23] << 8) | (bmpData[24] << 16) | (bmpData[25] << 24);
   uint16_t const bitsPerPixel = bmpData[28] | (bmpData[29] << 8);
   
-  Logger.debug(MAIN_LOG, "BMP info: %dx%d, %d bpp, data offset: %d", width, height, bitsPerPixel, dataOffset);
+  LOG_DEBUG("BMP info: %dx%d, %d bpp, data offset: %d", width, height, bitsPerPixel, dataOffset);
   
   // Validate dimensions
   if (width != IMAGE_WIDTH || height != IMAGE_HEIGHT) {
-    Logger.error(MAIN_LOG, "Invalid BMP dimensions: %dx%d, expected: %dx%d", width, height, IMAGE_WIDTH, IMAGE_HEIGHT);
+    LOG_ERROR("Invalid BMP dimensions: %dx%d, expected: %dx%d", width, height, IMAGE_WIDTH, IMAGE_HEIGHT);
     throw std::runtime_error("Invalid BMP dimensions");
   }
   
   // Only support 24-bit BMPs for now
   if (bitsPerPixel != 24) {
-    Logger.error(MAIN_LOG, "Unsupported BMP format: %d bpp, expected: 24", bitsPerPixel);
+    LOG_ERROR("Unsupported BMP format: %d bpp, expected: 24", bitsPerPixel);
     throw std::runtime_error("Unsupported BMP format");
   }
   
@@ -0,0 +1,221 @@
+#include "soak_test.h"
+
+#ifdef SOAK_TEST
+
+#include "mqtt_manager.h"
+#include "scheduler.h"
+#include "sign_state.h"
+#include <array>
+#include <logging.h>
+#include <mbedtls/base64.h>
+
+// The five buttons; the dial button is left out since it selects menu items
+const uint8_t SOAK_BUTTONS = 5;
+// Each iteration queues a publish or two; small batches let the network
+// task drain them between batches
+const uint32_t BATCH_SIZE = 4;
+const uint32_t WARMUP_ITERATIONS = 1000;
+const uint32_t SIGN_IMAGE_INTERVAL = 100;
+const uint32_t RECONNECT_INTERVAL = 5000;
+const uint32_t REPORT_INTERVAL = 50000;
+// Shrinkage of the largest free block still put down to noise
+const uint32_t FRAGMENTATION_TOLERANCE = 1024;
+
+const size_t MAX_SOAK_TOPIC_LENGTH = 64;
+const size_t MAX_SOAK_PAYLOAD_LENGTH = 16;
+
+struct SoakMessage {
+  const char* topic;
+  const char* payload;
+};
+
+const std::array<SoakMessage, 8> SOAK_MESSAGES = {{
+  {"desk-control/light-status", "on"},
+  {"desk-control/fan-status", "off"},
+  {"homeassistant/sensor/pc_status_monitor_status/status", "ON"},
+  {"homeassistant/sensor/pc_status_monitor_cpu_temp_avg/state", "54.5"},
+  {"homeassistant/sensor/pc_status_monitor_cpu_usage_avg/state", "12.25"},
+  {"homeassistant/sensor/pc_status_monitor_gpu_temp/state", "61"},
+  {"homeassistant/sensor/pc_status_monitor_gpu_util/state", "97.5"},
+  {"homeassistant/sensor/pc_status_monitor_ram_usage/state", "43.0"},
+}};
+
+// A 24-bit BMP of the sign's size, as the sign image topic carries it
+const size_t BMP_HEADER_SIZE = 54;
+const size_t BMP_INFO_SIZE = 40;
+const size_t BMP_PIXEL_BYTES = SignState::IMAGE_WIDTH * SignState::IMAGE_HEIGHT * 3;
+const size_t BMP_SIZE = BMP_HEADER_SIZE + BMP_PIXEL_BYTES;
+const size_t BMP_BASE64_SIZE = (BMP_SIZE + 2) / 3 * 4 + 1;
+const int BYTE_BITS = 8;
+const uint8_t PIXEL_ON = 0xFF;
+
+static auto writeLittleEndian(uint8_t* target, uint32_t value, size_t bytes) -> void {
+  for (size_t i = 0; i < bytes; i++) {
+    target[i] = static_cast<uint8_t>(value >> (i * BYTE_BITS));
+  }
+}
+
+auto SoakTest::getInstance() -> SoakTest& {
+  static SoakTest instance;
+  return instance;
+}
+
+auto SoakTest::init(ButtonEdgeHandler buttonHandler, RotaryStepsHandler rotaryHandler) -> void {
+  this->buttonHandler = buttonHandler;
+  this->rotaryHandler = rotaryHandler;
+}
+
+auto SoakTest::start(uint32_t iterations) -> void {
+  if (buttonHandler == nullptr || rotaryHandler == nullptr) {
+    LOG_ERROR("Soak test not initialized");
+    return;
+  }
+
+  iteration = 0;
+  iterationLimit = iterations;
+  startMillis = millis();
+  baseline = sampleHeap();
+  lowest = baseline;
+  running = true;
+  LOG_INFO("Soak test: %u iterations, free %u, largest block %u", iterationLimit, baseline.freeHeap,
+           baseline.largestBlock);
+  Scheduler::getInstance().notify();
+}
+
+auto SoakTest::stop() -> void {
+  if (running) {
+    finish();
+  }
+}
+
+auto SoakTest::isRunning() const -> bool {
+  return running;
+}
+
+auto SoakTest::update(unsigned long now) -> unsigned long {
+  if (!running) {
+    return Scheduler::NO_DEADLINE;
+  }
+
+  for (uint32_t i = 0; i < BATCH_SIZE && iteration < iterationLimit; i++) {
+    runIteration(now);
+    iteration++;
+    trackHeap();
+  }
+
+  if (iteration >= iterationLimit) {
+    finish();
+    return Scheduler::NO_DEADLINE;
+  }
+  return now;
+}
+
+auto SoakTest::runIteration(unsigned long now) -> void {
+  // A press and release publishes the press; repeated presses within the
+  // double click window also publish gestures
+  auto const button = static_cast<uint8_t>(iteration % SOAK_BUTTONS);
+  buttonHandler(button, true, now);
+  buttonHandler(button, false, now);
+
+  // Back and forth so the menu stays put
+  rotaryHandler(iteration % 2 == 0 ? -1 : 1);
+
+  deliverMessage();
+
+  if (iteration % SIGN_IMAGE_INTERVAL == 0) {
+    deliverSignImage();
+  }
+  if (iteration % RECONNECT_INTERVAL == RECONNECT_INTERVAL - 1) {
+    MQTTManager::getInstance().reconnect();
+  }
+}
+
+auto SoakTest::deliverMessage() -> void {
+  // PubSubClient hands messages over in writable buffers
+  const SoakMessage& message = SOAK_MESSAGES[iteration % SOAK_MESSAGES.size()];
+  std::array<char, MAX_SOAK_TOPIC_LENGTH> topic{};
+  std::array<uint8_t, MAX_SOAK_PAYLOAD_LENGTH> payload{};
+  strlcpy(topic.data(), message.topic, topic.size());
+  size_t const length = min(strlen(message.payload), payload.size());
+  memcpy(payload.data(), message.payload, length);
+  MQTTManager::onMqttMessage(topic.data(), payload.data(), length);
+}
+
+auto SoakTest::deliverSignImage() -> void {
+  // Too big for the loop task's stack
+  // NOLINTBEGIN(cppcoreguidelines-avoid-non-const-global-variables)
+  static std::array<uint8_t, BMP_SIZE> bmp{};
+  static std::array<uint8_t, BMP_BASE64_SIZE> encoded{};
+  // NOLINTEND(cppcoreguidelines-avoid-non-const-global-variables)
+
+  bmp.fill(0);
+  bmp[0] = 'B';
+  bmp[1] = 'M';
+  writeLittleEndian(&bmp[2], BMP_SIZE, 4);
+  writeLittleEndian(&bmp[10], BMP_HEADER_SIZE, 4);
+  writeLittleEndian(&bmp[14], BMP_INFO_SIZE, 4);
+  writeLittleEndian(&bmp[18], SignState::IMAGE_WIDTH, 4);
+  writeLittleEndian(&bmp[22], SignState::IMAGE_HEIGHT, 4);
+  writeLittleEndian(&bmp[26], 1, 2);
+  writeLittleEndian(&bmp[28], 24, 2);
+  writeLittleEndian(&bmp[34], BMP_PIXEL_BYTES, 4);
+
+  // A diagonal stripe pattern that moves with every image
+  uint32_t const frame = iteration / SIGN_IMAGE_INTERVAL;
+  for (size_t pixel = 0; pixel < BMP_PIXEL_BYTES / 3; pixel++) {
+    size_t const x = pixel % SignState::IMAGE_WIDTH;
+    size_t const y = pixel / SignState::IMAGE_WIDTH;
+    if ((x + y + frame) % 4 == 0) {
+      memset(&bmp[BMP_HEADER_SIZE + pixel * 3], PIXEL_ON, 3);
+    }
+  }
+
+  size_t length = 0;
+  if (mbedtls_base64_encode(encoded.data(), encoded.size(), &length, bmp.data(), bmp.size()) != 0) {
+    LOG_ERROR("Soak test: sign image encode failed");
+    return;
+  }
+
+  std::array<char, MAX_SOAK_TOPIC_LENGTH> topic{};
+  strlcpy(topic.data(), "office_sign/image/set", topic.size());
+  MQTTManager::onMqttMessage(topic.data(), encoded.data(), length);
+}
+
+auto SoakTest::trackHeap() -> void {
+  HeapSample const sample = sampleHeap();
+  if (iteration == WARMUP_ITERATIONS) {
+    baseline = sample;
+    lowest = sample;
+  }
+  lowest.freeHeap = min(lowest.freeHeap, sample.freeHeap);
+  lowest.largestBlock = min(lowest.largestBlock, sample.largestBlock);
+
+  if (iteration % REPORT_INTERVAL == 0) {
+    LOG_INFO("Soak %u/%u: free %u (lowest %u), largest block %u (lowest %u)", iteration, iterationLimit,
+             sample.freeHeap, lowest.freeHeap, sample.largestBlock, lowest.largestBlock);
+  }
+}
+
+auto SoakTest::finish() -> void {
+  running = false;
+  HeapSample const end = sampleHeap();
+  unsigned long const seconds = (millis() - startMillis) / 1000;
+
+  LOG_INFO("Soak done: %u iterations in %lu s, min free heap ever %u", iteration, seconds, ESP.getMinFreeHeap());
+  LOG_INFO("Soak heap after warm-up: free %u -> %u (lowest %u), largest block %u -> %u (lowest %u)",
+           baseline.freeHeap, end.freeHeap, lowest.freeHeap, baseline.largestBlock, end.largestBlock,
+           lowest.largestBlock);
+  if (iteration <= WARMUP_ITERATIONS) {
+    LOG_WARNING("Soak: stopped during warm-up, too short to judge");
+  } else if (end.largestBlock + FRAGMENTATION_TOLERANCE < baseline.largestBlock) {
+    LOG_WARNING("Soak: largest free block shrank by %u bytes", baseline.largestBlock - end.largestBlock);
+  } else {
+    LOG_INFO("Soak: heap stayed flat");
+  }
+}
+
+auto SoakTest::sampleHeap() -> HeapSample {
+  return {ESP.getFreeHeap(), ESP.getMaxAllocHeap()};
+}
+
+#endif // SOAK_TEST
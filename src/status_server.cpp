@@ -0,0 +1,232 @@
+#include "status_server.h"
+#include "app_state.h"
+#include "config.h"
+#include "display.h"
+#include "mqtt_manager.h"
+#include "profiler.h"
+#include "scheduler.h"
+#include <Arduino.h>
+#include <ArduinoJson.h>
+#include <logging.h>
+
+const unsigned long StatusServer::SNAPSHOT_MAX_AGE = 1000;
+const unsigned long StatusServer::SNAPSHOT_WAIT = 100; // Serve the old one if the loop is this busy
+const TickType_t SNAPSHOT_POLL_TICKS = pdMS_TO_TICKS(5);
+const size_t SERVER_STACK_SIZE = 6144; // The status handler copies the snapshot onto it
+const unsigned SERVER_TASK_PRIORITY = 1;
+const int SERVER_TASK_CORE = 0; // Away from the loop task on core 1
+const size_t PERF_CHUNK_SIZE = 256;
+const int PAGE_HEIGHT = 8;
+const int BYTE_BITS = 8;
+const char* const PBM_HEADER = "P4\n128 64\n";
+
+namespace {
+
+// Buffers Print output into chunks of a chunked HTTP response
+class ChunkedResponse : public Print {
+public:
+  explicit ChunkedResponse(httpd_req_t* request) : request(request) {}
+
+  auto write(uint8_t data) -> size_t override { return write(&data, 1); }
+
+  auto write(const uint8_t* data, size_t size) -> size_t override {
+    for (size_t i = 0; i < size; i++) {
+      if (used == buffer.size()) {
+        flush();
+      }
+      buffer[used++] = static_cast<char>(data[i]);
+    }
+    return size;
+  }
+
+  auto flush() -> void {
+    if (used > 0 && ok) {
+      ok = httpd_resp_send_chunk(request, buffer.data(), static_cast<ssize_t>(used)) == ESP_OK;
+    }
+    used = 0;
+  }
+
+  // Sends what is left and the terminating empty chunk
+  auto finish() -> esp_err_t {
+    flush();
+    return ok ? httpd_resp_send_chunk(request, nullptr, 0) : ESP_FAIL;
+  }
+
+private:
+  httpd_req_t* request;
+  std::array<char, PERF_CHUNK_SIZE> buffer{};
+  size_t used = 0;
+  bool ok = true;
+};
+
+} // namespace
+
+auto StatusServer::getInstance() -> StatusServer& {
+  static StatusServer instance;
+  return instance;
+}
+
+auto StatusServer::start() -> void {
+  if (server != nullptr) {
+    return;
+  }
+
+  httpd_config_t config = HTTPD_DEFAULT_CONFIG();
+  config.stack_size = SERVER_STACK_SIZE;
+  config.task_priority = SERVER_TASK_PRIORITY;
+  config.core_id = SERVER_TASK_CORE;
+  if (httpd_start(&server, &config) != ESP_OK) {
+    LOG_ERROR("Failed to start HTTP server");
+    server = nullptr;
+    return;
+  }
+
+  const std::array<httpd_uri_t, 4> handlers = {{
+    {"/", HTTP_GET, handleStatus, nullptr},
+    {"/status", HTTP_GET, handleStatus, nullptr},
+    {"/screen.pbm", HTTP_GET, handleScreen, nullptr},
+    {"/perf", HTTP_GET, handlePerf, nullptr},
+  }};
+  for (const httpd_uri_t& handler : handlers) {
+    httpd_register_uri_handler(server, &handler);
+  }
+  LOG_INFO("HTTP status server started on port %u", config.server_port);
+}
+
+auto StatusServer::hasSnapshotRequest() const -> bool {
+  return snapshotRequested.load();
+}
+
+auto StatusServer::refreshSnapshot() -> void {
+  snapshotRequested.store(false);
+
+  AppState& appState = AppState::getInstance();
+  Telemetry telemetry{};
+  appState.getTelemetry(telemetry);
+
+  JsonDocument doc;
+  doc["version"] = VERSION;
+  doc["uptime_ms"] = millis();
+
+  JsonObject heap = doc["heap"].to<JsonObject>();
+  heap["free"] = ESP.getFreeHeap();
+  heap["min_free"] = ESP.getMinFreeHeap();
+  heap["largest_block"] = ESP.getMaxAllocHeap();
+
+  int const mqttState = MQTTManager::getInstance().getClientState();
+  JsonObject mqtt = doc["mqtt"].to<JsonObject>();
+  mqtt["connected"] = mqttState == MQTT_CONNECTED;
+  mqtt["state"] = mqttState;
+
+  JsonObject menu = doc["menu"].to<JsonObject>();
+  menu["label"] = appState.getCurrentLabel();
+  const char* selected = appState.getSelectedLabel();
+  if (selected != nullptr) {
+    menu["selected"] = selected;
+  }
+
+  JsonObject values = doc["telemetry"].to<JsonObject>();
+  values["light"] = telemetry.lightStatus;
+  values["fan"] = telemetry.fanStatus;
+  values["pc"] = telemetry.pcStatus;
+  values["cpu_temp"] = telemetry.cpuTemp;
+  values["cpu_usage"] = telemetry.cpuUsage;
+  values["gpu_temp"] = telemetry.gpuTemp;
+  values["gpu_usage"] = telemetry.gpuUsage;
+  values["ram_usage"] = telemetry.ramUsage;
+  values["gpu_mem_usage"] = telemetry.gpuMemUsage;
+
+  std::array<char, MAX_SNAPSHOT_LENGTH> text{};
+  size_t const length = serializeJson(doc, text.data(), text.size());
+  if (doc.overflowed() || length >= text.size() - 1) {
+    LOG_ERROR("Status snapshot does not fit in %u bytes", static_cast<unsigned int>(text.size()));
+    return;
+  }
+
+  portENTER_CRITICAL(&snapshotLock);
+  memcpy(snapshot.data(), text.data(), length);
+  snapshotLength = length;
+  portEXIT_CRITICAL(&snapshotLock);
+  snapshotTakenAt.store(millis());
+  snapshotGeneration.fetch_add(1);
+}
+
+// Asks the loop task for a new snapshot and gives it a moment to take one.
+// Only the server task waits; the loop never waits on the server.
+auto StatusServer::awaitFreshSnapshot() -> void {
+  if (snapshotGeneration.load() != 0 && millis() - snapshotTakenAt.load() < SNAPSHOT_MAX_AGE) {
+    return;
+  }
+
+  uint32_t const generation = snapshotGeneration.load();
+  snapshotRequested.store(true);
+  Scheduler::getInstance().notify();
+  unsigned long const start = millis();
+  while (snapshotGeneration.load() == generation && millis() - start < SNAPSHOT_WAIT) {
+    vTaskDelay(SNAPSHOT_POLL_TICKS);
+  }
+}
+
+auto StatusServer::handleStatus(httpd_req_t* request) -> esp_err_t {
+  StatusServer& status = getInstance();
+  status.awaitFreshSnapshot();
+
+  std::array<char, MAX_SNAPSHOT_LENGTH> body{};
+  portENTER_CRITICAL(&status.snapshotLock);
+  size_t const length = status.snapshotLength;
+  memcpy(body.data(), status.snapshot.data(), length);
+  portEXIT_CRITICAL(&status.snapshotLock);
+
+  if (length == 0) {
+    httpd_resp_set_status(request, "503 Service Unavailable");
+    return httpd_resp_send(request, nullptr, 0);
+  }
+  httpd_resp_set_type(request, "application/json");
+  httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+  return httpd_resp_send(request, body.data(), static_cast<ssize_t>(length));
+}
+
+// PBM rows run left to right with the leftmost pixel in the top bit, where
+// the display buffer holds columns of eight rows. Each page is transposed
+// into one chunk as it is sent, so there is never a copy of the frame.
+auto StatusServer::handleScreen(httpd_req_t* request) -> esp_err_t {
+  const uint8_t* frame = Display::getInstance().getFrameBuffer();
+  const int rowBytes = Display::WIDTH / BYTE_BITS;
+
+  httpd_resp_set_type(request, "image/x-portable-bitmap");
+  httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+  if (httpd_resp_send_chunk(request, PBM_HEADER, static_cast<ssize_t>(strlen(PBM_HEADER))) != ESP_OK) {
+    return ESP_FAIL;
+  }
+
+  std::array<char, PAGE_HEIGHT * Display::WIDTH / BYTE_BITS> chunk{};
+  for (int page = 0; page < Display::HEIGHT / PAGE_HEIGHT; page++) {
+    const uint8_t* columns = &frame[page * Display::WIDTH];
+    for (int row = 0; row < PAGE_HEIGHT; row++) {
+      for (int byte = 0; byte < rowBytes; byte++) {
+        uint8_t packed = 0;
+        for (int bit = 0; bit < BYTE_BITS; bit++) {
+          packed = static_cast<uint8_t>((packed << 1) | ((columns[byte * BYTE_BITS + bit] >> row) & 1));
+        }
+        chunk[row * rowBytes + byte] = static_cast<char>(packed);
+      }
+    }
+    if (httpd_resp_send_chunk(request, chunk.data(), static_cast<ssize_t>(chunk.size())) != ESP_OK) {
+      return ESP_FAIL;
+    }
+  }
+  return httpd_resp_send_chunk(request, nullptr, 0);
+}
+
+auto StatusServer::handlePerf(httpd_req_t* request) -> esp_err_t {
+  httpd_resp_set_type(request, "text/plain");
+  httpd_resp_set_hdr(request, "Cache-Control", "no-store");
+
+  ChunkedResponse response(request);
+  Scheduler::getInstance().dumpStats(response);
+  Scheduler::getNetworkInstance().dumpStats(response);
+#ifdef PROFILING
+  Profiler::getInstance().dump(response);
+#endif
+  return response.finish();
+}
@@ -1,15 +1,31 @@
-#include "app_state.h"
+#include "network_task.h"
 #include "time_manager.h"
 #include <Arduino.h>
-#include <Elog.h>
 #include <logging.h>
 #include <display.h>
+#include <Preferences.h>
+#include <esp_sntp.h>
+#include "scheduler.h"
 
 // Define static member variables (constants only)
 const unsigned long TimeManager::NTP_SYNC_INTERVAL = 3600000; // 1 hour in milliseconds
-const unsigned long TimeManager::MINUTE_UPDATE_INTERVAL = 60000; // 1 minute in milliseconds
 const long SECONDS_PER_HOUR = 3600;
-const long TZ_OFFSET = -5;
+const long SECONDS_PER_MINUTE = 60;
+const long MILLIS_PER_SECOND = 1000;
+const char* const DEFAULT_POSIX_TIMEZONE = "EST5EDT,M3.2.0,M11.1.0";
+const time_t MIN_PLAUSIBLE_TIME = 8 * SECONDS_PER_HOUR * 2; // 16 hours in seconds
+const uint32_t RTC_TIME_MAGIC = 0x54494D45; // "TIME"
+
+// Survives soft resets (panic, watchdog, ESP.restart) but not power loss
+struct RtcTimeRecord {
+  uint32_t magic;
+  time_t epoch;
+};
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+RTC_NOINIT_ATTR RtcTimeRecord rtcTimeRecord;
+
+// NOLINTNEXTLINE(cppcoreguidelines-avoid-non-const-global-variables)
+std::atomic<bool> TimeManager::syncPending{false};
 
 auto TimeManager::getInstance() -> TimeManager& {
   static TimeManager instance;
@@ -17,31 +33,44 @@ auto TimeManager::getInstance() -> TimeManager& {
 }
 
 auto TimeManager::init() -> void {
-  Logger.debug(MAIN_LOG, "Initializing time manager...");
+  LOG_DEBUG("Initializing time manager...");
 
-  Display::getInstance().setLoadingMessage("Syncing Time");
+  // The seeded time is shown in local time, long before SNTP starts
+  loadTimezone();
 
-  // Give WiFi a moment to stabilize
-  const int WIFI_DELAY_MS = 1000;
-  delay(WIFI_DELAY_MS);
-  
+  // Show the last known time straight away, SNTP corrects it when it answers
+  if (seedClock()) {
+    timeInitialized = true;
+  } else {
+    NetworkTask::getInstance().postRootLabel("Syncing Time");
+  }
+
+  updateTimeDisplay();
+  LOG_DEBUG("Time manager initialized.");
+}
+
+auto TimeManager::startSync() -> void {
   setupNTP();
-  Logger.debug(MAIN_LOG, "Time manager initialized.");
+  ntpStarted = true;
+  lastNTPSync = millis();
 }
 
 auto TimeManager::update() -> void {
   unsigned long const currentMillis = millis();
+
+  if (syncPending.exchange(false)) {
+    onSyncReceived();
+  }
   
   // Sync with NTP server every hour
-  if (currentMillis - lastNTPSync >= NTP_SYNC_INTERVAL) {
+  if (ntpStarted && currentMillis - lastNTPSync >= NTP_SYNC_INTERVAL) {
     syncTimeFromNTP();
     lastNTPSync = currentMillis;
   }
   
-  // Update time display every minute
-  if (currentMillis - lastMinuteUpdate >= MINUTE_UPDATE_INTERVAL) {
+  // Update time display on each minute boundary
+  if (static_cast<long>(currentMillis - nextMinuteUpdate) >= 0) {
     updateTimeDisplay();
-    lastMinuteUpdate = currentMillis;
   }
 }
 
@@ -52,7 +81,7 @@ auto TimeManager::getCurrentTimeString() const -> String {
   
   struct tm timeInfo{};
   if (getLocalTime(&timeInfo)) {
-    return formatTime(&timeInfo);
+    return {formatTime(&timeInfo).c_str()};
   }     return "Time Error";
  
 }
@@ -61,58 +90,123 @@ auto TimeManager::isTimeInitialized() const -> bool {
   return timeInitialized;
 }
 
+auto TimeManager::isTimeSynced() const -> bool {
+  return timeSynced;
+}
+
+auto TimeManager::getNextDeadline() const -> unsigned long {
+  if (!ntpStarted) {
+    return nextMinuteUpdate;
+  }
+  unsigned long const nextSync = lastNTPSync + NTP_SYNC_INTERVAL;
+  return static_cast<long>(nextSync - nextMinuteUpdate) < 0 ? nextSync : nextMinuteUpdate;
+}
+
+auto TimeManager::hasPendingSync() const -> bool {
+  return syncPending.load();
+}
+
 auto TimeManager::forceSync() -> void {
   syncTimeFromNTP();
   updateTimeDisplay();
 }
 
+auto TimeManager::loadTimezone() -> void {
+  Preferences preferences;
+  preferences.begin("time", true);
+  posixTimezone = preferences.getString("tz", DEFAULT_POSIX_TIMEZONE);
+  preferences.end();
+  if (posixTimezone.isEmpty()) {
+    posixTimezone = DEFAULT_POSIX_TIMEZONE;
+  }
+  LOG_DEBUG("Time zone: %s", posixTimezone.c_str());
+
+  // DST transitions come from the POSIX TZ rules in libc
+  setenv("TZ", posixTimezone.c_str(), 1);
+  tzset();
+}
+
 auto TimeManager::setupNTP() -> void {
-  Logger.debug(MAIN_LOG, "Setting up NTP time synchronization...");
+  LOG_DEBUG("Setting up NTP time synchronization...");
 
-  configTime(TZ_OFFSET * SECONDS_PER_HOUR, SECONDS_PER_HOUR, "pool.ntp.org", "time.nist.gov");
+  // Starts SNTP in the background; onTimeSynced fires on every response and
+  // wakes the scheduler so the sync is handled without polling. The zone
+  // passed along is the one init() already set.
+  sntp_set_time_sync_notification_cb(onTimeSynced);
+  configTzTime(posixTimezone.c_str(), "pool.ntp.org", "time.nist.gov");
+}
 
-  Logger.debug(MAIN_LOG, "Waiting for NTP time sync");
+auto TimeManager::seedClock() -> bool {
   time_t now = 0;
-  int retry = 0;
-  const int max_retries = 20;
-
-  const int RETRY_DELAY_MS = 500;
-  const int LOADED_TIME = 8 * SECONDS_PER_HOUR * 2; // 16 hours in seconds
-  while (now < LOADED_TIME && retry < max_retries) {
-    Logger.debug(MAIN_LOG, "Waiting for NTP time sync...");
-    delay(RETRY_DELAY_MS);
-    time(&now); //NOLINT(cert-err33-c) No need to check return, loop handles it
-    retry++;
+  time(&now); //NOLINT(cert-err33-c) Checked against MIN_PLAUSIBLE_TIME below
+
+  // The system clock keeps running across soft resets
+  if (now >= MIN_PLAUSIBLE_TIME) {
+    LOG_DEBUG("Clock still valid from before reset");
+    return true;
   }
-  
-  if (retry >= max_retries) {
-    Logger.error(MAIN_LOG, "Failed to get time from NTP server.");
-    DisplayState* rootState = AppState::getInstance().getRootState();
-    if (rootState != nullptr) {
-      rootState->label = "Time Error";
+
+  time_t seed = 0;
+  if (rtcTimeRecord.magic == RTC_TIME_MAGIC && rtcTimeRecord.epoch >= MIN_PLAUSIBLE_TIME) {
+    seed = rtcTimeRecord.epoch;
+    LOG_DEBUG("Seeding clock from RTC memory");
+  } else {
+    Preferences preferences;
+    preferences.begin("time", true);
+    seed = static_cast<time_t>(preferences.getULong64("epoch", 0));
+    preferences.end();
+    if (seed < MIN_PLAUSIBLE_TIME) {
+      return false;
     }
-    return;
+    LOG_DEBUG("Seeding clock from last saved sync");
   }
 
-  Logger.debug(MAIN_LOG, "Time synchronized. Current time: %s", ctime(&now));
+  struct timeval const seeded = {seed, 0};
+  settimeofday(&seeded, nullptr);
+  return true;
+}
+
+auto TimeManager::onTimeSynced(struct timeval* /*tv*/) -> void {
+  syncPending.store(true);
+  Scheduler::getNetworkInstance().notify();
+}
+
+auto TimeManager::onSyncReceived() -> void {
+  time_t now = 0;
+  time(&now); //NOLINT(cert-err33-c) Time was just set by SNTP
+  LOG_DEBUG("Time synchronized. Current time: %s", ctime(&now));
+
   timeInitialized = true;
-  
+  timeSynced = true;
+  saveLastKnownTime();
+
+  // The clock may have jumped, so redraw and realign the minute tick
   updateTimeDisplay();
-  
-  lastNTPSync = millis();
-  lastMinuteUpdate = millis();
+}
+
+auto TimeManager::saveLastKnownTime() const -> void {
+  time_t now = 0;
+  time(&now); //NOLINT(cert-err33-c) Only called once time is valid
+
+  rtcTimeRecord = {RTC_TIME_MAGIC, now};
+
+  Preferences preferences;
+  preferences.begin("time", false);
+  preferences.putULong64("epoch", static_cast<uint64_t>(now));
+  preferences.end();
 }
 
 auto TimeManager::syncTimeFromNTP() const -> void {
-  Logger.debug(MAIN_LOG, "Syncing time with NTP server...");
+  LOG_DEBUG("Syncing time with NTP server...");
 
   // Force NTP update with timezone configuration
-  configTime(TZ_OFFSET * SECONDS_PER_HOUR, SECONDS_PER_HOUR, "pool.ntp.org", "time.nist.gov");
+  configTzTime(posixTimezone.c_str(), "pool.ntp.org", "time.nist.gov");
 
   // No point waiting for the sync, the update will happen next time the clock updates anyways
 }
 
 auto TimeManager::updateTimeDisplay() -> void {
+  scheduleNextMinute();
   if (!timeInitialized) {
     return;
   }
@@ -121,19 +215,35 @@ auto TimeManager::updateTimeDisplay() -> void {
   struct tm timeInfo{};
   if (getLocalTime(&timeInfo)) {
     currentTime = timeInfo;
-    String const timeString = formatTime(&timeInfo);
-    DisplayState* rootState = AppState::getInstance().getRootState();
-    if (rootState != nullptr) {
-      rootState->label = timeString;
+    // Mark seeded time as approximate until SNTP confirms it
+    FixedString<MAX_TIME_STRING_LENGTH + 1> label;
+    if (!timeSynced) {
+      label.append('~');
     }
+    label.append(formatTime(&timeInfo).c_str());
+    NetworkTask::getInstance().postRootLabel(label.c_str());
+    rtcTimeRecord = {RTC_TIME_MAGIC, mktime(&timeInfo)};
   } else {
-    Logger.error(MAIN_LOG, "Failed to get local time!");
+    LOG_ERROR("Failed to get local time!");
   }
 }
 
-const int MAX_TIME_STRING_LENGTH = 20;
-auto TimeManager::formatTime(struct tm* timeInfo) const -> String {
-  std::array<char, MAX_TIME_STRING_LENGTH> buffer;
+auto TimeManager::scheduleNextMinute() -> void {
+  // Until the clock is valid there is no boundary to align to, check again in a minute
+  long delayMs = SECONDS_PER_MINUTE * MILLIS_PER_SECOND;
+
+  struct timeval now{};
+  if (timeInitialized && gettimeofday(&now, nullptr) == 0) {
+    long const secondsIntoMinute = now.tv_sec % SECONDS_PER_MINUTE;
+    // Round up so the tick never lands just before the boundary
+    delayMs = (SECONDS_PER_MINUTE - secondsIntoMinute) * MILLIS_PER_SECOND - now.tv_usec / MILLIS_PER_SECOND + 1;
+  }
+
+  nextMinuteUpdate = millis() + delayMs;
+}
+
+auto TimeManager::formatTime(struct tm* timeInfo) const -> TimeString {
+  std::array<char, MAX_TIME_STRING_LENGTH> buffer{};
   strftime(buffer.data(), buffer.size(), "%a %m/%d %I:%M %p", timeInfo);
-  return {buffer.data()};
+  return TimeString(buffer.data());
 }
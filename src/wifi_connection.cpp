@@ -0,0 +1,323 @@
+#include "wifi_connection.h"
+#include "breadcrumbs.h"
+#include "change_bus.h"
+#include "scheduler.h"
+#include <Arduino.h>
+#include <Preferences.h>
+#include <logging.h>
+
+// A pinned connect either works almost immediately or not at all
+const unsigned long WiFiConnection::FAST_CONNECT_TIMEOUT = 3000;
+// How long to try a normal connect on boot before opening the setup portal
+const unsigned long WiFiConnection::CONNECT_TIMEOUT = 20000;
+// Per-attempt limit while recovering a lost link
+const unsigned long WiFiConnection::RECONNECT_TIMEOUT = 10000;
+// Delay before reconnect attempt n is BACKOFF_BASE << n, capped, so an AP
+// that comes back is rejoined within BACKOFF_MAX + RECONNECT_TIMEOUT
+const unsigned long WiFiConnection::BACKOFF_BASE = 500;
+const unsigned long WiFiConnection::BACKOFF_MAX = 16000;
+const unsigned long WiFiConnection::PORTAL_POLL_INTERVAL = 50;
+const unsigned long WiFiConnection::RSSI_INTERVAL = 5000;
+
+const int RSSI_SMOOTHING = 4;
+const std::array<int, 4> SIGNAL_BAR_THRESHOLDS = {-85, -75, -65, -55};
+
+auto WiFiConnection::getInstance() -> WiFiConnection& {
+  static WiFiConnection instance;
+  return instance;
+}
+
+auto WiFiConnection::begin(WiFiManager& portal) -> void {
+  this->portal = &portal;
+  portal.setConfigPortalBlocking(false);
+
+  loadCache();
+  loadStaticConfig();
+
+  WiFi.onEvent([this](WiFiEvent_t event, WiFiEventInfo_t /*info*/) { onEvent(event); });
+  WiFi.persistent(true);
+  WiFi.setAutoReconnect(false); // Reconnects are paced by the backoff below
+  WiFi.mode(WIFI_STA);
+
+  if (cacheValid && portal.getWiFiIsSaved()) {
+    startAttempt(Phase::FAST_CONNECT);
+  } else if (portal.getWiFiIsSaved()) {
+    startAttempt(Phase::CONNECT);
+  } else {
+    startPortal();
+  }
+}
+
+auto WiFiConnection::update(unsigned long now) -> unsigned long {
+  eventPending.store(false);
+
+  if (phase == Phase::IDLE) {
+    return Scheduler::NO_DEADLINE;
+  }
+
+  if (phase == Phase::CONNECTED) {
+    if (disconnected.exchange(false) && WiFi.status() != WL_CONNECTED) {
+      onLinkLost(now);
+      return update(now);
+    }
+    if (static_cast<long>(now - nextRssiSample) >= 0) {
+      sampleRssi(now);
+    }
+    return nextRssiSample;
+  }
+
+  if (phase != Phase::BACKOFF && WiFi.status() == WL_CONNECTED) {
+    if (phase == Phase::PORTAL) {
+      portal->stopConfigPortal();
+    }
+    onConnected(now);
+    return nextRssiSample;
+  }
+
+  unsigned long const elapsed = now - attemptStartedAt;
+  switch (phase) {
+    case Phase::FAST_CONNECT:
+      // A wrong BSSID or channel shows up as a quick disconnect
+      if (disconnected.load() || elapsed >= FAST_CONNECT_TIMEOUT) {
+        LOG_INFO("Fast WiFi connect failed after %lu ms, scanning", elapsed);
+        WiFi.disconnect();
+        startAttempt(Phase::CONNECT);
+        return update(now);
+      }
+      return attemptStartedAt + FAST_CONNECT_TIMEOUT;
+    case Phase::CONNECT: {
+      unsigned long const timeout = recovering ? RECONNECT_TIMEOUT : CONNECT_TIMEOUT;
+      if (elapsed >= timeout) {
+        onAttemptFailed(now);
+        return update(now);
+      }
+      return attemptStartedAt + timeout;
+    }
+    case Phase::BACKOFF:
+      if (static_cast<long>(now - retryAt) >= 0) {
+        startAttempt(Phase::CONNECT);
+        return attemptStartedAt + RECONNECT_TIMEOUT;
+      }
+      return retryAt;
+    case Phase::PORTAL:
+      portal->process();
+      return now + PORTAL_POLL_INTERVAL;
+    default:
+      return Scheduler::NO_DEADLINE;
+  }
+}
+
+auto WiFiConnection::hasPendingEvent() const -> bool {
+  return eventPending.load();
+}
+
+auto WiFiConnection::getLinkState() const -> LinkState {
+  switch (phase) {
+    case Phase::CONNECTED:
+      return LinkState::UP;
+    case Phase::PORTAL:
+      return LinkState::SETUP_PORTAL;
+    default:
+      return recovering ? LinkState::RECONNECTING : LinkState::CONNECTING;
+  }
+}
+
+auto WiFiConnection::isLinkUp() const -> bool {
+  return phase == Phase::CONNECTED;
+}
+
+auto WiFiConnection::getRssi() const -> int {
+  return rssi;
+}
+
+auto WiFiConnection::getSignalBars() const -> uint8_t {
+  return signalBars;
+}
+
+auto WiFiConnection::getTimings() const -> const WiFiTimings& {
+  return timings;
+}
+
+auto WiFiConnection::getDisconnectCount() const -> uint32_t {
+  return disconnectCount;
+}
+
+auto WiFiConnection::getLastRecoveryMs() const -> unsigned long {
+  return lastRecoveryMs;
+}
+
+auto WiFiConnection::startAttempt(Phase attempt) -> void {
+  phase = attempt;
+  associatedAt.store(0);
+  gotIpAt.store(0);
+  disconnected.store(false);
+  attemptStartedAt = millis();
+
+  // The pinned attempt still runs DHCP: reusing an old lease as a static
+  // address could take one the server has since given to another host.
+  // lwIP built with LWIP_DHCP_RESTORE_LAST_IP asks for the previous address
+  // straight away.
+  if (staticConfigured) {
+    WiFi.config(staticConfig.ip, staticConfig.gateway, staticConfig.subnet, staticConfig.dns);
+  } else {
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());
+  }
+
+  if (attempt == Phase::FAST_CONNECT) {
+    // The driver keeps the credentials WiFiManager saved, the cache only
+    // says where to find the AP
+    String const ssid = portal->getWiFiSSID(true);
+    String const psk = portal->getWiFiPass(true);
+    LOG_DEBUG("Fast WiFi connect to %s on channel %d", ssid.c_str(), cache.channel);
+    WiFi.begin(ssid.c_str(), psk.c_str(), cache.channel, cache.bssid.data(), true);
+  } else {
+    WiFi.begin(); // Scans for the credentials WiFiManager saved
+  }
+}
+
+auto WiFiConnection::startPortal() -> void {
+  LOG_INFO("Starting WiFi setup portal: Desk Control Panel");
+  phase = Phase::PORTAL;
+  Breadcrumbs::getInstance().record(Breadcrumb::WIFI_PORTAL);
+  portal->startConfigPortal("Desk Control Panel");
+  ChangeBus::getInstance().publish(Change::STATUS_ICONS);
+}
+
+auto WiFiConnection::onEvent(WiFiEvent_t event) -> void {
+  // Runs on the WiFi event task, so only record the event and wake the loop
+  switch (event) {
+    case ARDUINO_EVENT_WIFI_STA_CONNECTED:
+      associatedAt.store(millis());
+      break;
+    case ARDUINO_EVENT_WIFI_STA_GOT_IP:
+      gotIpAt.store(millis());
+      break;
+    case ARDUINO_EVENT_WIFI_STA_DISCONNECTED:
+    case ARDUINO_EVENT_WIFI_STA_LOST_IP:
+      disconnected.store(true);
+      break;
+    default:
+      return;
+  }
+  eventPending.store(true);
+  Scheduler::getNetworkInstance().notify();
+}
+
+auto WiFiConnection::onConnected(unsigned long now) -> void {
+  unsigned long const associated = associatedAt.load() != 0 ? associatedAt.load() : now;
+  unsigned long const gotIp = gotIpAt.load() != 0 ? gotIpAt.load() : now;
+
+  timings.associateMs = associated - attemptStartedAt;
+  timings.ipMs = gotIp - associated;
+  timings.totalMs = now - attemptStartedAt;
+  timings.fastConnect = phase == Phase::FAST_CONNECT;
+  phase = Phase::CONNECTED;
+  disconnected.store(false);
+  Breadcrumbs::getInstance().record(Breadcrumb::WIFI_UP, 0, static_cast<uint16_t>(disconnectCount));
+
+  if (recovering) {
+    lastRecoveryMs = now - linkLostAt;
+    recovering = false;
+    LOG_INFO("WiFi recovered after %lu ms and %u attempts", lastRecoveryMs, reconnectAttempts);
+  } else {
+    LOG_INFO("WiFi connected (%s): associate %lu ms, IP %lu ms, total %lu ms",
+      timings.fastConnect ? "fast" : "scan", timings.associateMs, timings.ipMs, timings.totalMs);
+  }
+
+  rssi = WiFi.RSSI();
+  sampleRssi(now);
+  saveCache();
+  ChangeBus::getInstance().publish(Change::STATUS_ICONS);
+}
+
+auto WiFiConnection::onLinkLost(unsigned long now) -> void {
+  LOG_ERROR("WiFi link lost");
+  Breadcrumbs::getInstance().record(Breadcrumb::WIFI_DOWN);
+  disconnectCount++;
+  recovering = true;
+  reconnectAttempts = 0;
+  linkLostAt = now;
+  signalBars = 0;
+  ChangeBus::getInstance().publish(Change::STATUS_ICONS);
+
+  // The AP usually comes straight back on the same channel
+  startAttempt(cacheValid ? Phase::FAST_CONNECT : Phase::CONNECT);
+}
+
+auto WiFiConnection::onAttemptFailed(unsigned long now) -> void {
+  WiFi.disconnect();
+
+  if (!recovering) {
+    LOG_ERROR("Failed to connect to WiFi with saved credentials");
+    startPortal();
+    return;
+  }
+
+  unsigned long const backoff = min(BACKOFF_BASE << min<uint8_t>(reconnectAttempts, 15), BACKOFF_MAX);
+  reconnectAttempts++;
+  retryAt = now + backoff;
+  phase = Phase::BACKOFF;
+  LOG_DEBUG("WiFi reconnect attempt %u failed, retrying in %lu ms", reconnectAttempts, backoff);
+}
+
+auto WiFiConnection::sampleRssi(unsigned long now) -> void {
+  rssi += (WiFi.RSSI() - rssi) / RSSI_SMOOTHING;
+  nextRssiSample = now + RSSI_INTERVAL;
+
+  uint8_t bars = 0;
+  for (int const threshold : SIGNAL_BAR_THRESHOLDS) {
+    if (rssi >= threshold) {
+      bars++;
+    }
+  }
+  if (bars != signalBars) {
+    signalBars = bars;
+    ChangeBus::getInstance().publish(Change::STATUS_ICONS);
+  }
+}
+
+auto WiFiConnection::loadCache() -> void {
+  Preferences preferences;
+  preferences.begin("wifi_cache", true);
+  cacheValid = preferences.getBytes("cache", &cache, sizeof(cache)) == sizeof(cache) && cache.version == CACHE_VERSION;
+  preferences.end();
+}
+
+auto WiFiConnection::saveCache() -> void {
+  Cache updated{};
+  updated.version = CACHE_VERSION;
+  memcpy(updated.bssid.data(), WiFi.BSSID(), BSSID_LENGTH);
+  updated.channel = WiFi.channel();
+
+  // Skip the flash write when nothing changed, which is the usual case
+  if (cacheValid && memcmp(&updated, &cache, sizeof(cache)) == 0) {
+    return;
+  }
+
+  Preferences preferences;
+  preferences.begin("wifi_cache", false);
+  preferences.putBytes("cache", &updated, sizeof(updated));
+  preferences.end();
+
+  cache = updated;
+  cacheValid = true;
+  LOG_DEBUG("Saved WiFi fast connect details");
+}
+
+auto WiFiConnection::loadStaticConfig() -> void {
+  Preferences preferences;
+  preferences.begin("wifi", true);
+  String const ip = preferences.getString("ip", "");
+  String const gateway = preferences.getString("gateway", "");
+  String const subnet = preferences.getString("subnet", "255.255.255.0");
+  String const dns = preferences.getString("dns", "");
+  preferences.end();
+
+  staticConfigured = !ip.isEmpty()
+    && staticConfig.ip.fromString(ip.c_str())
+    && staticConfig.gateway.fromString(gateway.c_str())
+    && staticConfig.subnet.fromString(subnet.c_str());
+  if (staticConfigured && !staticConfig.dns.fromString(dns.c_str())) {
+    staticConfig.dns = staticConfig.gateway;
+  }
+}
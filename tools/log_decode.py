@@ -0,0 +1,174 @@
+#!/usr/bin/env python3
+"""Host-side formatter for binary log frames.
+
+Builds made with -DLOG_BINARY_OUTPUT write each log call as a frame holding
+the address of its format string and the raw arguments instead of text. This
+looks the format strings up in the firmware ELF and prints the messages the
+way the panel would have. Anything between frames (console output, crash
+dumps) is passed through unchanged.
+
+    pio run -t upload && pio device monitor --raw | tools/log_decode.py .pio/build/esp32/firmware.elf
+
+or read a capture file, or a serial port directly (needs pyserial):
+
+    tools/log_decode.py firmware.elf --port /dev/ttyUSB0
+"""
+
+import argparse
+import re
+import struct
+import sys
+from pathlib import Path
+
+FRAME_MARKER = b"\xa5\x5a"
+HEADER = struct.Struct("<IIB")
+LEVEL_NAMES = ["", "ERROR", "WARN", "INFO", "DEBUG"]
+SPEC = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(hh|h|ll|l|L|q|j|z|t)?([diouxXcspfFeEgGaA%])")
+
+# Argument tags, as in include/log_ring.h
+I32, U32, I64, U64, F64, STR = range(1, 7)
+SHF_ALLOC = 0x2
+SHT_NOBITS = 8
+
+
+class FormatStrings:
+    """Reads NUL-terminated strings at load addresses in an ELF image."""
+
+    def __init__(self, path: Path):
+        self.image = path.read_bytes()
+        if self.image[:4] != b"\x7fELF" or self.image[4] != 1:
+            raise ValueError(f"{path} is not a 32-bit ELF file")
+
+        (shoff,) = struct.unpack_from("<I", self.image, 0x20)
+        shentsize, shnum = struct.unpack_from("<HH", self.image, 0x2E)
+        self.sections = []
+        for index in range(shnum):
+            _, kind, flags, addr, offset, size = struct.unpack_from("<IIIIII", self.image, shoff + index * shentsize)
+            if flags & SHF_ALLOC and kind != SHT_NOBITS and size > 0:
+                self.sections.append((addr, size, offset))
+        self.cache = {}
+
+    def lookup(self, address: int) -> str:
+        if address not in self.cache:
+            self.cache[address] = self.read(address)
+        return self.cache[address]
+
+    def read(self, address: int) -> str:
+        for addr, size, offset in self.sections:
+            if addr <= address < addr + size:
+                start = offset + address - addr
+                end = self.image.index(b"\0", start)
+                return self.image[start:end].decode("utf-8", "replace")
+        return f"<unknown format 0x{address:08x}>"
+
+
+def decode_arguments(payload: bytes) -> list:
+    arguments = []
+    offset = 0
+    while offset < len(payload):
+        tag = payload[offset]
+        offset += 1
+        if tag in (I32, U32):
+            arguments.append(struct.unpack_from("<i" if tag == I32 else "<I", payload, offset)[0])
+            offset += 4
+        elif tag in (I64, U64):
+            arguments.append(struct.unpack_from("<q" if tag == I64 else "<Q", payload, offset)[0])
+            offset += 8
+        elif tag == F64:
+            arguments.append(struct.unpack_from("<d", payload, offset)[0])
+            offset += 8
+        elif tag == STR:
+            length = payload[offset]
+            arguments.append(payload[offset + 1:offset + 1 + length].decode("utf-8", "replace"))
+            offset += 1 + length
+        else:
+            break
+    return arguments
+
+
+def format_message(fmt: str, arguments: list) -> str:
+    remaining = iter(arguments)
+
+    def convert(match: re.Match) -> str:
+        flags, _, conversion = match.groups()
+        if conversion == "%":
+            return "%"
+        value = next(remaining, None)
+        if value is None:
+            return "?"
+        if conversion == "s":
+            return ("%" + flags + "s") % value
+        if conversion == "p":
+            return "0x%x" % value
+        if conversion in "fFeEgGaA":
+            return ("%" + flags + conversion.replace("a", "e").replace("A", "E")) % float(value)
+        if conversion in "uoxX" and value < 0:
+            value &= 0xFFFFFFFF  # An int printed as unsigned
+        if conversion == "c":
+            return chr(value)
+        return ("%" + flags + conversion.replace("u", "d").replace("i", "d")) % value
+
+    return SPEC.sub(convert, fmt)
+
+
+def decode(stream, strings: FormatStrings, output, follow: bool = False) -> None:
+    buffer = b""
+    read = getattr(stream, "read1", stream.read)  # Return whatever a pipe has so far
+    while True:
+        data = read(256)
+        if not data:
+            if follow:
+                continue
+            break
+        buffer += data
+
+        while True:
+            start = buffer.find(FRAME_MARKER)
+            if start < 0:
+                # Keep a trailing byte that may start the next marker
+                keep = 1 if buffer.endswith(FRAME_MARKER[:1]) else 0
+                output.write(buffer[:len(buffer) - keep].decode("utf-8", "replace"))
+                buffer = buffer[len(buffer) - keep:]
+                break
+
+            output.write(buffer[:start].decode("utf-8", "replace"))
+            buffer = buffer[start:]
+            if len(buffer) < 3 or len(buffer) < 3 + buffer[2]:
+                break  # Wait for the rest of the frame
+
+            length = buffer[2]
+            frame = buffer[3:3 + length]
+            buffer = buffer[3 + length:]
+            if length < HEADER.size:
+                continue
+
+            address, timestamp, level = HEADER.unpack_from(frame)
+            message = format_message(strings.lookup(address), decode_arguments(frame[HEADER.size:]))
+            name = LEVEL_NAMES[level] if level < len(LEVEL_NAMES) else ""
+            output.write(f"{timestamp:10d} {name:<5} {message}\n")
+        output.flush()
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("elf", type=Path, help="firmware.elf of the running build")
+    parser.add_argument("capture", nargs="?", default="-", help="binary capture file, - for stdin")
+    parser.add_argument("--port", help="read a serial port instead")
+    parser.add_argument("--baud", type=int, default=115200)
+    args = parser.parse_args()
+
+    strings = FormatStrings(args.elf)
+    if args.port:
+        import serial  # pylint: disable=import-outside-toplevel
+
+        with serial.Serial(args.port, args.baud, timeout=0.1) as port:
+            decode(port, strings, sys.stdout, follow=True)
+    elif args.capture == "-":
+        decode(sys.stdin.buffer, strings, sys.stdout)
+    else:
+        with open(args.capture, "rb") as capture:
+            decode(capture, strings, sys.stdout)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,114 @@
+#!/usr/bin/env python3
+"""Local stand-in for the GitHub release download used by OTA updates.
+
+Serves firmware.bin and firmware.bin.gz from a build, optionally throttled to
+mimic a congested network. Point the panel at it by building with
+
+    PLATFORMIO_BUILD_FLAGS='-DOTA_STAND_IN_URL=\\"http://<host>:8000\\"' pio run
+
+With --bench it downloads both images from itself instead and reports the
+download time and the CPU time spent inflating the compressed one.
+
+Input stays live through every flash write of an update. To check that
+the interrupt path is still flash-free, serve with --rate 20 and keep
+turning the dial and pressing buttons through the whole download. Do this
+once with the gzip image and once with --no-gzip, which makes the panel
+fall back to the raw firmware.bin of the release. Any "Cache disabled but
+cached memory region accessed" panic fails the test.
+"""
+
+import argparse
+import gzip
+import http.server
+import threading
+import time
+import urllib.request
+import zlib
+from pathlib import Path
+
+CHUNK_SIZE = 1024
+
+
+def compress(image: bytes) -> bytes:
+    # Same settings as the release workflow: gzip -9 -n
+    return gzip.compress(image, compresslevel=9, mtime=0)
+
+
+def make_handler(files: dict, rate_kbps: float):
+    class Handler(http.server.BaseHTTPRequestHandler):
+        def do_GET(self):
+            body = files.get(self.path.lstrip("/"))
+            if body is None:
+                self.send_error(404)
+                return
+
+            self.send_response(200)
+            self.send_header("Content-Type", "application/octet-stream")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+
+            delay = CHUNK_SIZE / (rate_kbps * 1024) if rate_kbps > 0 else 0
+            for offset in range(0, len(body), CHUNK_SIZE):
+                self.wfile.write(body[offset:offset + CHUNK_SIZE])
+                if delay:
+                    time.sleep(delay)
+
+        def log_message(self, fmt, *args):
+            print(f"{self.address_string()} {fmt % args}")
+
+    return Handler
+
+
+def bench(port: int, files: dict) -> None:
+    for name in files:
+        start = time.perf_counter()
+        with urllib.request.urlopen(f"http://127.0.0.1:{port}/{name}") as response:
+            body = response.read()
+        download_s = time.perf_counter() - start
+
+        inflate_ms = 0.0
+        image_size = len(body)
+        if name.endswith(".gz"):
+            # Stream in network-sized chunks with a 32 KB window, as the device does
+            start = time.process_time()
+            inflater = zlib.decompressobj(wbits=16 + 15)
+            image_size = 0
+            for offset in range(0, len(body), CHUNK_SIZE):
+                image_size += len(inflater.decompress(body[offset:offset + CHUNK_SIZE]))
+            image_size += len(inflater.flush())
+            inflate_ms = (time.process_time() - start) * 1000
+            assert image_size == len(files["firmware.bin"]), "inflated size mismatch"
+
+        print(f"{name:16} {len(body):>9} bytes  download {download_s * 1000:8.0f} ms  "
+              f"{len(body) / 1024 / download_s:8.1f} KB/s  inflate {inflate_ms:6.1f} ms  "
+              f"image {image_size} bytes")
+
+
+def main() -> None:
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("firmware", nargs="?", default=".pio/build/esp32/firmware.bin", type=Path)
+    parser.add_argument("--port", type=int, default=8000)
+    parser.add_argument("--rate", type=float, default=0, help="throttle to this many KB/s (0 = unlimited)")
+    parser.add_argument("--bench", action="store_true", help="download both images locally and report timings")
+    parser.add_argument("--no-gzip", action="store_true", help="answer 404 for firmware.bin.gz")
+    args = parser.parse_args()
+
+    image = args.firmware.read_bytes()
+    files = {"firmware.bin": image, "firmware.bin.gz": compress(image)}
+    print(f"firmware.bin {len(image)} bytes, firmware.bin.gz {len(files['firmware.bin.gz'])} bytes "
+          f"({100 * len(files['firmware.bin.gz']) / len(image):.0f}%)")
+
+    served = {name: body for name, body in files.items() if not (args.no_gzip and name.endswith(".gz"))}
+    server = http.server.ThreadingHTTPServer(("", args.port), make_handler(served, args.rate))
+    if not args.bench:
+        print(f"Serving on port {args.port}")
+        server.serve_forever()
+        return
+
+    threading.Thread(target=server.serve_forever, daemon=True).start()
+    bench(args.port, served)
+    server.shutdown()
+
+
+if __name__ == "__main__":
+    main()